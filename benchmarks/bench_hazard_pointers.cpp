@@ -0,0 +1,98 @@
+#include <benchmark/benchmark.h>
+#include "hazard-pointers.hpp"
+#include <memory>
+#include <vector>
+
+/*
+    Cost of one reclamation scan over the number of hazard records
+    (one per reader thread, so they stand for the threads) and the
+    number of retired nodes. The records are acquired by one thread
+    and every one protects a live node, the retired nodes are not
+    protected, so the scan deletes all of them.
+
+    Scan         -- delete_nodes_with_no_hazards, the hazards are
+                    read once into the snapshot
+    Scan/PerNode -- in_hazard for every retired node, every call
+                    walks the whole list of the records
+*/
+
+struct Node {
+    long val_;
+};
+
+class ScanFix : public benchmark::Fixture {
+
+public:
+
+    void SetUp(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            hazard_ptrs = std::make_unique<hazard_pointers<Node>>();
+            for (int i = 0; i < state.range(0); ++i) {
+                hazard_pointers<Node>::HP* hp = hazard_ptrs->acquire_hazard();
+                hp->ptr_.store(new Node());
+                hps.push_back(hp);
+            }
+        }
+    }
+
+    void TearDown(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            for (auto hp : hps) {
+                delete hp->ptr_.load();
+                hazard_ptrs->release_hazard(hp);
+            }
+            hps.clear();
+            hazard_ptrs.reset();
+        }
+    }
+
+    std::unique_ptr<hazard_pointers<Node>> hazard_ptrs;
+    std::vector<hazard_pointers<Node>::HP*> hps;
+};
+
+BENCHMARK_DEFINE_F(ScanFix, bench_snapshot)(benchmark::State& state) {
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (int i = 0; i < state.range(1); ++i) {
+            hazard_ptrs->reclaim_later(new Node());
+        }
+        state.ResumeTiming();
+        hazard_ptrs->delete_nodes_with_no_hazards();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+
+BENCHMARK_DEFINE_F(ScanFix, bench_per_node)(benchmark::State& state) {
+
+    std::vector<Node*> retired(state.range(1));
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (auto& node : retired) {
+            node = new Node();
+        }
+        state.ResumeTiming();
+        for (auto node : retired) {
+            if (!hazard_ptrs->in_hazard(node)) {
+                delete node;
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+
+// The retired nodes stay under max_recl_size_,
+// so reclaim_later does not start a scan itself
+BENCHMARK_REGISTER_F(ScanFix, bench_snapshot)
+    ->Name("Scan")
+    ->Unit(benchmark::kMicrosecond)
+    ->ArgsProduct({{1, 8, 64, 256}, {1'000, 16'000}});
+
+BENCHMARK_REGISTER_F(ScanFix, bench_per_node)
+    ->Name("Scan/PerNode")
+    ->Unit(benchmark::kMicrosecond)
+    ->ArgsProduct({{1, 8, 64, 256}, {1'000, 16'000}});
+
+BENCHMARK_MAIN();
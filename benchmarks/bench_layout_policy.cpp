@@ -0,0 +1,216 @@
+#include <benchmark/benchmark.h>
+#include "cache-line.hpp"
+#include "lock-free-mpmc-bounded-queue.hpp"
+#include "lock-free-mpmc-unbounded-queue.hpp"
+#include "lock-free-spsc-ring-queue.hpp"
+#include "lock-free-stack.hpp"
+#include <memory>
+#include <type_traits>
+
+/*
+    The same containers under the three layout policies
+    of cache-line.hpp:
+
+    Packed      -- layout_packed, everything on as few lines as possible
+    Padded      -- layout_padded, indices on their own lines (default)
+    PaddedCells -- layout_padded_cells, every cell on its own line too
+
+    Half of the threads push, the other half pops, kNumItems
+    elements each. The SPSC ring runs with 2 threads only.
+*/
+
+static constexpr int kNumItems = 100'000;
+
+// One interface for the containers, whose push and pop differ
+
+template<class T, std::size_t C, class L>
+bool put(lock_free_mpmc_bounded_queue<T, C, L>& q, int val) {
+    return q.push(val);
+}
+
+template<class T, std::size_t S, class L>
+bool put(lock_free_mpmc_unbounded_queue<T, S, L>& q, int val) {
+    q.push(val);
+    return true;
+}
+
+template<class T, class L>
+bool put(lock_free_spsc_ring_queue<T, L>& q, int val) {
+    return q.push(val);
+}
+
+template<class T, class L>
+bool put(lock_free_stack<T, L>& q, int val) {
+    q.push(val);
+    return true;
+}
+
+template<class T, std::size_t C, class L>
+bool take(lock_free_mpmc_bounded_queue<T, C, L>& q, int& val) {
+    return q.try_pop(val);
+}
+
+template<class T, std::size_t S, class L>
+bool take(lock_free_mpmc_unbounded_queue<T, S, L>& q, int& val) {
+    return q.try_pop(val);
+}
+
+template<class T, class L>
+bool take(lock_free_spsc_ring_queue<T, L>& q, int& val) {
+    return q.pop(val);
+}
+
+template<class T, class L>
+bool take(lock_free_stack<T, L>& q, int& val) {
+    std::shared_ptr<T> res = q.pop();
+    if (!res) {
+        return false;
+    }
+    val = *res;
+    return true;
+}
+
+template<class Q>
+class LayoutFix : public benchmark::Fixture {
+
+public:
+
+    void SetUp(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            if constexpr (std::is_constructible<Q, std::size_t>::value) {
+                q = std::make_unique<Q>(1024);
+            } else {
+                q = std::make_unique<Q>();
+            }
+        }
+    }
+
+    void TearDown(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            q.reset();
+        }
+    }
+
+    void run(benchmark::State& state) {
+
+        bool pusher = state.thread_index() % 2;
+        int val;
+        for (auto _ : state) {
+            if (pusher) {
+                for (int i = 0; i < kNumItems; ++i) {
+                    while(!put(*q, i));
+                }
+            } else {
+                for (int i = 0; i < kNumItems; ++i) {
+                    while(!take(*q, val));
+                }
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * kNumItems);
+    }
+
+    std::unique_ptr<Q> q;
+};
+
+BENCHMARK_TEMPLATE_DEFINE_F(LayoutFix, bounded_packed, lock_free_mpmc_bounded_queue<int, 0, layout_packed>)
+(benchmark::State& state) { run(state); }
+
+BENCHMARK_TEMPLATE_DEFINE_F(LayoutFix, bounded_padded, lock_free_mpmc_bounded_queue<int, 0, layout_padded>)
+(benchmark::State& state) { run(state); }
+
+BENCHMARK_TEMPLATE_DEFINE_F(LayoutFix, bounded_padded_cells, lock_free_mpmc_bounded_queue<int, 0, layout_padded_cells>)
+(benchmark::State& state) { run(state); }
+
+BENCHMARK_TEMPLATE_DEFINE_F(LayoutFix, unbounded_packed, lock_free_mpmc_unbounded_queue<int, 1024, layout_packed>)
+(benchmark::State& state) { run(state); }
+
+BENCHMARK_TEMPLATE_DEFINE_F(LayoutFix, unbounded_padded, lock_free_mpmc_unbounded_queue<int, 1024, layout_padded>)
+(benchmark::State& state) { run(state); }
+
+BENCHMARK_TEMPLATE_DEFINE_F(LayoutFix, unbounded_padded_cells, lock_free_mpmc_unbounded_queue<int, 1024, layout_padded_cells>)
+(benchmark::State& state) { run(state); }
+
+BENCHMARK_TEMPLATE_DEFINE_F(LayoutFix, ring_packed, lock_free_spsc_ring_queue<int, layout_packed>)
+(benchmark::State& state) { run(state); }
+
+BENCHMARK_TEMPLATE_DEFINE_F(LayoutFix, ring_padded, lock_free_spsc_ring_queue<int, layout_padded>)
+(benchmark::State& state) { run(state); }
+
+BENCHMARK_TEMPLATE_DEFINE_F(LayoutFix, ring_padded_cells, lock_free_spsc_ring_queue<int, layout_padded_cells>)
+(benchmark::State& state) { run(state); }
+
+BENCHMARK_TEMPLATE_DEFINE_F(LayoutFix, stack_packed, lock_free_stack<int, layout_packed>)
+(benchmark::State& state) { run(state); }
+
+BENCHMARK_TEMPLATE_DEFINE_F(LayoutFix, stack_padded, lock_free_stack<int, layout_padded>)
+(benchmark::State& state) { run(state); }
+
+BENCHMARK_REGISTER_F(LayoutFix, bounded_packed)
+    ->Name("Bounded/Packed")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->ThreadRange(2, 32);
+
+BENCHMARK_REGISTER_F(LayoutFix, bounded_padded)
+    ->Name("Bounded/Padded")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->ThreadRange(2, 32);
+
+BENCHMARK_REGISTER_F(LayoutFix, bounded_padded_cells)
+    ->Name("Bounded/PaddedCells")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->ThreadRange(2, 32);
+
+BENCHMARK_REGISTER_F(LayoutFix, unbounded_packed)
+    ->Name("Unbounded/Packed")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->ThreadRange(2, 32);
+
+BENCHMARK_REGISTER_F(LayoutFix, unbounded_padded)
+    ->Name("Unbounded/Padded")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->ThreadRange(2, 32);
+
+BENCHMARK_REGISTER_F(LayoutFix, unbounded_padded_cells)
+    ->Name("Unbounded/PaddedCells")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->ThreadRange(2, 32);
+
+BENCHMARK_REGISTER_F(LayoutFix, ring_packed)
+    ->Name("Ring/Packed")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->Threads(2);
+
+BENCHMARK_REGISTER_F(LayoutFix, ring_padded)
+    ->Name("Ring/Padded")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->Threads(2);
+
+BENCHMARK_REGISTER_F(LayoutFix, ring_padded_cells)
+    ->Name("Ring/PaddedCells")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->Threads(2);
+
+BENCHMARK_REGISTER_F(LayoutFix, stack_packed)
+    ->Name("Stack/Packed")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->ThreadRange(2, 32);
+
+BENCHMARK_REGISTER_F(LayoutFix, stack_padded)
+    ->Name("Stack/Padded")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->ThreadRange(2, 32);
+
+BENCHMARK_MAIN();
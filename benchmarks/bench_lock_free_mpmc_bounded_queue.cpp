@@ -1,5 +1,11 @@
 #include <benchmark/benchmark.h>
 #include "lock-free-mpmc-bounded-queue.hpp"
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <cstdint>
 
 class QueueFix : public benchmark::Fixture {
     
@@ -39,6 +45,13 @@ BENCHMARK_DEFINE_F(QueueFix, bench_pop)(benchmark::State& state) {
     }
 }
 
+BENCHMARK_DEFINE_F(QueueFix, bench_try_pop)(benchmark::State& state) {
+    int val;
+    for (auto _ : state) {
+        q.try_pop(val);
+    }
+}
+
 BENCHMARK_DEFINE_F(QueueFix, bench_mpmc)(benchmark::State& state) {
 
     bool pusher = state.thread_index() % 2;
@@ -49,14 +62,255 @@ BENCHMARK_DEFINE_F(QueueFix, bench_mpmc)(benchmark::State& state) {
                 while(!q.push(i));
             }
         } else {
+            int val;
             for (int i = 0; i < kNumItems; ++i) {
-                while(!q.pop());
+                while(!q.try_pop(val));
+            }    
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kNumItems);
+}
+
+// Same as MPMC, but both sides move the elements in
+// batches of range(0) with push_bulk and pop_bulk
+BENCHMARK_DEFINE_F(QueueFix, bench_bulk_mpmc)(benchmark::State& state) {
+
+    bool pusher = state.thread_index() % 2;
+    int batch = state.range(0);
+    std::vector<int> buf(batch, 1);
+
+    for (auto _ : state) {
+        if (pusher) {
+            for (int i = 0; i < kNumItems; ) {
+                int cnt = std::min(batch, kNumItems - i);
+                i += q.push_bulk(buf.begin(), buf.begin() + cnt);
+            }
+        } else {
+            for (int i = 0; i < kNumItems; ) {
+                i += q.pop_bulk(buf.begin(), std::min(batch, kNumItems - i));
             }    
         }
     }
     state.SetItemsProcessed(state.iterations() * kNumItems);
 }
 
+// Small queue of range(0) cells for the blocking calls
+class WaitFix : public benchmark::Fixture {
+
+public:
+
+    void SetUp(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            q = std::make_unique<lock_free_mpmc_bounded_queue<int>>(state.range(0));
+        }
+    }
+
+    void TearDown(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            q.reset();
+        }
+    }
+
+    static constexpr int kNumItems = 100'000;
+    std::unique_ptr<lock_free_mpmc_bounded_queue<int>> q;
+};
+
+// Same as MPMC, but with the blocking calls: the threads
+// that find the queue empty (full) go to sleep instead of
+// burning the core
+BENCHMARK_DEFINE_F(WaitFix, bench_wait_mpmc)(benchmark::State& state) {
+
+    bool pusher = state.thread_index() % 2;
+
+    for (auto _ : state) {
+        if (pusher) {
+            for (int i = 0; i < kNumItems; ++i) {
+                q->wait_push(i);
+            }
+        } else {
+            int val;
+            for (int i = 0; i < kNumItems; ++i) {
+                q->wait_pop(val);
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kNumItems);
+}
+
+// The same 4 bytes, but not trivially copyable,
+// so the queue keeps them in the inline cells
+struct BoxedInt {
+
+    BoxedInt(int v = 0) : v_(v) {}
+    BoxedInt(const BoxedInt& other) : v_(other.v_) {}
+    BoxedInt& operator = (const BoxedInt& other) {
+        v_ = other.v_;
+        return *this;
+    }
+
+    int v_;
+};
+
+// Every thread pushes and pops one element per iteration:
+// int goes through the packed cells, BoxedInt through the inline ones
+template<class V>
+static void bench_cells(benchmark::State& state) {
+
+    static lock_free_mpmc_bounded_queue<V> q(1024);
+    V val;
+    for (auto _ : state) {
+        while (!q.push(V(1)));
+        while (!q.try_pop(val));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Same as MPMC on 1024 cells, that are in the heap array of the
+// runtime size, or right in the (static) object of the fixed Capacity
+template<class Q>
+static void bench_storage(benchmark::State& state) {
+
+    static Q q(1024);
+    bool pusher = state.thread_index() % 2;
+    int val;
+    for (auto _ : state) {
+        if (pusher) {
+            for (int i = 0; i < QueueFix::kNumItems; ++i) {
+                while(!q.push(i));
+            }
+        } else {
+            for (int i = 0; i < QueueFix::kNumItems; ++i) {
+                while(!q.try_pop(val));
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * QueueFix::kNumItems);
+}
+
+// Soak: one pusher and one popper move range(0) chunks of
+// kNumItems elements through the queue, that starts right before
+// the wrap around of the indices. The popper times every chunk,
+// and the counters report the slowest and the fastest chunk: as
+// long as the throughput is flat, their ratio stays close to 1.
+// Run it with a larger range for the real soak, 50'000 chunks
+// are 5 * 10^9 elements
+class SoakFix : public benchmark::Fixture {
+
+public:
+
+    void SetUp(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            q = std::make_unique<lock_free_mpmc_bounded_queue<int>>(1024, SIZE_MAX - 1000);
+        }
+    }
+
+    void TearDown(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            q.reset();
+        }
+    }
+
+    static constexpr int kNumItems = 100'000;
+    std::unique_ptr<lock_free_mpmc_bounded_queue<int>> q;
+};
+
+BENCHMARK_DEFINE_F(SoakFix, bench_soak)(benchmark::State& state) {
+
+    bool pusher = state.thread_index() % 2;
+    long chunks = state.range(0);
+    double min_rate = 0;
+    double max_rate = 0;
+
+    for (auto _ : state) {
+        for (long c = 0; c < chunks; ++c) {
+            if (pusher) {
+                for (int i = 0; i < kNumItems; ++i) {
+                    while(!q->push(i));
+                }
+                continue;
+            }
+            auto start = std::chrono::steady_clock::now();
+            int val;
+            for (int i = 0; i < kNumItems; ++i) {
+                while(!q->try_pop(val));
+            }
+            std::chrono::duration<double> sec = std::chrono::steady_clock::now() - start;
+            double rate = kNumItems / sec.count();
+            min_rate = (c == 0) ? rate : std::min(min_rate, rate);
+            max_rate = std::max(max_rate, rate);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * chunks * kNumItems);
+    if (!pusher) {
+        state.counters["min_rate"] = min_rate;
+        state.counters["max_rate"] = max_rate;
+        state.counters["flatness"] = min_rate / max_rate;
+    }
+}
+
+// Overwrite: thread 0 is a slow exporter, that pops one element
+// and then does some work, all the others push kNumItems elements each
+// with push_overwrite and never wait. The time is the time of the
+// pushers, the counter is the share of the dropped elements
+class OverwriteFix : public benchmark::Fixture {
+
+public:
+
+    void SetUp(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            q = std::make_unique<lock_free_mpmc_bounded_queue<int>>(1024);
+            done.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void TearDown(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            q.reset();
+        }
+    }
+
+    static constexpr int kNumItems = 100'000;
+    std::unique_ptr<lock_free_mpmc_bounded_queue<int>> q;
+    std::atomic<int> done;
+};
+
+BENCHMARK_DEFINE_F(OverwriteFix, bench_overwrite)(benchmark::State& state) {
+
+    bool exporter = (state.thread_index() == 0);
+    int pushers = state.threads() - 1;
+    int rounds = 0;
+    int val;
+    for (auto _ : state) {
+        if (exporter) {
+            ++rounds;
+            while (done.load(std::memory_order_acquire) < pushers * rounds) {
+                if (q->try_pop(val)) {
+                    benchmark::DoNotOptimize(val * val);
+                    for (int i = 0; i < 100; ++i) {
+                        benchmark::ClobberMemory();
+                    }
+                }
+            }
+            continue;
+        }
+        for (int i = 0; i < kNumItems; ++i) {
+            q->push_overwrite(i);
+        }
+        done.fetch_add(1, std::memory_order_release);
+    }
+    if (exporter) {
+        state.counters["dropped"] = double(q->dropped()) / (state.iterations() * pushers * kNumItems);
+    } else {
+        state.SetItemsProcessed(state.iterations() * kNumItems);
+    }
+}
+
 // Here write the amounts of threads that you want to use
 // 2, 4, 8, 16
 // Also you might want to use RealTime()
@@ -70,9 +324,66 @@ BENCHMARK_REGISTER_F(QueueFix, bench_pop)
     ->UseRealTime()
     ->ThreadRange(1, 32);
 
+BENCHMARK_REGISTER_F(QueueFix, bench_try_pop)
+    ->Name("TryPop")
+    ->UseRealTime()
+    ->ThreadRange(1, 32);
+
 BENCHMARK_REGISTER_F(QueueFix, bench_mpmc)
     ->Name("MPMC")
     ->UseRealTime()
     ->Unit(benchmark::kMicrosecond)
     ->ThreadRange(2, 32);
+
+BENCHMARK_REGISTER_F(QueueFix, bench_bulk_mpmc)
+    ->Name("BulkMPMC")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->RangeMultiplier(4)
+    ->Range(4, 256)
+    ->ThreadRange(2, 32);
+
+BENCHMARK_REGISTER_F(WaitFix, bench_wait_mpmc)
+    ->Name("WaitMPMC")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->Arg(16)
+    ->Arg(1024)
+    ->ThreadRange(2, 32);
+
+BENCHMARK_TEMPLATE(bench_cells, int)
+    ->Name("Cells/Packed")
+    ->UseRealTime()
+    ->ThreadRange(1, 32);
+
+BENCHMARK_TEMPLATE(bench_cells, BoxedInt)
+    ->Name("Cells/Inline")
+    ->UseRealTime()
+    ->ThreadRange(1, 32);
+
+BENCHMARK_TEMPLATE(bench_storage, lock_free_mpmc_bounded_queue<int>)
+    ->Name("Storage/Dynamic")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->ThreadRange(2, 32);
+
+BENCHMARK_TEMPLATE(bench_storage, lock_free_mpmc_bounded_queue<int, 1024>)
+    ->Name("Storage/Static")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->ThreadRange(2, 32);
+
+BENCHMARK_REGISTER_F(SoakFix, bench_soak)
+    ->Name("Soak")
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(1)
+    ->Arg(1000)
+    ->Threads(2);
+
+BENCHMARK_REGISTER_F(OverwriteFix, bench_overwrite)
+    ->Name("Overwrite")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->ThreadRange(2, 32);
 BENCHMARK_MAIN();
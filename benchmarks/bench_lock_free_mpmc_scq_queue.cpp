@@ -0,0 +1,132 @@
+#include <benchmark/benchmark.h>
+#include "lock-free-mpmc-bounded-queue.hpp"
+#include "lock-free-mpmc-scq-queue.hpp"
+
+/*
+    CAS-loop MPMC queue against the fetch_add based SCQ queue.
+
+    Push -- every thread pushes, the full queue is drained
+            with the timer paused
+    Pop  -- every thread pops, the empty queue is refilled
+            with the timer paused
+    MPMC -- half of the threads push kNumItems elements,
+            the other half pops them
+*/
+
+static constexpr int kNumItems = 100'000;
+static constexpr int kSize = 1 << 16;
+
+template<class Q>
+void run_push(benchmark::State& state, Q& q) {
+    int val;
+    for (auto _ : state) {
+        if (!q.push(1)) {
+            state.PauseTiming();
+            while (q.try_pop(val));
+            state.ResumeTiming();
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+template<class Q>
+void run_pop(benchmark::State& state, Q& q) {
+    int val;
+    for (auto _ : state) {
+        if (!q.try_pop(val)) {
+            state.PauseTiming();
+            while (q.push(1));
+            state.ResumeTiming();
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+template<class Q>
+void run_mpmc(benchmark::State& state, Q& q) {
+    bool pusher = state.thread_index() % 2;
+    int val;
+    for (auto _ : state) {
+        if (pusher) {
+            for (int i = 0; i < kNumItems; ++i) {
+                while(!q.push(i));
+            }
+        } else {
+            for (int i = 0; i < kNumItems; ++i) {
+                while(!q.try_pop(val));
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kNumItems);
+}
+
+class CasFix : public benchmark::Fixture {
+
+public:
+
+    lock_free_mpmc_bounded_queue<int> q{kSize};
+};
+
+class ScqFix : public benchmark::Fixture {
+
+public:
+
+    lock_free_mpmc_scq_queue<int> q{kSize};
+};
+
+BENCHMARK_DEFINE_F(CasFix, bench_push)(benchmark::State& state) {
+    run_push(state, q);
+}
+
+BENCHMARK_DEFINE_F(ScqFix, bench_push)(benchmark::State& state) {
+    run_push(state, q);
+}
+
+BENCHMARK_DEFINE_F(CasFix, bench_pop)(benchmark::State& state) {
+    run_pop(state, q);
+}
+
+BENCHMARK_DEFINE_F(ScqFix, bench_pop)(benchmark::State& state) {
+    run_pop(state, q);
+}
+
+BENCHMARK_DEFINE_F(CasFix, bench_mpmc)(benchmark::State& state) {
+    run_mpmc(state, q);
+}
+
+BENCHMARK_DEFINE_F(ScqFix, bench_mpmc)(benchmark::State& state) {
+    run_mpmc(state, q);
+}
+
+BENCHMARK_REGISTER_F(CasFix, bench_push)
+    ->Name("Cas/Push")
+    ->UseRealTime()
+    ->Threads(1);
+
+BENCHMARK_REGISTER_F(ScqFix, bench_push)
+    ->Name("Scq/Push")
+    ->UseRealTime()
+    ->Threads(1);
+
+BENCHMARK_REGISTER_F(CasFix, bench_pop)
+    ->Name("Cas/Pop")
+    ->UseRealTime()
+    ->Threads(1);
+
+BENCHMARK_REGISTER_F(ScqFix, bench_pop)
+    ->Name("Scq/Pop")
+    ->UseRealTime()
+    ->Threads(1);
+
+BENCHMARK_REGISTER_F(CasFix, bench_mpmc)
+    ->Name("Cas/MPMC")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->ThreadRange(2, 64);
+
+BENCHMARK_REGISTER_F(ScqFix, bench_mpmc)
+    ->Name("Scq/MPMC")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->ThreadRange(2, 64);
+BENCHMARK_MAIN();
@@ -0,0 +1,145 @@
+#include <benchmark/benchmark.h>
+#include "lock-free-mpmc-bounded-queue.hpp"
+#include "lock-free-mpmc-unbounded-queue.hpp"
+
+/*
+    Unbounded MPMC queue of linked rings against
+    the bounded MPMC queue.
+
+    Push  -- every thread pushes into the unbounded queue,
+             which grows segment by segment
+    Pop   -- every thread pops from the prefilled queue
+    MPMC  -- half of the threads push kNumItems elements,
+             the other half pops them. In the steady state
+             the unbounded queue stays in one segment
+    Burst -- first all the pushers push, then all the poppers pop:
+             kNumItems * threads does not fit into a segment,
+             so the unbounded queue has to grow and shrink back
+*/
+
+static constexpr int kNumItems = 100'000;
+
+class BoundedFix : public benchmark::Fixture {
+
+public:
+
+    lock_free_mpmc_bounded_queue<int> q{1 << 16};
+};
+
+class UnboundedFix : public benchmark::Fixture {
+
+public:
+
+    void SetUp(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            for (int i = 0; i < (kNumItems * state.threads()); ++i) {
+                q.push(1);
+            }
+        }
+    }
+
+    void TearDown(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            int val;
+            while (q.try_pop(val));
+        }
+    }
+
+    lock_free_mpmc_unbounded_queue<int> q;
+};
+
+template<class Q>
+void run_mpmc(benchmark::State& state, Q& q) {
+    bool pusher = state.thread_index() % 2;
+    int val;
+    for (auto _ : state) {
+        if (pusher) {
+            for (int i = 0; i < kNumItems; ++i) {
+                while(!q.push(i));
+            }
+        } else {
+            for (int i = 0; i < kNumItems; ++i) {
+                while(!q.try_pop(val));
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kNumItems);
+}
+
+BENCHMARK_DEFINE_F(UnboundedFix, bench_push)(benchmark::State& state) {
+    for (auto _ : state) {
+        q.push(1);
+    }
+}
+
+BENCHMARK_DEFINE_F(UnboundedFix, bench_pop)(benchmark::State& state) {
+    int val;
+    for (auto _ : state) {
+        q.try_pop(val);
+    }
+}
+
+BENCHMARK_DEFINE_F(BoundedFix, bench_mpmc)(benchmark::State& state) {
+    run_mpmc(state, q);
+}
+
+BENCHMARK_DEFINE_F(UnboundedFix, bench_mpmc)(benchmark::State& state) {
+    bool pusher = state.thread_index() % 2;
+    int val;
+    for (auto _ : state) {
+        if (pusher) {
+            for (int i = 0; i < kNumItems; ++i) {
+                q.push(i);
+            }
+        } else {
+            for (int i = 0; i < kNumItems; ++i) {
+                while(!q.try_pop(val));
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kNumItems);
+}
+
+BENCHMARK_DEFINE_F(UnboundedFix, bench_burst)(benchmark::State& state) {
+    int val;
+    for (auto _ : state) {
+        for (int i = 0; i < kNumItems; ++i) {
+            q.push(i);
+        }
+        for (int i = 0; i < kNumItems; ++i) {
+            while(!q.try_pop(val));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kNumItems);
+}
+
+BENCHMARK_REGISTER_F(UnboundedFix, bench_push)
+    ->Name("Unbounded/Push")
+    ->UseRealTime()
+    ->ThreadRange(1, 32);
+
+BENCHMARK_REGISTER_F(UnboundedFix, bench_pop)
+    ->Name("Unbounded/Pop")
+    ->UseRealTime()
+    ->ThreadRange(1, 32);
+
+BENCHMARK_REGISTER_F(BoundedFix, bench_mpmc)
+    ->Name("Bounded/MPMC")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->ThreadRange(2, 32);
+
+BENCHMARK_REGISTER_F(UnboundedFix, bench_mpmc)
+    ->Name("Unbounded/MPMC")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->ThreadRange(2, 32);
+
+BENCHMARK_REGISTER_F(UnboundedFix, bench_burst)
+    ->Name("Unbounded/Burst")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->ThreadRange(1, 32);
+BENCHMARK_MAIN();
@@ -1,21 +1,26 @@
 #include <benchmark/benchmark.h>
 #include "lock-free-mpsc-queue.hpp"
+#include "lock-std-queue.hpp"
+#include "lock-fine-queue.hpp"
+#include "lock-free-stack.hpp"
 #include <iostream>
+#include <memory>
+#include <vector>
 #include <thread>
 #include <chrono>
 
 class QueueFix : public benchmark::Fixture {
-    
+
 public:
 
-    void SetUp(::benchmark::State& state) override 
+    void SetUp(::benchmark::State& state) override
     {
         if (state.thread_index() == 0) {
             for (int i = 0; i < (kNumItems * state.threads()); ++i) {
                 q.push(1);
             }
         }
-    } 
+    }
 
     void TearDown(::benchmark::State& state) override
     {
@@ -38,18 +43,142 @@ BENCHMARK_DEFINE_F(QueueFix, bench_pop)(benchmark::State& state) {
     }
 }
 
-BENCHMARK_DEFINE_F(QueueFix, bench_mpsc)(benchmark::State& state) {
+// Thread 0 is the consumer, all the other threads are the
+// producers (sweep over their number), kNumItems per producer.
+// The same for the mutex queues, as the baseline
+template<class Q>
+class MpscFix : public benchmark::Fixture {
+
+public:
+
+    void SetUp(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            q = std::make_unique<Q>();
+        }
+    }
+
+    void TearDown(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            q.reset();
+        }
+    }
+
+    void run(benchmark::State& state) {
+
+        int producers = state.threads() - 1;
+        int val;
+        for (auto _ : state) {
+            if (state.thread_index() != 0) {
+                for (int i = 0; i < kNumItems; ++i) {
+                    q->push(i);
+                }
+            } else {
+                for (int i = 0; i < kNumItems * producers; ++i) {
+                    while(!q->try_pop(val));
+                }
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * kNumItems);
+    }
+
+    static constexpr int kNumItems = 100000;
+    std::unique_ptr<Q> q;
+};
+
+BENCHMARK_TEMPLATE_DEFINE_F(MpscFix, bench_mpsc, lock_free_mpsc_queue<int>)
+(benchmark::State& state) { run(state); }
 
-    bool pusher = (state.thread_index() == 1);
+// Same as MPSC, the consumer takes everything that has arrived with drain
+BENCHMARK_TEMPLATE_DEFINE_F(MpscFix, bench_drain, lock_free_mpsc_queue<int>)
+(benchmark::State& state) {
+
+    int producers = state.threads() - 1;
+    long sum = 0;
+    int carry = 0;
     for (auto _ : state) {
-        if (!pusher) {
+        if (state.thread_index() != 0) {
             for (int i = 0; i < kNumItems; ++i) {
-                q.push(i);
+                q->push(i);
             }
         } else {
+            // A drain can take the elements of the next
+            // iteration too, they are counted there
+            int i = carry;
+            while (i < kNumItems * producers) {
+                i += q->drain([&sum](int& val) { sum += val; });
+            }
+            carry = i - kNumItems * producers;
+        }
+    }
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations() * kNumItems);
+}
+
+BENCHMARK_TEMPLATE_DEFINE_F(MpscFix, bench_std, lock_std_queue<int>)
+(benchmark::State& state) { run(state); }
+
+BENCHMARK_TEMPLATE_DEFINE_F(MpscFix, bench_fine, lock_fine_queue<int>)
+(benchmark::State& state) { run(state); }
+
+// Same as MPSC with the intrusive queue: the producers take the
+// objects from a pool (intrusive stack), the consumer puts them back,
+// so nothing is allocated on the way
+class IntrusiveFix : public benchmark::Fixture {
+
+public:
+
+    struct Item : intrusive_hook {
+        int val_;
+    };
+
+    void SetUp(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            items = std::vector<Item>(kPoolSize * state.threads());
+            for (auto& item : items) {
+                pool.push(&item);
+            }
+        }
+    }
+
+    void TearDown(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            while(pool.pop());
+        }
+    }
+
+    static constexpr int kNumItems = 100000;
+    static constexpr int kPoolSize = 1024;
+    lock_free_intrusive_mpsc_queue<Item> q;
+    lock_free_intrusive_stack<Item> pool;
+    std::vector<Item> items;
+};
+
+BENCHMARK_DEFINE_F(IntrusiveFix, bench_mpsc)(benchmark::State& state) {
+
+    int producers = state.threads() - 1;
+    for (auto _ : state) {
+        if (state.thread_index() != 0) {
             for (int i = 0; i < kNumItems; ++i) {
-                q.pop();
-            }    
+                // The consumer has not given them back yet
+                Item* item;
+                while(!(item = pool.pop())) {
+                    std::this_thread::yield();
+                }
+                item->val_ = i;
+                q.push(item);
+            }
+        } else {
+            for (int i = 0; i < kNumItems * producers; ++i) {
+                Item* item;
+                while(!(item = q.pop())) {
+                    std::this_thread::yield();
+                }
+                pool.push(item);
+            }
         }
     }
     state.SetItemsProcessed(state.iterations() * kNumItems);
@@ -67,9 +196,33 @@ BENCHMARK_REGISTER_F(QueueFix, bench_pop)
     ->UseRealTime()
     ->Threads(1);
 
-BENCHMARK_REGISTER_F(QueueFix, bench_mpsc)
+BENCHMARK_REGISTER_F(MpscFix, bench_mpsc)
     ->Name("MPSC")
     ->UseRealTime()
     ->Unit(benchmark::kMicrosecond)
     ->ThreadRange(2, 32);
+
+BENCHMARK_REGISTER_F(MpscFix, bench_drain)
+    ->Name("MPSC/Drain")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->ThreadRange(2, 32);
+
+BENCHMARK_REGISTER_F(IntrusiveFix, bench_mpsc)
+    ->Name("MPSC/Intrusive")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->ThreadRange(2, 32);
+
+BENCHMARK_REGISTER_F(MpscFix, bench_std)
+    ->Name("MPSC/StdQueue")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->ThreadRange(2, 32);
+
+BENCHMARK_REGISTER_F(MpscFix, bench_fine)
+    ->Name("MPSC/FineQueue")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->ThreadRange(2, 32);
 BENCHMARK_MAIN();
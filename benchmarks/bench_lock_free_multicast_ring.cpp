@@ -0,0 +1,163 @@
+#include <benchmark/benchmark.h>
+#include "lock-free-multicast-ring.hpp"
+#include "lock-free-spsc-ring-queue.hpp"
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <thread>
+
+/*
+    Fan out of every event to three consumers (journaler, risk
+    checker, strategy): thread 0 produces kNumItems events, the
+    other three threads consume all of them.
+
+    Multicast -- one multicast ring, every consumer reads
+                 the events in place
+    Chain     -- the same, but the risk checker and the
+                 strategy run after the journaler
+    Queues    -- three spsc ring queues, the producer
+                 pushes a copy of the event into each
+*/
+
+static constexpr int kNumItems = 100'000;
+static constexpr int kConsumers = 3;
+
+struct Event {
+    long seq;
+    long payload[7];
+};
+
+class MulticastFix : public benchmark::Fixture {
+
+public:
+
+    void SetUp(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            ring = std::make_unique<lock_free_multicast_ring<Event>>(1024);
+            std::size_t journal = ring->add_consumer();
+            if (state.range(0)) {
+                ring->add_consumer({journal});
+                ring->add_consumer({journal});
+            } else {
+                ring->add_consumer();
+                ring->add_consumer();
+            }
+        }
+    }
+
+    void TearDown(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            ring.reset();
+        }
+    }
+
+    std::unique_ptr<lock_free_multicast_ring<Event>> ring;
+};
+
+BENCHMARK_DEFINE_F(MulticastFix, bench_multicast)(benchmark::State& state) {
+
+    std::size_t consumer = state.thread_index() - 1;
+    long sum = 0;
+    for (auto _ : state) {
+        if (state.thread_index() == 0) {
+            Event ev{};
+            for (int i = 0; i < kNumItems; ++i) {
+                ev.seq = i;
+                while (!ring->push(ev)) {
+                    std::this_thread::yield();
+                }
+            }
+            continue;
+        }
+        int count = 0;
+        while (count < kNumItems) {
+            std::size_t got = ring->read_bulk(consumer, [&sum](const Event& ev) {
+                sum += ev.seq;
+            }, std::min(64, kNumItems - count));
+            if (got == 0) {
+                std::this_thread::yield();
+            }
+            count += got;
+        }
+    }
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations() * kNumItems);
+}
+
+class QueuesFix : public benchmark::Fixture {
+
+public:
+
+    void SetUp(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            for (auto& q : queues) {
+                q = std::make_unique<lock_free_spsc_ring_queue<Event>>(1024);
+            }
+        }
+    }
+
+    void TearDown(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            for (auto& q : queues) {
+                q.reset();
+            }
+        }
+    }
+
+    std::array<std::unique_ptr<lock_free_spsc_ring_queue<Event>>, kConsumers> queues;
+};
+
+BENCHMARK_DEFINE_F(QueuesFix, bench_queues)(benchmark::State& state) {
+
+    long sum = 0;
+    for (auto _ : state) {
+        if (state.thread_index() == 0) {
+            Event ev{};
+            for (int i = 0; i < kNumItems; ++i) {
+                ev.seq = i;
+                for (auto& q : queues) {
+                    while (!q->push(ev)) {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+            continue;
+        }
+        auto& q = queues[state.thread_index() - 1];
+        Event ev;
+        for (int i = 0; i < kNumItems; ++i) {
+            while (!q->pop(ev)) {
+                std::this_thread::yield();
+            }
+            sum += ev.seq;
+        }
+    }
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations() * kNumItems);
+}
+
+BENCHMARK_REGISTER_F(MulticastFix, bench_multicast)
+    ->Name("Multicast")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->Arg(0)
+    ->Threads(kConsumers + 1);
+
+BENCHMARK_REGISTER_F(MulticastFix, bench_multicast)
+    ->Name("Chain")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->Arg(1)
+    ->Threads(kConsumers + 1);
+
+BENCHMARK_REGISTER_F(QueuesFix, bench_queues)
+    ->Name("Queues")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->Threads(kConsumers + 1);
+
+BENCHMARK_MAIN();
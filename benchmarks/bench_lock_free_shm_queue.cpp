@@ -0,0 +1,95 @@
+#include <benchmark/benchmark.h>
+#include "lock-free-shm-queue.hpp"
+#include <memory>
+#include <string>
+#include <unistd.h>
+
+/*
+    Shared memory queues. Each side works through its own
+    mapping of the segment (the pusher attaches by the name),
+    exactly as two processes would, only in one process,
+    so that the benchmark library can run them.
+
+    SPSC -- one producer streams kNumItems elements to one consumer
+    MPMC -- half of the threads push, the other half pops
+*/
+
+static constexpr int kNumItems = 100'000;
+
+template<template<class> class Q>
+class ShmFix : public benchmark::Fixture {
+
+public:
+
+    void SetUp(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            std::string name = "/lock_free_bench_" + std::to_string(::getpid());
+            owner = std::make_unique<Q<int>>(name, 1 << 16);
+            attached = std::make_unique<Q<int>>(name);
+        }
+    }
+
+    void TearDown(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            attached.reset();
+            owner.reset();
+        }
+    }
+
+    std::unique_ptr<Q<int>> owner;
+    std::unique_ptr<Q<int>> attached;
+};
+
+using SpscFix = ShmFix<lock_free_shm_spsc_queue>;
+using MpmcFix = ShmFix<lock_free_shm_mpmc_queue>;
+
+BENCHMARK_DEFINE_F(SpscFix, bench_spsc)(benchmark::State& state) {
+
+    bool pusher = (state.thread_index() == 1);
+    int val;
+    for (auto _ : state) {
+        if (pusher) {
+            for (int i = 0; i < kNumItems; ++i) {
+                while(!attached->push(i));
+            }
+        } else {
+            for (int i = 0; i < kNumItems; ++i) {
+                while(!owner->pop(val));
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kNumItems);
+}
+
+BENCHMARK_DEFINE_F(MpmcFix, bench_mpmc)(benchmark::State& state) {
+
+    bool pusher = state.thread_index() % 2;
+    int val;
+    for (auto _ : state) {
+        if (pusher) {
+            for (int i = 0; i < kNumItems; ++i) {
+                while(!attached->push(i));
+            }
+        } else {
+            for (int i = 0; i < kNumItems; ++i) {
+                while(!owner->pop(val));
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kNumItems);
+}
+
+BENCHMARK_REGISTER_F(SpscFix, bench_spsc)
+    ->Name("Shm/SPSC")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->Threads(2);
+
+BENCHMARK_REGISTER_F(MpmcFix, bench_mpmc)
+    ->Name("Shm/MPMC")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->ThreadRange(2, 32);
+BENCHMARK_MAIN();
@@ -0,0 +1,140 @@
+#include <benchmark/benchmark.h>
+#include "lock-free-spsc-queue.hpp"
+#include "lock-free-spsc-byte-ring.hpp"
+#include <cstring>
+#include <vector>
+
+/*
+    Variable-length messages through the linked SPSC queue
+    of std::vector<char> against the byte ring.
+
+    Write -- one thread writes a message of range(0) bytes and reads it back
+    SPSC  -- one producer streams kNumItems messages of range(0) bytes
+             to one consumer, that touches every message
+*/
+
+static constexpr int kNumItems = 100'000;
+
+inline void write_msg(lock_free_spsc_queue<std::vector<char>>& q, const char* msg, std::size_t len) {
+    q.push(std::vector<char>(msg, msg + len));
+}
+
+inline void write_msg(lock_free_spsc_byte_ring& r, const char* msg, std::size_t len) {
+    char* ptr;
+    while (!(ptr = r.reserve(len)));
+    std::memcpy(ptr, msg, len);
+    r.commit();
+}
+
+inline bool read_msg(lock_free_spsc_queue<std::vector<char>>& q, std::size_t& sum) {
+    std::vector<char> msg;
+    if (!q.pop(msg)) {
+        return false;
+    }
+    sum += msg.size() + msg[0];
+    return true;
+}
+
+inline bool read_msg(lock_free_spsc_byte_ring& r, std::size_t& sum) {
+    std::string_view msg = r.peek();
+    if (!msg.data()) {
+        return false;
+    }
+    sum += msg.size() + msg[0];
+    r.release();
+    return true;
+}
+
+template<class Q>
+void run_write(benchmark::State& state, Q& q) {
+    std::vector<char> msg(state.range(0), 'x');
+    std::size_t sum = 0;
+    for (auto _ : state) {
+        write_msg(q, msg.data(), msg.size());
+        read_msg(q, sum);
+    }
+    benchmark::DoNotOptimize(sum);
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+template<class Q>
+void run_spsc(benchmark::State& state, Q& q) {
+    bool pusher = (state.thread_index() == 1);
+    std::vector<char> msg(state.range(0), 'x');
+    std::size_t sum = 0;
+    for (auto _ : state) {
+        if (pusher) {
+            for (int i = 0; i < kNumItems; ++i) {
+                write_msg(q, msg.data(), msg.size());
+            }
+        } else {
+            for (int i = 0; i < kNumItems; ++i) {
+                while(!read_msg(q, sum));
+            }
+        }
+    }
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations() * kNumItems);
+    state.SetBytesProcessed(state.iterations() * kNumItems * state.range(0));
+}
+
+class ListFix : public benchmark::Fixture {
+
+public:
+
+    lock_free_spsc_queue<std::vector<char>> q;
+};
+
+class ByteRingFix : public benchmark::Fixture {
+
+public:
+
+    lock_free_spsc_byte_ring q{1 << 20};
+};
+
+BENCHMARK_DEFINE_F(ListFix, bench_write)(benchmark::State& state) {
+    run_write(state, q);
+}
+
+BENCHMARK_DEFINE_F(ByteRingFix, bench_write)(benchmark::State& state) {
+    run_write(state, q);
+}
+
+BENCHMARK_DEFINE_F(ListFix, bench_spsc)(benchmark::State& state) {
+    run_spsc(state, q);
+}
+
+BENCHMARK_DEFINE_F(ByteRingFix, bench_spsc)(benchmark::State& state) {
+    run_spsc(state, q);
+}
+
+BENCHMARK_REGISTER_F(ListFix, bench_write)
+    ->Name("List/Write")
+    ->UseRealTime()
+    ->RangeMultiplier(4)
+    ->Range(16, 1024)
+    ->Threads(1);
+
+BENCHMARK_REGISTER_F(ByteRingFix, bench_write)
+    ->Name("ByteRing/Write")
+    ->UseRealTime()
+    ->RangeMultiplier(4)
+    ->Range(16, 1024)
+    ->Threads(1);
+
+BENCHMARK_REGISTER_F(ListFix, bench_spsc)
+    ->Name("List/SPSC")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->RangeMultiplier(4)
+    ->Range(16, 1024)
+    ->Threads(2);
+
+BENCHMARK_REGISTER_F(ByteRingFix, bench_spsc)
+    ->Name("ByteRing/SPSC")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->RangeMultiplier(4)
+    ->Range(16, 1024)
+    ->Threads(2);
+BENCHMARK_MAIN();
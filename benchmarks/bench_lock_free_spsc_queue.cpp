@@ -3,6 +3,8 @@
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <memory>
+#include <cstdint>
 
 class QueueFix : public benchmark::Fixture {
     
@@ -55,6 +57,62 @@ BENCHMARK_DEFINE_F(QueueFix, bench_spsc)(benchmark::State& state) {
     state.SetItemsProcessed(state.iterations() * kNumItems);
 }
 
+// Lazy publication: the producer publishes the tail every
+// N elements (range(0)). Every element carries the time it was pushed,
+// so that the consumer can report the average delay,
+// that the batching adds, next to the throughput
+
+class LazyFix : public benchmark::Fixture {
+
+public:
+
+    void SetUp(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            q = std::make_unique<lock_free_spsc_queue<std::int64_t>>(state.range(0));
+        }
+    }
+
+    void TearDown(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            q.reset();
+        }
+    }
+
+    static std::int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    std::unique_ptr<lock_free_spsc_queue<std::int64_t>> q;
+    static constexpr int kNumItems = 100000;
+};
+
+BENCHMARK_DEFINE_F(LazyFix, bench_lazy_spsc)(benchmark::State& state) {
+
+    bool pusher = (state.thread_index() == 1);
+    std::int64_t stamp;
+    double latency = 0;
+    for (auto _ : state) {
+        if (pusher) {
+            for (int i = 0; i < kNumItems; ++i) {
+                q->push(now());
+            }
+            q->flush();
+        } else {
+            for (int i = 0; i < kNumItems; ++i) {
+                while(!q->pop(stamp));
+                latency += now() - stamp;
+            }
+        }
+    }
+    if (!pusher) {
+        state.counters["latency_ns"] = latency / (state.iterations() * kNumItems);
+    }
+    state.SetItemsProcessed(state.iterations() * kNumItems);
+}
+
 // Here write the amounts of threads that you want to use
 // 2, 4, 8, 16
 BENCHMARK_REGISTER_F(QueueFix, bench_push)
@@ -72,4 +130,14 @@ BENCHMARK_REGISTER_F(QueueFix, bench_spsc)
     ->UseRealTime()
     ->Unit(benchmark::kMicrosecond)
     ->Threads(2);
+
+BENCHMARK_REGISTER_F(LazyFix, bench_lazy_spsc)
+    ->Name("LazySPSC")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->Arg(1)
+    ->Arg(8)
+    ->Arg(32)
+    ->Arg(128)
+    ->Threads(2);
 BENCHMARK_MAIN();
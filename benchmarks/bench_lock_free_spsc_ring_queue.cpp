@@ -0,0 +1,310 @@
+#include <benchmark/benchmark.h>
+#include "lock-free-spsc-queue.hpp"
+#include "lock-free-spsc-ring-queue.hpp"
+#include <algorithm>
+#include <vector>
+
+/*
+    Linked SPSC queue against the ring SPSC queue.
+
+    Push     -- one thread pushes. The ring is bounded, therefore
+                when it is full we drain it with the timer paused
+    Pop      -- one thread pops from the prefilled queue
+    SPSC     -- one producer streams kNumItems elements to one consumer
+    PingPong -- two threads bounce one element through a pair of queues,
+                which measures the round trip latency
+    Bulk     -- one thread pushes a batch with push_bulk and pops it back
+                with pop_bulk, for batch sizes from 1 to 512
+    BulkSPSC -- same as SPSC, but both sides work with batches
+*/
+
+static constexpr int kNumItems = 100'000;
+
+// Helpers that hide the difference in the interface:
+// linked queue is unbounded, ring queue might be full
+
+inline bool try_push(lock_free_spsc_queue<int>& q, int val) {
+    q.push(val);
+    return true;
+}
+
+inline bool try_push(lock_free_spsc_ring_queue<int>& q, int val) {
+    return q.push(val);
+}
+
+inline void push_batch(lock_free_spsc_queue<int>& q, const int* first, const int* last) {
+    q.push_bulk(first, last);
+}
+
+inline void push_batch(lock_free_spsc_ring_queue<int>& q, const int* first, const int* last) {
+    while (first != last) {
+        first += q.push_bulk(first, last);
+    }
+}
+
+template<class Q>
+void run_push(benchmark::State& state, Q& q) {
+    int val;
+    for (auto _ : state) {
+        if (!try_push(q, 1)) {
+            state.PauseTiming();
+            while (q.pop(val));
+            state.ResumeTiming();
+        }
+    }
+}
+
+template<class Q>
+void run_pop(benchmark::State& state, Q& q) {
+    int val;
+    for (auto _ : state) {
+        if (!q.pop(val)) {
+            state.PauseTiming();
+            for (int i = 0; i < kNumItems && try_push(q, i); ++i);
+            state.ResumeTiming();
+        }
+    }
+}
+
+template<class Q>
+void run_spsc(benchmark::State& state, Q& q) {
+    bool pusher = (state.thread_index() == 1);
+    int val;
+    for (auto _ : state) {
+        if (pusher) {
+            for (int i = 0; i < kNumItems; ++i) {
+                while(!try_push(q, i));
+            }
+        } else {
+            for (int i = 0; i < kNumItems; ++i) {
+                while(!q.pop(val));
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kNumItems);
+}
+
+template<class Q>
+void run_ping_pong(benchmark::State& state, Q& ping, Q& pong) {
+    bool starter = (state.thread_index() == 0);
+    int val;
+    for (auto _ : state) {
+        for (int i = 0; i < kNumItems; ++i) {
+            if (starter) {
+                while(!try_push(ping, i));
+                while(!pong.pop(val));
+            } else {
+                while(!ping.pop(val));
+                while(!try_push(pong, val));
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kNumItems);
+}
+
+template<class Q>
+void run_bulk(benchmark::State& state, Q& q) {
+    std::size_t batch = state.range(0);
+    std::vector<int> in(batch, 1);
+    std::vector<int> out(batch);
+    for (auto _ : state) {
+        push_batch(q, in.data(), in.data() + batch);
+        q.pop_bulk(out.data(), batch);
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+
+template<class Q>
+void run_bulk_spsc(benchmark::State& state, Q& q) {
+    bool pusher = (state.thread_index() == 1);
+    int batch = state.range(0);
+    std::vector<int> buf(batch, 1);
+    for (auto _ : state) {
+        if (pusher) {
+            for (int i = 0; i < kNumItems; i += batch) {
+                int cnt = std::min(batch, kNumItems - i);
+                push_batch(q, buf.data(), buf.data() + cnt);
+            }
+        } else {
+            for (int i = 0; i < kNumItems; ) {
+                i += q.pop_bulk(buf.data(), std::min(batch, kNumItems - i));
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kNumItems);
+}
+
+class ListFix : public benchmark::Fixture {
+
+public:
+
+    void SetUp(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            for (int i = 0; i < kNumItems; ++i) {
+                q.push(1);
+            }
+        }
+    }
+
+    void TearDown(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            int val;
+            while(q.pop(val));
+        }
+    }
+
+    lock_free_spsc_queue<int> q;
+    lock_free_spsc_queue<int> ping;
+    lock_free_spsc_queue<int> pong;
+};
+
+class RingFix : public benchmark::Fixture {
+
+public:
+
+    void SetUp(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            for (int i = 0; i < kNumItems; ++i) {
+                q.push(1);
+            }
+        }
+    }
+
+    void TearDown(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            int val;
+            while(q.pop(val));
+        }
+    }
+
+    lock_free_spsc_ring_queue<int> q{1 << 20};
+    lock_free_spsc_ring_queue<int> ping{1024};
+    lock_free_spsc_ring_queue<int> pong{1024};
+};
+
+BENCHMARK_DEFINE_F(ListFix, bench_push)(benchmark::State& state) {
+    run_push(state, q);
+}
+
+BENCHMARK_DEFINE_F(RingFix, bench_push)(benchmark::State& state) {
+    run_push(state, q);
+}
+
+BENCHMARK_DEFINE_F(ListFix, bench_pop)(benchmark::State& state) {
+    run_pop(state, q);
+}
+
+BENCHMARK_DEFINE_F(RingFix, bench_pop)(benchmark::State& state) {
+    run_pop(state, q);
+}
+
+BENCHMARK_DEFINE_F(ListFix, bench_spsc)(benchmark::State& state) {
+    run_spsc(state, q);
+}
+
+BENCHMARK_DEFINE_F(RingFix, bench_spsc)(benchmark::State& state) {
+    run_spsc(state, q);
+}
+
+BENCHMARK_DEFINE_F(ListFix, bench_ping_pong)(benchmark::State& state) {
+    run_ping_pong(state, ping, pong);
+}
+
+BENCHMARK_DEFINE_F(RingFix, bench_ping_pong)(benchmark::State& state) {
+    run_ping_pong(state, ping, pong);
+}
+
+BENCHMARK_DEFINE_F(ListFix, bench_bulk)(benchmark::State& state) {
+    run_bulk(state, q);
+}
+
+BENCHMARK_DEFINE_F(RingFix, bench_bulk)(benchmark::State& state) {
+    run_bulk(state, q);
+}
+
+BENCHMARK_DEFINE_F(ListFix, bench_bulk_spsc)(benchmark::State& state) {
+    run_bulk_spsc(state, q);
+}
+
+BENCHMARK_DEFINE_F(RingFix, bench_bulk_spsc)(benchmark::State& state) {
+    run_bulk_spsc(state, q);
+}
+
+BENCHMARK_REGISTER_F(ListFix, bench_push)
+    ->Name("List/Push")
+    ->UseRealTime()
+    ->Threads(1);
+
+BENCHMARK_REGISTER_F(RingFix, bench_push)
+    ->Name("Ring/Push")
+    ->UseRealTime()
+    ->Threads(1);
+
+BENCHMARK_REGISTER_F(ListFix, bench_pop)
+    ->Name("List/Pop")
+    ->UseRealTime()
+    ->Threads(1);
+
+BENCHMARK_REGISTER_F(RingFix, bench_pop)
+    ->Name("Ring/Pop")
+    ->UseRealTime()
+    ->Threads(1);
+
+BENCHMARK_REGISTER_F(ListFix, bench_spsc)
+    ->Name("List/SPSC")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->Threads(2);
+
+BENCHMARK_REGISTER_F(RingFix, bench_spsc)
+    ->Name("Ring/SPSC")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->Threads(2);
+
+BENCHMARK_REGISTER_F(ListFix, bench_ping_pong)
+    ->Name("List/PingPong")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->Threads(2);
+
+BENCHMARK_REGISTER_F(RingFix, bench_ping_pong)
+    ->Name("Ring/PingPong")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->Threads(2);
+
+BENCHMARK_REGISTER_F(ListFix, bench_bulk)
+    ->Name("List/Bulk")
+    ->UseRealTime()
+    ->RangeMultiplier(4)
+    ->Range(1, 512)
+    ->Threads(1);
+
+BENCHMARK_REGISTER_F(RingFix, bench_bulk)
+    ->Name("Ring/Bulk")
+    ->UseRealTime()
+    ->RangeMultiplier(4)
+    ->Range(1, 512)
+    ->Threads(1);
+
+BENCHMARK_REGISTER_F(ListFix, bench_bulk_spsc)
+    ->Name("List/BulkSPSC")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->RangeMultiplier(4)
+    ->Range(1, 512)
+    ->Threads(2);
+
+BENCHMARK_REGISTER_F(RingFix, bench_bulk_spsc)
+    ->Name("Ring/BulkSPSC")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->RangeMultiplier(4)
+    ->Range(1, 512)
+    ->Threads(2);
+BENCHMARK_MAIN();
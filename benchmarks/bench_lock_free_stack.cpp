@@ -1,5 +1,7 @@
 #include <benchmark/benchmark.h>
 #include "lock-free-stack.hpp"
+#include <memory>
+#include <vector>
 
 class StackFix : public benchmark::Fixture {
     
@@ -57,6 +59,89 @@ BENCHMARK_DEFINE_F(StackFix, bench_mpmc)(benchmark::State& state) {
     state.SetItemsProcessed(state.iterations() * kNumItems);
 }
 
+// Thread 0 takes everything with drain, the other threads push
+BENCHMARK_DEFINE_F(StackFix, bench_drain)(benchmark::State& state) {
+
+    int producers = state.threads() - 1;
+    long sum = 0;
+    int carry = 0;
+    for (auto _ : state) {
+        if (state.thread_index() != 0) {
+            for (int i = 0; i < kNumItems; ++i) {
+                q.push(i);
+            }
+        } else {
+            // The elements of SetUp are there too.
+            // A drain can take the elements of the next
+            // iteration too, they are counted there
+            int i = carry;
+            while (i < kNumItems * producers) {
+                i += q.drain([&sum](std::shared_ptr<int> val) { sum += *val; });
+            }
+            carry = i - kNumItems * producers;
+        }
+    }
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations() * kNumItems);
+}
+
+// Every thread takes an element and puts it back, as with a pool
+// of free objects: the owning stack allocates a node and a
+// shared_ptr on every push, the intrusive one links the object
+BENCHMARK_DEFINE_F(StackFix, bench_pop_push)(benchmark::State& state) {
+
+    for (auto _ : state) {
+        for (int i = 0; i < kNumItems; ++i) {
+            std::shared_ptr<int> res;
+            while(!(res = q.pop()));
+            q.push(*res);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kNumItems);
+}
+
+class IntrusiveFix : public benchmark::Fixture {
+
+public:
+
+    struct Item : intrusive_hook {
+        int val_;
+    };
+
+    void SetUp(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            items = std::vector<Item>(kNumItems);
+            for (auto& item : items) {
+                q.push(&item);
+            }
+        }
+    }
+
+    void TearDown(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            while(q.pop());
+        }
+    }
+
+  lock_free_intrusive_stack<Item> q;
+  std::vector<Item> items;
+  static constexpr int kNumItems = 100000;
+};
+
+BENCHMARK_DEFINE_F(IntrusiveFix, bench_pop_push)(benchmark::State& state) {
+
+    for (auto _ : state) {
+        for (int i = 0; i < kNumItems; ++i) {
+            Item* item;
+            while(!(item = q.pop()));
+            q.push(item);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kNumItems);
+}
+
 // Here write the amounts of threads that you want to use
 // 2, 4, 8, 16
 // Also you might want to use RealTime()
@@ -75,4 +160,22 @@ BENCHMARK_REGISTER_F(StackFix, bench_mpmc)
     ->UseRealTime()
     ->Unit(benchmark::kMicrosecond)
     ->ThreadRange(2, 8);
+
+BENCHMARK_REGISTER_F(StackFix, bench_drain)
+    ->Name("Drain")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->ThreadRange(2, 8);
+
+BENCHMARK_REGISTER_F(StackFix, bench_pop_push)
+    ->Name("PopPush")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->ThreadRange(1, 8);
+
+BENCHMARK_REGISTER_F(IntrusiveFix, bench_pop_push)
+    ->Name("PopPush/Intrusive")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->ThreadRange(1, 8);
 BENCHMARK_MAIN();
@@ -0,0 +1,148 @@
+#include <benchmark/benchmark.h>
+#include "lock-free-work-stealing-deque.hpp"
+#include "lock-free-spmc-queue.hpp"
+#include <memory>
+#include <thread>
+
+/*
+    Thread 0 owns the deque, the other threads are thieves.
+
+    StealHeavy -- the owner only pushes, kNumItems per thief,
+                  and the thieves steal all of them
+    SPMC       -- the same with lock_free_spmc_queue, every
+                  pop pays the reference counting cas
+    OwnerHeavy -- the owner pushes kNumItems and pops every other
+                  one back (then the rest), the thieves steal
+                  now and then, as idle workers of a scheduler
+*/
+
+static constexpr int kNumItems = 100'000;
+static constexpr int kStealEvery = 64;
+
+class DequeFix : public benchmark::Fixture {
+
+public:
+
+    void SetUp(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            dq = std::make_unique<lock_free_work_stealing_deque<int>>();
+        }
+    }
+
+    void TearDown(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            dq.reset();
+        }
+    }
+
+    std::unique_ptr<lock_free_work_stealing_deque<int>> dq;
+};
+
+BENCHMARK_DEFINE_F(DequeFix, bench_steal_heavy)(benchmark::State& state) {
+
+    int thieves = state.threads() - 1;
+    int val;
+    for (auto _ : state) {
+        if (state.thread_index() == 0) {
+            for (int i = 0; i < kNumItems * thieves; ++i) {
+                dq->push(i);
+            }
+        } else {
+            for (int i = 0; i < kNumItems; ++i) {
+                while (!dq->steal(val)) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kNumItems);
+}
+
+BENCHMARK_DEFINE_F(DequeFix, bench_owner_heavy)(benchmark::State& state) {
+
+    int val;
+    long stolen = 0;
+    for (auto _ : state) {
+        if (state.thread_index() == 0) {
+            for (int i = 0; i < kNumItems; ++i) {
+                dq->push(i);
+                if (i % 2) {
+                    dq->pop(val);
+                }
+            }
+            while (dq->pop(val));
+        } else {
+            for (int i = 0; i < kNumItems / kStealEvery; ++i) {
+                stolen += dq->steal(val);
+                std::this_thread::yield();
+            }
+        }
+    }
+    if (state.thread_index() == 0) {
+        state.SetItemsProcessed(state.iterations() * kNumItems);
+    } else {
+        state.counters["stolen"] = stolen;
+    }
+}
+
+class SpmcFix : public benchmark::Fixture {
+
+public:
+
+    void SetUp(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            q = std::make_unique<lock_free_spmc_queue<int>>();
+        }
+    }
+
+    void TearDown(::benchmark::State& state) override
+    {
+        if (state.thread_index() == 0) {
+            q.reset();
+        }
+    }
+
+    std::unique_ptr<lock_free_spmc_queue<int>> q;
+};
+
+BENCHMARK_DEFINE_F(SpmcFix, bench_spmc)(benchmark::State& state) {
+
+    int consumers = state.threads() - 1;
+    for (auto _ : state) {
+        if (state.thread_index() == 0) {
+            for (int i = 0; i < kNumItems * consumers; ++i) {
+                q->push(i);
+            }
+        } else {
+            for (int i = 0; i < kNumItems; ++i) {
+                while (!q->pop()) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kNumItems);
+}
+
+BENCHMARK_REGISTER_F(DequeFix, bench_steal_heavy)
+    ->Name("StealHeavy")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->ThreadRange(2, 16);
+
+BENCHMARK_REGISTER_F(SpmcFix, bench_spmc)
+    ->Name("SPMC")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->ThreadRange(2, 16);
+
+BENCHMARK_REGISTER_F(DequeFix, bench_owner_heavy)
+    ->Name("OwnerHeavy")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->ThreadRange(2, 16);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+
+/*
+    Size of the unit of cache coherence on the machines
+    we target (x86-64 and most of AArch64).
+
+    Data that is written by different threads is kept
+    at least that far apart, so that a store of one thread
+    does not invalidate the line the other thread is reading.
+
+    We do not use std::hardware_destructive_interference_size,
+    since not every standard library ships it, and gcc warns
+    that its value is not stable across compiler flags.
+*/
+
+constexpr std::size_t cache_line_size = 64;
+
+/*
+    Layout policies. The containers take one of them as a template
+    parameter, and align their hot members with it:
+
+    -> index_align -- alignment of the members, that are written by
+       different sides (head and tail indices, hazard pointer records)
+    -> cell_align  -- alignment of every cell (node) of the container
+
+    0 means the natural alignment of the member, i.e. packed.
+
+    layout_packed       -- everything packed, the least memory
+    layout_padded       -- the indices on their own cache lines, the
+                           cells packed (default of all the containers)
+    layout_padded_cells -- every cell on its own cache line too, for
+                           small queues with many threads fighting
+                           for the neighbouring cells
+*/
+
+struct layout_packed {
+    static constexpr std::size_t index_align = 0;
+    static constexpr std::size_t cell_align  = 0;
+};
+
+struct layout_padded {
+    static constexpr std::size_t index_align = cache_line_size;
+    static constexpr std::size_t cell_align  = 0;
+};
+
+struct layout_padded_cells {
+    static constexpr std::size_t index_align = cache_line_size;
+    static constexpr std::size_t cell_align  = cache_line_size;
+};
+
+// Alignment of the member of type X under the layout
+// alignment Align: never weaker than its own alignment
+template<class X, std::size_t Align>
+constexpr std::size_t layout_align = (Align > alignof(X)) ? Align : alignof(X);
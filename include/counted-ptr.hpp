@@ -0,0 +1,323 @@
+#pragma once
+
+#include "dwcas.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <assert.h>
+
+/*
+
+    Pointer together with the external reference counter (see
+    lock_free_spmc_queue), that can be changed by one cas.
+
+    The plain struct { N* ptr; int count; } takes 16 bytes on 64 bit
+    machines, and std::atomic of it is lock-free only with cmpxchg16b,
+    which the compiler does not use without -mcx16, so libatomic puts
+    a lock around every operation. atomic_counted_ptr avoids that:
+
+    -> x86-64 and AArch64 -- the user space pointers have only 48
+       significant bits (the upper 16 bits are zero), and the lowest
+       log2(alignof(N)) bits of them are zero too, so the counter is kept
+       in these bits (up to 6 low ones), and the pair fits into one 64 bit
+       word, a plain lock-free 64 bit atomic:
+
+        | count (16 + low bits) | pointer >> low bits |
+
+       That is 16 bits of the counter for the unaligned N, and 22 bits for
+       N aligned to 64 bytes. The counter does not wrap around silently:
+       MAX_COUNT is its largest value, and the users have to stop there
+       (lock_free_spmc_queue waits for the node to be unlinked, whose
+       counter grows with every pop attempt until then; the ABA tag of
+       lock_free_intrusive_stack starts from 0 again).
+
+    -> x86-64 with COUNTED_PTR_DWCAS defined, and the CPU has cmpxchg16b
+       (checked at runtime, see dwcas.hpp) -- the pointer and the counter
+       are two words of one 16 byte cell, changed by cmpxchg16b. Only for
+       the processes that map memory above 2^47 (5-level paging with high
+       mmap hints), whose pointers do not fit into 48 bits: every load is
+       a locked cas too, that writes the line of the cell. The counter has
+       the whole second word, max_count() is INT64_MAX then.
+
+    -> on the other machines -- std::atomic of the struct, as it was.
+
+    The way is chosen once per process, so all the cells use the same one.
+
+*/
+
+#if defined(__x86_64__) || defined(__aarch64__)
+constexpr bool counted_ptr_packed = true;
+#else
+constexpr bool counted_ptr_packed = false;
+#endif
+
+// Low bits of the pointers to N that are always zero (up to 6),
+// the packed word gives them to the counter
+template<class N>
+constexpr int counted_ptr_low_bits() {
+    int bits = 0;
+    while (bits < 6 && (std::size_t(1) << (bits + 1)) <= alignof(N)) {
+        ++bits;
+    }
+    return bits;
+}
+
+template<class N>
+class counted_ptr {
+
+public:
+
+    counted_ptr(N* ptr = nullptr, std::int64_t count = 0)
+    : ptr_(ptr)
+    , count_(count)
+    {}
+
+    N* ptr() const {
+        return ptr_;
+    }
+
+    std::int64_t count() const {
+        return count_;
+    }
+
+    void set_ptr(N* ptr) {
+        ptr_ = ptr;
+    }
+
+    void set_count(std::int64_t count) {
+        count_ = count;
+    }
+
+private:
+
+    N* ptr_;
+    std::int64_t count_;
+};
+
+template<class N>
+class atomic_counted_ptr {
+
+public:
+
+    // Both cmpxchg16b and the packed word are lock-free
+    static constexpr bool is_always_lock_free = counted_ptr_packed;
+
+    // The packed word has 16 bits for the counter, and the low bits
+    static constexpr std::int64_t MAX_COUNT = counted_ptr_packed ?
+                                              (std::int64_t(1) << (16 + counted_ptr_low_bits<N>())) - 1 :
+                                              INT64_MAX;
+
+    atomic_counted_ptr(counted_ptr<N> val = counted_ptr<N>());
+
+    atomic_counted_ptr(const atomic_counted_ptr&) = delete;
+    atomic_counted_ptr& operator = (const atomic_counted_ptr&) = delete;
+
+    counted_ptr<N> load(std::memory_order order = std::memory_order_seq_cst) const;
+
+    void store(counted_ptr<N> val, std::memory_order order = std::memory_order_seq_cst);
+
+    // Same as of std::atomic: on failure expected gets the current value
+    bool compare_exchange_strong(counted_ptr<N>& expected, counted_ptr<N> desired,
+                                 std::memory_order success, std::memory_order failure);
+
+    bool compare_exchange_strong(counted_ptr<N>& expected, counted_ptr<N> desired,
+                                 std::memory_order order = std::memory_order_seq_cst) {
+        std::memory_order failure = (order == std::memory_order_acq_rel) ? std::memory_order_acquire :
+                                    (order == std::memory_order_release) ? std::memory_order_relaxed : order;
+        return compare_exchange_strong(expected, desired, order, failure);
+    }
+
+    counted_ptr<N> exchange(counted_ptr<N> val, std::memory_order order = std::memory_order_seq_cst) {
+        counted_ptr<N> old = load(std::memory_order_relaxed);
+        while (!compare_exchange_strong(old, val, order, std::memory_order_relaxed));
+        return old;
+    }
+
+    bool is_lock_free() const;
+
+    // true if the process goes through cmpxchg16b,
+    // false -- through the packed word (or the struct)
+    static bool uses_dwcas() {
+#if defined(__x86_64__) && defined(COUNTED_PTR_DWCAS)
+        return dwcas_supported();
+#else
+        return false;
+#endif
+    }
+
+    // Largest counter of the way the process goes through:
+    // MAX_COUNT, or the whole word with cmpxchg16b
+    static std::int64_t max_count() {
+        return uses_dwcas() ? INT64_MAX : MAX_COUNT;
+    }
+
+private:
+
+#if defined(__x86_64__) || defined(__aarch64__)
+
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+                  "packed counted pointer has to be a lock-free 64 bit atomic");
+
+    static constexpr int PTR_BITS = 48;
+    static constexpr std::uint64_t PTR_MASK = (std::uint64_t(1) << PTR_BITS) - 1;
+
+    // Not members, N is incomplete, when the class is
+    // (atomic_counted_ptr<Node> inside of Node)
+    static constexpr int low_bits() {
+        return counted_ptr_low_bits<N>();
+    }
+
+    static constexpr int count_shift() {
+        return PTR_BITS - low_bits();
+    }
+
+    static std::uint64_t pack(counted_ptr<N> val) {
+        std::uintptr_t ptr = reinterpret_cast<std::uintptr_t>(val.ptr());
+        assert((ptr & ~PTR_MASK) == 0 &&
+               "the pointer does not fit into 48 bits, define COUNTED_PTR_DWCAS");
+        assert((ptr & ((std::uintptr_t(1) << low_bits()) - 1)) == 0 && "the pointer is not aligned");
+        assert(val.count() >= 0 && val.count() <= MAX_COUNT && "the counter does not fit");
+        return (static_cast<std::uint64_t>(val.count()) << count_shift()) | (ptr >> low_bits());
+    }
+
+    static counted_ptr<N> unpack(std::uint64_t word) {
+        std::uint64_t ptr_bits = word & ((std::uint64_t(1) << count_shift()) - 1);
+        return counted_ptr<N>(reinterpret_cast<N*>(static_cast<std::uintptr_t>(ptr_bits << low_bits())),
+                              static_cast<std::int64_t>(word >> count_shift()));
+    }
+
+#if defined(__x86_64__) && defined(COUNTED_PTR_DWCAS)
+
+    static dw_word to_dw(counted_ptr<N> val) {
+        return dw_word{reinterpret_cast<std::uintptr_t>(val.ptr()), static_cast<std::uint64_t>(val.count())};
+    }
+
+    static counted_ptr<N> from_dw(dw_word word) {
+        return counted_ptr<N>(reinterpret_cast<N*>(static_cast<std::uintptr_t>(word.lo)),
+                              static_cast<std::int64_t>(word.hi));
+    }
+
+    dw_word* dw() const {
+        return reinterpret_cast<dw_word*>(const_cast<std::atomic<std::uint64_t>*>(&lo_));
+    }
+
+#endif
+
+#if defined(__x86_64__) && defined(COUNTED_PTR_DWCAS)
+
+    // The packed word is in lo_. With cmpxchg16b
+    // the pointer is in lo_ and the counter in hi_
+    alignas(16) std::atomic<std::uint64_t> lo_;
+    std::atomic<std::uint64_t>             hi_;
+
+#else
+
+    std::atomic<std::uint64_t> lo_;
+
+#endif
+
+#else
+
+    std::atomic<counted_ptr<N>> wide_;
+
+#endif
+};
+
+#if defined(__x86_64__) || defined(__aarch64__)
+
+template<class N>
+atomic_counted_ptr<N>::atomic_counted_ptr(counted_ptr<N> val)
+: lo_(0)
+#if defined(__x86_64__) && defined(COUNTED_PTR_DWCAS)
+, hi_(0)
+#endif
+{
+    store(val, std::memory_order_relaxed);
+}
+
+template<class N>
+counted_ptr<N> atomic_counted_ptr<N>::load(std::memory_order order) const {
+
+#if defined(__x86_64__) && defined(COUNTED_PTR_DWCAS)
+    if (uses_dwcas()) {
+        return from_dw(dwload(dw()));
+    }
+#endif
+    return unpack(lo_.load(order));
+}
+
+template<class N>
+void atomic_counted_ptr<N>::store(counted_ptr<N> val, std::memory_order order) {
+
+#if defined(__x86_64__) && defined(COUNTED_PTR_DWCAS)
+    if (uses_dwcas()) {
+        dw_word expected = dwload(dw());
+        while (!dwcas(dw(), expected, to_dw(val)));
+        return;
+    }
+#endif
+    lo_.store(pack(val), order);
+}
+
+template<class N>
+bool atomic_counted_ptr<N>::compare_exchange_strong(counted_ptr<N>& expected, counted_ptr<N> desired,
+                                                    std::memory_order success, std::memory_order failure) {
+
+#if defined(__x86_64__) && defined(COUNTED_PTR_DWCAS)
+    if (uses_dwcas()) {
+        dw_word word = to_dw(expected);
+        if (dwcas(dw(), word, to_dw(desired))) {
+            return true;
+        }
+        expected = from_dw(word);
+        return false;
+    }
+#endif
+    std::uint64_t word = pack(expected);
+    if (lo_.compare_exchange_strong(word, pack(desired), success, failure)) {
+        return true;
+    }
+    expected = unpack(word);
+    return false;
+}
+
+template<class N>
+bool atomic_counted_ptr<N>::is_lock_free() const {
+
+    return true;
+}
+
+#else
+
+template<class N>
+atomic_counted_ptr<N>::atomic_counted_ptr(counted_ptr<N> val)
+: wide_(val)
+{}
+
+template<class N>
+counted_ptr<N> atomic_counted_ptr<N>::load(std::memory_order order) const {
+
+    return wide_.load(order);
+}
+
+template<class N>
+void atomic_counted_ptr<N>::store(counted_ptr<N> val, std::memory_order order) {
+
+    wide_.store(val, order);
+}
+
+template<class N>
+bool atomic_counted_ptr<N>::compare_exchange_strong(counted_ptr<N>& expected, counted_ptr<N> desired,
+                                                    std::memory_order success, std::memory_order failure) {
+
+    return wide_.compare_exchange_strong(expected, desired, success, failure);
+}
+
+template<class N>
+bool atomic_counted_ptr<N>::is_lock_free() const {
+
+    return wide_.is_lock_free();
+}
+
+#endif
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+/*
+
+    Double width compare and swap: one cas over two adjacent 64 bit
+    words (a pointer and a counter), with the cmpxchg16b instruction.
+
+    The first x86-64 CPUs did not have cmpxchg16b, that is why the
+    compilers do not use it without -mcx16, and std::atomic of 16 bytes
+    goes to libatomic. Here the instruction is written with inline
+    assembly, and whether it can be used is found out at runtime with
+    cpuid, so the binary still runs on the old CPUs: the callers check
+    dwcas_supported() and take another way (see atomic_counted_ptr in
+    counted-ptr.hpp), if it is false.
+
+    ThreadSanitizer does not see inline assembly, so under it
+    dwcas_supported() is always false.
+
+*/
+
+struct alignas(16) dw_word {
+    std::uint64_t lo;
+    std::uint64_t hi;
+};
+
+inline bool dwcas_supported() {
+
+#if defined(__x86_64__) && !defined(__SANITIZE_THREAD__)
+    static const bool res = []() {
+        unsigned eax, ebx, ecx, edx;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+            return false;
+        }
+        return (ecx & bit_CMPXCHG16B) != 0;
+    }();
+    return res;
+#else
+    return false;
+#endif
+}
+
+#if defined(__x86_64__)
+
+// If *target == expected, writes desired there and returns true,
+// otherwise loads *target into expected and returns false.
+// Full barrier (lock prefix). Only if dwcas_supported()
+inline bool dwcas(dw_word* target, dw_word& expected, const dw_word& desired) {
+
+    bool res;
+    __asm__ __volatile__("lock cmpxchg16b %1"
+                         : "=@ccz"(res), "+m"(*target), "+a"(expected.lo), "+d"(expected.hi)
+                         : "b"(desired.lo), "c"(desired.hi)
+                         : "memory");
+    return res;
+}
+
+// Atomic load of both words. There is no plain 16 byte atomic load,
+// so it is a cas, that writes the same value, if it succeeds
+inline dw_word dwload(dw_word* target) {
+
+    dw_word expected{0, 0};
+    dwcas(target, expected, expected);
+    return expected;
+}
+
+#endif
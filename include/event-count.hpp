@@ -0,0 +1,235 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cerrno>
+#include <cstdint>
+#include <ctime>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/*
+
+    Event count -- the way for a thread to sleep until a lock-free
+    container has something for it, without putting a lock on the
+    way of the threads that do not sleep.
+
+    Members
+
+    -> epoch   -- 32 bit word, that the sleepers wait on with futex
+    -> waiters -- number of threads that are going to sleep
+
+    AWAIT(ready)
+
+    1. Spin for a while calling ready(), then yield for a while
+    2. Announce that we are going to sleep: waiters + 1, remember the epoch
+    3. Check ready() once more
+        -> if it succeeded, waiters - 1 and return
+    4. Sleep on the epoch, as long as it is the one we remembered
+        (futex returns at once, if the epoch has changed already)
+    5. waiters - 1, and go to 2
+
+    NOTIFY
+
+    1. Full fence, then load the waiters
+        -> if nobody is going to sleep, return: no syscall on the fast path
+    2. epoch + 1 and wake the sleepers with futex
+
+    The producer makes its element visible, then reads waiters. The consumer
+    increments waiters, then looks for the element. Both of them have a full
+    fence in between, so at least one of them sees the other: either the
+    producer sees the waiter and wakes it, or the waiter sees the element
+    and does not sleep. If the producer comes between 2 and 4, it changes
+    the epoch, and the futex does not let the waiter sleep on the old one.
+
+    Timed versions sleep with FUTEX_WAIT_BITSET, which takes an absolute
+    deadline of CLOCK_MONOTONIC, the clock of std::chrono::steady_clock.
+
+*/
+
+class event_count {
+
+public:
+
+    event_count()
+    : epoch_(0)
+    , waiters_(0)
+    {}
+
+    event_count(const event_count&) = delete;
+    event_count& operator = (const event_count&) = delete;
+
+    // Returns when ready() returns true
+    template<class F>
+    void await(F&& ready);
+
+    // Returns false, if ready() did not return true before the deadline
+    template<class F, class Duration>
+    bool await_until(F&& ready, const std::chrono::time_point<std::chrono::steady_clock, Duration>& deadline);
+
+    template<class F, class Rep, class Period>
+    bool await_for(F&& ready, const std::chrono::duration<Rep, Period>& timeout) {
+        return await_until(std::forward<F>(ready), std::chrono::steady_clock::now() + timeout);
+    }
+
+    void notify_one() {
+        notify(1);
+    }
+
+    void notify_all() {
+        notify(INT32_MAX);
+    }
+
+    // Busy waits for ready() without sleeping, for the waits that
+    // end as soon as another thread runs a few instructions: spins
+    // with pause, then yields, so that the thread it waits for can
+    // run on the same core
+    template<class F>
+    static void spin_until(F&& ready);
+
+private:
+
+    static constexpr int spin_count_ = 64;
+    static constexpr int yield_count_ = 16;
+
+    // Loads the waiters with a full fence before it. TSan does
+    // not support fences, so there it is a read-modify-write,
+    // which gives the same order
+    std::uint32_t load_waiters() {
+#if defined(__SANITIZE_THREAD__)
+        return waiters_.fetch_add(0, std::memory_order_seq_cst);
+#else
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return waiters_.load(std::memory_order_relaxed);
+#endif
+    }
+
+    // Announces one more waiter, with a full fence after it
+    void add_waiter() {
+        waiters_.fetch_add(1, std::memory_order_seq_cst);
+#if !defined(__SANITIZE_THREAD__)
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+#endif
+    }
+
+    static void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+
+    template<class F>
+    bool try_spin(F& ready);
+
+    void notify(int count);
+
+    // Sleeps while the epoch is equal to key, deadline == nullptr
+    // means no deadline. Returns false on timeout
+    bool wait(std::uint32_t key, const struct timespec* deadline);
+
+    std::atomic<std::uint32_t> epoch_;
+    std::atomic<std::uint32_t> waiters_;
+};
+
+template<class F>
+bool event_count::try_spin(F& ready) {
+
+    for (int i = 0; i < spin_count_; ++i) {
+        if (ready()) {
+            return true;
+        }
+        cpu_relax();
+    }
+    for (int i = 0; i < yield_count_; ++i) {
+        if (ready()) {
+            return true;
+        }
+        std::this_thread::yield();
+    }
+    return false;
+}
+
+template<class F>
+void event_count::spin_until(F&& ready) {
+
+    for (int i = 0; !ready(); ++i) {
+        if (i < spin_count_) {
+            cpu_relax();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+template<class F>
+void event_count::await(F&& ready) {
+
+    if (try_spin(ready)) {
+        return;
+    }
+    for (;;) {
+        add_waiter();
+        std::uint32_t key = epoch_.load(std::memory_order_seq_cst);
+        if (ready()) {
+            waiters_.fetch_sub(1, std::memory_order_relaxed);
+            return;
+        }
+        wait(key, nullptr);
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+template<class F, class Duration>
+bool event_count::await_until(F&& ready, const std::chrono::time_point<std::chrono::steady_clock, Duration>& deadline) {
+
+    if (try_spin(ready)) {
+        return true;
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+    struct timespec ts;
+    ts.tv_sec = ns / 1'000'000'000;
+    ts.tv_nsec = ns % 1'000'000'000;
+    for (;;) {
+        add_waiter();
+        std::uint32_t key = epoch_.load(std::memory_order_seq_cst);
+        if (ready()) {
+            waiters_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+        bool in_time = wait(key, &ts);
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+        if (!in_time) {
+            // One last chance, the element might
+            // have come together with the timeout
+            return ready();
+        }
+    }
+}
+
+inline void event_count::notify(int count) {
+
+    if (load_waiters() == 0) {
+        return;
+    }
+    epoch_.fetch_add(1, std::memory_order_seq_cst);
+    ::syscall(SYS_futex, &epoch_, FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+}
+
+inline bool event_count::wait(std::uint32_t key, const struct timespec* deadline) {
+
+    // The futex syscall works with the plain 32 bit word
+    static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t),
+                  "futex needs the atomic to be a plain 32 bit word");
+
+    long res;
+    if (deadline) {
+        res = ::syscall(SYS_futex, &epoch_, FUTEX_WAIT_BITSET_PRIVATE, key,
+                        deadline, nullptr, FUTEX_BITSET_MATCH_ANY);
+    } else {
+        res = ::syscall(SYS_futex, &epoch_, FUTEX_WAIT_PRIVATE, key, nullptr, nullptr, 0);
+    }
+    return res == 0 || errno != ETIMEDOUT;
+}
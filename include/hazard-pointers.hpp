@@ -1,10 +1,16 @@
 #pragma once
 
+#include "cache-line.hpp"
+
 #include <atomic>
 #include <memory>
 #include <assert.h>
 #include <iostream>
 #include <mutex>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <functional>
 
 /*
     Hazard pointers plan
@@ -30,17 +36,149 @@
             -> walk through the list
             -> delete nodes that we can delete
             -> save nodes that we cannot delete
+
+    4. Thread cache
+
+        Walking the list and doing a cas on every record for every
+        pop costs O(number of records) atomics. So every thread keeps
+        the record it has got from a domain (hazard_pointers object)
+        in its thread local cache, and owns it until it exits: the
+        record stays active for the other threads, and acquire and
+        release of the owner are plain stores on it. If the owner needs
+        a second hazard at the same time, it takes one from the list
+        as before.
+
+        When the thread exits, or the cache needs the slot for another
+        domain, the record goes back to its domain (active = false). A
+        record that is in use (busy) is never evicted: if all the slots
+        are busy, the new record is not cached and is released to the
+        list as before.
+
+        The domain can be destroyed before its records go back, so the
+        domain and every cache entry with its record share a small
+        block (hazard_domain) with a flag and a lock of its own: the
+        record goes back only if the flag says the domain is still
+        there, and the destructor of the domain clears the flag under
+        the same lock. Only the giving back and the destructor take
+        this lock, and each domain has its own, acquire and release
+        do not take any.
+
+    5. Scan
+
+        Checking every retired node against the whole list of records
+        is O(retired * records) acquire loads, and with max_recl_size_
+        retired nodes it holds up the thread that runs the scan for a
+        long time. So the scan reads every record once, and puts the
+        non-null pointers into a buffer (the snapshot), that is sorted
+        if it is large. A retired node is then looked up in the snapshot:
+        a linear search through a few contiguous pointers, or a binary
+        search. This is enough, as a retired node is already unlinked:
+        a hazard set on it after the snapshot is not validated by its
+        reader, and the reader does not touch the node.
+
+    Layout
+
+    Every thread writes its own record, and the scan reads all of
+    them, so with the layout_padded (default) the records are put on
+    their own cache lines, and so is the reclamation list, which is
+    written by the retiring threads.
 */
 
-template<class N>
+// Shared by the domain and the cache entries with its records,
+// see the thread cache above
+struct hazard_domain {
+
+    std::mutex mutex_;
+    bool       alive_ = true;
+};
+
+// Records owned by the thread, one per domain, for the last
+// SLOTS domains it has used. Type erased: give_back_ knows the
+// type of the record. The record is in use while busy_ is set,
+// it is kept in the entry, so that the eviction does not touch
+// the records (their domains can be gone already)
+class hazard_cache {
+
+public:
+
+    static constexpr std::size_t SLOTS = 8;
+
+    static hazard_cache& local() {
+        thread_local hazard_cache cache;
+        return cache;
+    }
+
+    struct Entry {
+        std::shared_ptr<hazard_domain> domain_;
+        void*                          record_ = nullptr;
+        void                         (*give_back_)(void*) = nullptr;
+        bool                           busy_ = false;
+    };
+
+    Entry* find(const hazard_domain* domain) {
+        for (Entry& e : entries_) {
+            if (e.domain_.get() == domain) {
+                return &e;
+            }
+        }
+        return nullptr;
+    }
+
+    // Evicts the oldest entry whose record is not in use,
+    // nullptr if all of them are -> the record is not cached
+    Entry* insert(const std::shared_ptr<hazard_domain>& domain, void* record,
+                  void (*give_back_fn)(void*)) {
+        for (std::size_t i = 0; i < SLOTS; ++i) {
+            Entry& e = entries_[next_];
+            next_ = (next_ + 1) % SLOTS;
+            if (e.busy_) {
+                continue;
+            }
+            give_back(e);
+            e.domain_ = domain;
+            e.record_ = record;
+            e.give_back_ = give_back_fn;
+            return &e;
+        }
+        return nullptr;
+    }
+
+    ~hazard_cache() {
+        for (Entry& e : entries_) {
+            give_back(e);
+        }
+    }
+
+private:
+
+    static void give_back(Entry& e) {
+        if (e.record_) {
+            {
+                std::lock_guard<std::mutex> lg(e.domain_->mutex_);
+                if (e.domain_->alive_) {
+                    e.give_back_(e.record_);
+                }
+            }
+            e = Entry();
+        }
+    }
+
+    Entry       entries_[SLOTS];
+    std::size_t next_ = 0;
+};
+
+template<class N, class Layout = layout_padded>
 class hazard_pointers {
 
+    static constexpr std::size_t RECORD_ALIGN = layout_align<std::atomic<N*>, Layout::index_align>;
+
     public:
 
     hazard_pointers() 
     : hazards_list_(nullptr)
     , reclamation_list_(nullptr) 
     , recl_list_sz_(0) 
+    , domain_(std::make_shared<hazard_domain>())
     {}
     
     hazard_pointers(const hazard_pointers& other) = delete;
@@ -48,12 +186,17 @@ class hazard_pointers {
 
     ~hazard_pointers() {
 
+        // The threads that own the records do not touch them after it
+        {
+            std::lock_guard<std::mutex> lg(domain_->mutex_);
+            domain_->alive_ = false;
+        }
         HP* hzrd_ptr = hazards_list_.load(std::memory_order_acquire);
         HP* hzrd_next_ptr;
         while (hzrd_ptr)
         {
             hzrd_next_ptr = hzrd_ptr->next_;
-            assert(!hzrd_ptr->active_.load(std::memory_order_acquire));
+            assert(!hzrd_ptr->ptr_.load(std::memory_order_acquire));
             delete hzrd_ptr;
             hzrd_ptr = hzrd_next_ptr;
         }
@@ -63,11 +206,14 @@ class hazard_pointers {
 
     struct HP {
 
-        HP(): next_(nullptr), ptr_(nullptr), active_(false) {}
+        HP(): next_(nullptr), ptr_(nullptr), active_(false), busy_(nullptr) {}
 
-        HP*                 next_;
+        alignas(RECORD_ALIGN) HP* next_;
         std::atomic<N*>     ptr_;
         std::atomic<bool>   active_;
+        // Touched only by the thread that holds the record: the
+        // busy flag of its cache entry, nullptr if it is not cached
+        bool*               busy_;
     };
 
     HP* acquire_hazard();
@@ -101,21 +247,62 @@ class hazard_pointers {
 
     private:
 
+    // Takes a free record from the list, or adds a new one
+    HP* acquire_from_list();
+
+    // The owner thread has exited
+    static void give_back(void* record);
+
+    // The hazards of all the records -> snapshot_, under mutex_scan_
+    void take_snapshot();
+
+    bool in_snapshot(N* data) const;
+
     std::atomic<HP*>        hazards_list_;
-    std::atomic<node_recl*> reclamation_list_;
+    alignas(RECORD_ALIGN) std::atomic<node_recl*> reclamation_list_;
     std::atomic<int>        recl_list_sz_;
     static constexpr int    max_recl_size_ = 20'000;
     std::mutex              mutex_scan_;
+    // Up to this size the snapshot is not sorted
+    static constexpr std::size_t linear_scan_max_ = 32;
+    std::vector<N*>         snapshot_;
+    std::shared_ptr<hazard_domain> domain_;
 };
 
-template<class N>
-typename hazard_pointers<N>::HP*
-hazard_pointers<N>::acquire_hazard() {
+template<class N, class Layout>
+typename hazard_pointers<N, Layout>::HP*
+hazard_pointers<N, Layout>::acquire_hazard() {
+
+    hazard_cache& cache = hazard_cache::local();
+    hazard_cache::Entry* entry = cache.find(domain_.get());
+    if (entry && !entry->busy_) {
+        entry->busy_ = true;
+        return static_cast<HP*>(entry->record_);
+    }
+    if (entry) {
+        // The cached one is in use, the second hazard at the same time
+        return acquire_from_list();
+    }
+    HP* hp = acquire_from_list();
+    // All the slots can hold the records in use
+    // (nested hazards of many domains), then it is not cached
+    if ((entry = cache.insert(domain_, hp, &give_back))) {
+        entry->busy_ = true;
+        hp->busy_ = &entry->busy_;
+    }
+    return hp;
+}
+
+template<class N, class Layout>
+typename hazard_pointers<N, Layout>::HP*
+hazard_pointers<N, Layout>::acquire_from_list() {
 
     HP* ptr = hazards_list_.load(std::memory_order_acquire);
-    bool expect = false;
     for(; ptr ; ptr = ptr->next_) {
 
+        // A failed cas writes true into expect,
+        // so it has to be reset for every record
+        bool expect = false;
         if (ptr->active_.compare_exchange_strong(expect, true)) {
             return ptr;
         }
@@ -128,28 +315,68 @@ hazard_pointers<N>::acquire_hazard() {
     return hazard_new;
 }
 
-template<class N>
-void hazard_pointers<N>::release_hazard(HP* hp) {
+template<class N, class Layout>
+void hazard_pointers<N, Layout>::release_hazard(HP* hp) {
+    hp->ptr_.store(nullptr, std::memory_order_release);
+    if (hp->busy_) {
+        *hp->busy_ = false;
+    } else {
+        hp->active_.store(false, std::memory_order_release);
+    }
+}
+
+template<class N, class Layout>
+void hazard_pointers<N, Layout>::give_back(void* record) {
+
+    HP* hp = static_cast<HP*>(record);
     hp->ptr_.store(nullptr, std::memory_order_release);
+    hp->busy_ = nullptr;
     hp->active_.store(false, std::memory_order_release);
 }
 
-template<class N>
-bool hazard_pointers<N>::in_hazard(N* data) {
+template<class N, class Layout>
+bool hazard_pointers<N, Layout>::in_hazard(N* data) {
 
     HP* cur = hazards_list_.load(std::memory_order_acquire);
     for (;cur; cur = cur->next_) {
         assert(cur);
-        if (cur->ptr_.load(std::memory_order_acquire) == data) {
+        // seq_cst: pairs with the seq_cst store of the hazard
+        // and the unlinking of the node by the caller
+        if (cur->ptr_.load(std::memory_order_seq_cst) == data) {
             return true;
         }
     }
     return false;
 }
 
+template<class N, class Layout>
+void hazard_pointers<N, Layout>::take_snapshot() {
+
+    snapshot_.clear();
+    HP* cur = hazards_list_.load(std::memory_order_acquire);
+    for (;cur; cur = cur->next_) {
+        // seq_cst, as in in_hazard
+        N* ptr = cur->ptr_.load(std::memory_order_seq_cst);
+        if (ptr) {
+            snapshot_.push_back(ptr);
+        }
+    }
+    if (snapshot_.size() > linear_scan_max_) {
+        std::sort(snapshot_.begin(), snapshot_.end(), std::less<N*>());
+    }
+}
+
+template<class N, class Layout>
+bool hazard_pointers<N, Layout>::in_snapshot(N* data) const {
 
-template<class N>
-void hazard_pointers<N>::insert_reclaim(node_recl* reclaim_new) {
+    if (snapshot_.size() <= linear_scan_max_) {
+        return std::find(snapshot_.begin(), snapshot_.end(), data) != snapshot_.end();
+    }
+    return std::binary_search(snapshot_.begin(), snapshot_.end(), data, std::less<N*>());
+}
+
+template<class N, class Layout>
+void hazard_pointers<N, Layout>::insert_reclaim(node_recl* reclaim_new) {
 
     reclaim_new->next_ = reclamation_list_.load(std::memory_order_acquire);
     while (!reclamation_list_.compare_exchange_strong(reclaim_new->next_, reclaim_new, std::memory_order_acq_rel));
@@ -159,15 +386,15 @@ void hazard_pointers<N>::insert_reclaim(node_recl* reclaim_new) {
     }
 }
 
-template<class N>
-void hazard_pointers<N>::reclaim_later(N* node) {
+template<class N, class Layout>
+void hazard_pointers<N, Layout>::reclaim_later(N* node) {
 
     node_recl* reclaim_new = new node_recl(node);
     insert_reclaim(reclaim_new);
 }
 
-template<class N>
-void hazard_pointers<N>::delete_nodes_with_no_hazards() {
+template<class N, class Layout>
+void hazard_pointers<N, Layout>::delete_nodes_with_no_hazards() {
 
     std::unique_lock<std::mutex> ul{mutex_scan_, std::defer_lock_t()};
 
@@ -180,10 +407,14 @@ void hazard_pointers<N>::delete_nodes_with_no_hazards() {
     } while (!recl_list_sz_.compare_exchange_strong(cur_sz, 0, std::memory_order_acq_rel));
 
     node_recl* list_ptr = reclamation_list_.exchange(nullptr);
+    if (!list_ptr) {
+        return ;
+    }
+    take_snapshot();
     node_recl* next_list;
     while (list_ptr) {
         next_list = list_ptr->next_;
-        if (in_hazard(list_ptr->data_)) {
+        if (in_snapshot(list_ptr->data_)) {
             insert_reclaim(list_ptr);
         } else {
             list_ptr->delete_node();
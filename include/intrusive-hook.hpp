@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <type_traits>
+
+/*
+
+    Hook for the intrusive containers (lock_free_intrusive_mpsc_queue,
+    lock_free_intrusive_stack). The type of the elements derives from
+    it, and the containers link the caller's objects through the hook
+    instead of allocating a node with a copy of the value:
+
+        struct Message : intrusive_hook {
+            ...
+        };
+
+    The containers do not own the objects: push takes a pointer, pop
+    gives it back, and who allocated the object frees it (e.g. returns
+    it to its pool). An object is in at most one container at a time.
+
+    The link is atomic, since the lock-free containers can read it
+    while another thread is changing it. Copying the object does not
+    copy the link, the copy is not in any container.
+
+*/
+
+struct intrusive_hook {
+
+    intrusive_hook()
+    : next_(nullptr)
+    {}
+
+    intrusive_hook(const intrusive_hook&)
+    : next_(nullptr)
+    {}
+
+    intrusive_hook& operator = (const intrusive_hook&) {
+        return *this;
+    }
+
+    std::atomic<intrusive_hook*> next_;
+};
+
+template<class T>
+constexpr bool is_intrusive_v = std::is_base_of<intrusive_hook, T>::value;
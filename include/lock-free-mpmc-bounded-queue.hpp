@@ -1,8 +1,22 @@
 #pragma once
 
+#include "cache-line.hpp"
+#include "event-count.hpp"
+
 #include <vector>
+#include <array>
 #include <atomic>
 #include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include <chrono>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 
 /*
 
@@ -53,45 +67,394 @@
     optimization that we make is to use power of 2 in the size
     of the queue. This enables quick modulo operation by using &
     -> which will erase the most significant bit preserving the rest 
+
+    Storage
+
+    The values are kept right in the cells, in the raw storage
+    of the size of T. The pusher constructs the value in place after
+    it has won the cas, and before it stores the new generation, the
+    popper moves it out and destroys it in place before it gives the
+    cell to the next round. Therefore nothing is allocated per element.
+
+    If the constructor throws, the cell is already taken, so the pusher
+    marks the cell as empty (full_ = false) and publishes it anyway.
+    The popper that takes such a cell just passes it to the next round
+    and tries the next one.
+
+    Packed cells
+
+    For trivially copyable T of at most 4 bytes (ints, handles, indices)
+    there is no separate generation at all: the generation, the full flag
+    and the bytes of the value are kept in one 64 bit atomic word
+
+        | gen (31 bit) | full (1 bit) | value (32 bit) |
+
+    so the pusher publishes the value together with the generation by one
+    store, and the popper reads them by one load. The generation is
+    compared modulo 2^31, which is enough, since a thread would have to
+    sleep for 2^31 positions between the load of the index and its cas to
+    mistake one round for another.
+
+    Trivially copyable T of 5 to 8 bytes (pointers, 64 bit ids) does not
+    fit into one word with the generation, so its cell is two words, 16
+    bytes aligned to 16, on one cache line:
+
+        | gen (63 bit) | full (1 bit) |  value (64 bit)  |
+
+    The pusher stores the value (relaxed) and then the generation (release),
+    the popper loads the generation (acquire) and then the value, exactly
+    as with the raw storage, but the full flag is in the generation word
+    and the value is an atomic word, so there is no data race even on a
+    cell the popper only looks at. A cas over both words (cmpxchg16b) is
+    not needed: the cell is owned by one thread between the two stores,
+    and it would only make every load of the generation a locked write.
+
+    The packed cells are chosen by type traits, the interface of the queue
+    does not change.
+
+    Indices
+
+    head, tail and the generations are 64 bit unsigned counters, so at
+    10^9 operations per second they wrap around only in 500 years. And even
+    then nothing breaks: the indices are only compared for equality, masked
+    with the power of 2, or subtracted from each other, and all of these
+    work in the unsigned arithmetic modulo 2^64.
+
+    Fixed capacity
+
+    lock_free_mpmc_bounded_queue<T, Capacity> with Capacity != 0 (power of 2)
+    keeps the cells right in the object instead of the heap array, and its
+    mask is a constant. Such a queue does not allocate at all, can be placed
+    in static storage or on the stack, and saves one indirection per operation.
+
+    Layout
+
+    The Layout policy (see cache-line.hpp) puts head, tail and the cells
+    on different cache lines (layout_padded, default), keeps everything
+    packed (layout_packed), or gives every cell its own line as well
+    (layout_padded_cells), so that the threads working on neighbouring
+    positions do not invalidate each other's lines.
+
+    BULK
+
+    push_bulk and pop_bulk take a whole range of positions with one cas
+    on the index, and then go through the cells of the range one by one.
+    The range is computed from the opposite index, that is loaded before
+    our own one, so the range can only be smaller than the real free space
+    (the number of elements). But the cell can still be in use by the thread
+    that has taken it in the previous round and has not stored its generation
+    yet, so before every cell we wait for its generation, exactly as a single
+    push (pop) would have waited by retrying. The wait spins with pause and
+    then yields (event_count::spin_until), as that thread can be preempted.
+
+    BLOCKING
+
+    wait_pop and wait_push do not spin forever on a empty (full) queue:
+    they go to sleep on the event count (see event-count.hpp) not_empty_
+    (not_full_). Every successful push notifies not_empty_, every successful
+    pop notifies not_full_, and as long as nobody sleeps the notification
+    is one fence and one load, without any syscall.
+
+    OVERWRITE
+
+    push_overwrite never fails: if the queue is full, the pusher throws
+    away the oldest element and takes its place (for telemetry, where the
+    fresh data is worth more than the old one). The oldest element is
+    taken with the same cas on the tail as in pop, so the cell is owned
+    either by the popper or by the pusher that drops it, and no popper
+    can read a value that is being overwritten. Every dropped element is
+    counted in dropped().
+
+    Positions of the elements are their sequence numbers, and try_pop(val, seq)
+    returns them, so that a consumer can see the gaps: if the previous
+    element it got was seq n, and the current one is not n + 1, the elements
+    in between were dropped (or, with several consumers, taken by the others).
 */
 
-template<class T>
+template<class T, std::size_t Capacity = 0, class Layout = layout_padded>
 class lock_free_mpmc_bounded_queue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity has to be a power of 2");
+
 
 private:
 
-    struct Node {
-        std::atomic<int> gen_;
-        T*                content_;
+    template<class X>
+    static constexpr std::size_t index_align = layout_align<X, Layout::index_align>;
+
+    static constexpr std::size_t CELL_ALIGN = layout_align<std::atomic<std::size_t>, Layout::cell_align>;
+
+    // The value in the raw storage next to the generation
+    struct InlineNode {
+        alignas(CELL_ALIGN) std::atomic<std::size_t> gen_;
+        bool             full_;
+        alignas(T) unsigned char data_[sizeof(T)];
+
+        InlineNode() : gen_(0), full_(false) {}
+
+        T* get() {
+            return std::launder(reinterpret_cast<T*>(data_));
+        }
+
+        void init(std::size_t gen) {
+            gen_.store(gen, std::memory_order_relaxed);
+        }
+
+        bool has_gen(std::size_t gen) const {
+            return gen_.load(std::memory_order_acquire) == gen;
+        }
+
+        bool full() const {
+            return full_;
+        }
+
+        // Constructs the value and gives the cell to gen. If the
+        // constructor throws, the cell is given away empty anyway,
+        // so that the queue does not stall
+        template<class... Args>
+        void put(std::size_t gen, Args&&... args) {
+            try {
+                new (data_) T(std::forward<Args>(args)...);
+                full_ = true;
+            } catch (...) {
+                put_empty(gen);
+                throw;
+            }
+            gen_.store(gen, std::memory_order_release);
+        }
+
+        void put_empty(std::size_t gen) {
+            full_ = false;
+            gen_.store(gen, std::memory_order_release);
+        }
+
+        // Passes the value to take, destroys it and gives the
+        // cell to gen. If take throws, the value is lost
+        template<class F>
+        void take(std::size_t gen, F&& f) {
+            T* ptr = get();
+            try {
+                f(*ptr);
+            } catch (...) {
+                ptr->~T();
+                put_empty(gen);
+                throw;
+            }
+            ptr->~T();
+            put_empty(gen);
+        }
 
-        Node() : gen_(0), content_(nullptr) {}
+        void destroy() {
+            if (full_) {
+                get()->~T();
+                full_ = false;
+            }
+        }
     };
 
-    std::unique_ptr<Node[]> data_;
-    std::atomic<int> head_;
-    std::atomic<int> tail_;
-    int              size_;
-    int              MASK;
+    // The generation, the full flag and the value in one word
+    struct PackedNode {
+
+        static constexpr std::uint64_t FULL = std::uint64_t(1) << 32;
+        static constexpr std::uint64_t GEN_MASK = ~(FULL | 0xffffffffu);
+
+        alignas(CELL_ALIGN) std::atomic<std::uint64_t> word_;
+
+        PackedNode() : word_(0) {}
+
+        static std::uint64_t gen_bits(std::size_t gen) {
+            return std::uint64_t(gen & 0x7fffffffu) << 33;
+        }
+
+        void init(std::size_t gen) {
+            word_.store(gen_bits(gen), std::memory_order_relaxed);
+        }
+
+        bool has_gen(std::size_t gen) const {
+            return (word_.load(std::memory_order_acquire) & GEN_MASK) == gen_bits(gen);
+        }
+
+        bool full() const {
+            return word_.load(std::memory_order_relaxed) & FULL;
+        }
+
+        template<class... Args>
+        void put(std::size_t gen, Args&&... args) {
+            std::uint32_t bits = 0;
+            try {
+                T val(std::forward<Args>(args)...);
+                std::memcpy(&bits, &val, sizeof(T));
+            } catch (...) {
+                put_empty(gen);
+                throw;
+            }
+            word_.store(gen_bits(gen) | FULL | bits, std::memory_order_release);
+        }
+
+        void put_empty(std::size_t gen) {
+            word_.store(gen_bits(gen), std::memory_order_release);
+        }
+
+        template<class F>
+        void take(std::size_t gen, F&& f) {
+            // The cell is ours, nobody changes the word until we give it away
+            std::uint32_t bits = static_cast<std::uint32_t>(word_.load(std::memory_order_relaxed));
+            alignas(T) unsigned char data[sizeof(T)];
+            std::memcpy(data, &bits, sizeof(T));
+            try {
+                f(*std::launder(reinterpret_cast<T*>(data)));
+            } catch (...) {
+                put_empty(gen);
+                throw;
+            }
+            put_empty(gen);
+        }
+
+        void destroy() {}
+    };
+
+    // The generation with the full flag in one word, the value in the next
+    struct WideNode {
+
+        static constexpr std::uint64_t FULL = 1;
+
+        alignas(CELL_ALIGN > 16 ? CELL_ALIGN : 16) std::atomic<std::uint64_t> gen_;
+        std::atomic<std::uint64_t> value_;
+
+        WideNode() : gen_(0), value_(0) {}
+
+        static std::uint64_t gen_bits(std::size_t gen) {
+            return std::uint64_t(gen) << 1;
+        }
+
+        void init(std::size_t gen) {
+            gen_.store(gen_bits(gen), std::memory_order_relaxed);
+        }
+
+        bool has_gen(std::size_t gen) const {
+            return (gen_.load(std::memory_order_acquire) & ~FULL) == gen_bits(gen);
+        }
+
+        bool full() const {
+            return gen_.load(std::memory_order_relaxed) & FULL;
+        }
+
+        template<class... Args>
+        void put(std::size_t gen, Args&&... args) {
+            std::uint64_t bits = 0;
+            try {
+                T val(std::forward<Args>(args)...);
+                std::memcpy(&bits, &val, sizeof(T));
+            } catch (...) {
+                put_empty(gen);
+                throw;
+            }
+            value_.store(bits, std::memory_order_relaxed);
+            gen_.store(gen_bits(gen) | FULL, std::memory_order_release);
+        }
+
+        void put_empty(std::size_t gen) {
+            gen_.store(gen_bits(gen), std::memory_order_release);
+        }
+
+        template<class F>
+        void take(std::size_t gen, F&& f) {
+            // Ordered by the acquire load of the generation
+            std::uint64_t bits = value_.load(std::memory_order_relaxed);
+            alignas(T) unsigned char data[sizeof(T)];
+            std::memcpy(data, &bits, sizeof(T));
+            try {
+                f(*std::launder(reinterpret_cast<T*>(data)));
+            } catch (...) {
+                put_empty(gen);
+                throw;
+            }
+            put_empty(gen);
+        }
+
+        void destroy() {}
+    };
+
+public:
+
+    // true if the cells of the queue are packed into one word
+    // (up to 4 bytes) or two words (up to 8 bytes)
+    static constexpr bool packed = std::is_trivially_copyable<T>::value &&
+                                   sizeof(T) <= sizeof(std::uint64_t) &&
+                                   std::atomic<std::uint64_t>::is_always_lock_free;
+
+private:
+
+    using PackedCell = typename std::conditional<sizeof(T) <= sizeof(std::uint32_t),
+                                                 PackedNode, WideNode>::type;
+
+    using Node = typename std::conditional<packed, PackedCell, InlineNode>::type;
+
+    template<class F>
+    bool pop_with(F&& take, std::size_t* seq = nullptr);
+
+    // Waits until the thread of the previous round gives the cell
+    // to gen (bulk operations, see BULK above)
+    static void wait_gen(Node& cell, std::size_t gen) {
+        event_count::spin_until([&cell, gen]() {
+            return cell.has_gen(gen);
+        });
+    }
+
+    // Drops the element at the position old_tail, if it is there
+    void drop_oldest(std::size_t old_tail);
+
+    // Heap array of the runtime size, or the array
+    // right in the object for the fixed Capacity
+    using Storage = typename std::conditional<Capacity == 0,
+                                              std::unique_ptr<Node[]>,
+                                              std::array<Node, Capacity>>::type;
+
+    // Fold to constants for the fixed Capacity
+    std::size_t size() const {
+        return Capacity ? Capacity : size_;
+    }
+
+    std::size_t mask() const {
+        return size() - 1;
+    }
+
+    // Pushers write head_ (and dropped_), poppers write tail_, and both
+    // of them only read the cells array and the event counts (as long
+    // as nobody sleeps), so each group gets its own line
+    alignas(index_align<std::atomic<std::size_t>>) std::atomic<std::size_t> head_;
+    std::atomic<std::size_t>                       dropped_;
+    alignas(index_align<std::atomic<std::size_t>>) std::atomic<std::size_t> tail_;
+    alignas(index_align<Storage>)                  Storage                  data_;
+    std::size_t                                    size_;
+    alignas(index_align<event_count>)              event_count              not_empty_;
+    event_count                                    not_full_;
 
 public: 
 
     lock_free_mpmc_bounded_queue()
-    : lock_free_mpmc_bounded_queue(1e6)
+    : lock_free_mpmc_bounded_queue(Capacity ? Capacity : 1e6)
     {}
 
-    lock_free_mpmc_bounded_queue(int size) {
+    // With the fixed Capacity the size is ignored.
+    // start -- the first index, lets the tests cross
+    // the wrap around of the indices right away
+    lock_free_mpmc_bounded_queue(std::size_t size, std::size_t start = 0) {
 
-        size_ = 1;
-        while(size_ < size) {
-            size_ <<= 1;
+        if constexpr (Capacity == 0) {
+            size_ = 1;
+            while(size_ < size) {
+                size_ <<= 1;
+            }
+            data_ = std::make_unique<Node[]>(size_);
+        } else {
+            size_ = Capacity;
         }
-        data_ = std::make_unique<Node[]>(size_);
-        for (int i = 0; i < size_; ++i) {
-            data_[i].gen_.store(i, std::memory_order_release);
+        for (std::size_t i = 0; i < size_; ++i) {
+            data_[(start + i) & mask()].init(start + i);
         }
-        MASK = size_ - 1;
-        head_.store(0, std::memory_order_release);
-        tail_.store(0, std::memory_order_release);
+        head_.store(start, std::memory_order_release);
+        tail_.store(start, std::memory_order_release);
+        dropped_.store(0, std::memory_order_release);
     }
 
     lock_free_mpmc_bounded_queue(lock_free_mpmc_bounded_queue& other) = delete;
@@ -99,72 +462,367 @@ public:
 
     ~lock_free_mpmc_bounded_queue() {
 
-        while(pop());
+        std::size_t head = head_.load(std::memory_order_acquire);
+        for (std::size_t i = tail_.load(std::memory_order_acquire); i != head; ++i) {
+            data_[i & mask()].destroy();
+        }
     }
 
+    // 1. push -- returns false in case the queue is full
+
     bool push(T);
 
+    template<class... Args>
+    bool emplace(Args&&... args);
+
+    // Overwrite mode -- never fails, drops the oldest
+    // element if the queue is full
+
+    void push_overwrite(T val);
+
+    template<class... Args>
+    void emplace_overwrite(Args&&... args);
+
+    // Number of elements dropped by push_overwrite
+    std::size_t dropped() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    // 2. pop -- returns empty pointer (false, empty optional)
+    // in case the queue is empty. If the move of the value out of
+    // the queue throws, the element is lost
+
     std::unique_ptr<T> pop();
 
+    bool try_pop(T& val);
+
+    std::optional<T> try_pop();
+
+    // seq -- the sequence number (position) of the element,
+    // shows the gaps left by the dropped elements
+    bool try_pop(T& val, std::size_t& seq);
+
+    // 3. bulk versions -- push as many elements of [first, last)
+    // as fit (pop at most max elements), return how many.
+    // The iterators of push_bulk have to be at least forward ones.
+    // If a constructor throws, the rest of the batch is not pushed,
+    // if a move out throws, the rest of the taken batch is lost
+
+    template<class It>
+    std::size_t push_bulk(It first, It last);
+
+    template<class Out>
+    std::size_t pop_bulk(Out out, std::size_t max);
+
+    // 4. blocking versions -- wait until the element (the free cell)
+    // comes, sleeping on the futex if it takes long. Timed versions
+    // return false, if nothing came before the timeout
+
+    void wait_pop(T& val);
+
+    template<class Rep, class Period>
+    bool wait_pop_for(T& val, const std::chrono::duration<Rep, Period>& timeout);
+
+    void wait_push(T val);
+
+    template<class Rep, class Period>
+    bool wait_push_for(T val, const std::chrono::duration<Rep, Period>& timeout);
+
     bool empty();
 };
 
-template<class T>
-bool lock_free_mpmc_bounded_queue<T>::push(T val) {
+template<class T, std::size_t Capacity, class Layout>
+bool lock_free_mpmc_bounded_queue<T, Capacity, Layout>::push(T val) {
+
+    return emplace(std::move(val));
+}
+
+template<class T, std::size_t Capacity, class Layout>
+template<class... Args>
+bool lock_free_mpmc_bounded_queue<T, Capacity, Layout>::emplace(Args&&... args) {
 
-    std::unique_ptr<T> data_new(new T(std::move(val)));
-    int old_head;
-    int head_new;
+    std::size_t old_head;
+    std::size_t head_new;
     for (;;) {
         old_head = head_.load(std::memory_order_acquire);
         head_new = old_head + 1;
-        if ((head_new & MASK) == (tail_.load(std::memory_order_acquire) & MASK)) {
+        if ((head_new & mask()) == (tail_.load(std::memory_order_acquire) & mask())) {
             return false;
         }
-        int node_gen = data_[old_head & MASK].gen_.load(std::memory_order_acquire);
-        if (old_head != node_gen) {
+        if (!data_[old_head & mask()].has_gen(old_head)) {
             continue;
         }
         if (head_.compare_exchange_weak(old_head, head_new, std::memory_order_acq_rel)) {
-            Node& cell = data_[old_head & MASK];
-            cell.content_ = data_new.get();
-            data_new.release();
-            cell.gen_.store(head_new, std::memory_order_release);
+            data_[old_head & mask()].put(head_new, std::forward<Args>(args)...);
+            not_empty_.notify_one();
             return true;
         }
     }
 }
 
-template<class T>
-std::unique_ptr<T> lock_free_mpmc_bounded_queue<T>::pop() {
+template<class T, std::size_t Capacity, class Layout>
+void lock_free_mpmc_bounded_queue<T, Capacity, Layout>::push_overwrite(T val) {
+
+    emplace_overwrite(std::move(val));
+}
+
+template<class T, std::size_t Capacity, class Layout>
+template<class... Args>
+void lock_free_mpmc_bounded_queue<T, Capacity, Layout>::emplace_overwrite(Args&&... args) {
+
+    std::size_t old_head;
+    std::size_t head_new;
+    for (;;) {
+        old_head = head_.load(std::memory_order_acquire);
+        head_new = old_head + 1;
+        std::size_t old_tail = tail_.load(std::memory_order_acquire);
+        if ((head_new & mask()) == (old_tail & mask())) {
+            // Full: make room and look again
+            drop_oldest(old_tail);
+            continue;
+        }
+        if (!data_[old_head & mask()].has_gen(old_head)) {
+            continue;
+        }
+        if (head_.compare_exchange_weak(old_head, head_new, std::memory_order_acq_rel)) {
+            data_[old_head & mask()].put(head_new, std::forward<Args>(args)...);
+            not_empty_.notify_one();
+            return;
+        }
+    }
+}
+
+template<class T, std::size_t Capacity, class Layout>
+void lock_free_mpmc_bounded_queue<T, Capacity, Layout>::drop_oldest(std::size_t old_tail) {
+
+    Node& cell = data_[old_tail & mask()];
+    // The push into this position is not finished yet,
+    // or the element is popped already
+    if (!cell.has_gen(old_tail + 1)) {
+        return;
+    }
+    if (!tail_.compare_exchange_strong(old_tail, old_tail + 1, std::memory_order_acq_rel)) {
+        return;
+    }
+    if (cell.full()) {
+        cell.destroy();
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+    cell.put_empty(old_tail + size());
+}
+
+template<class T, std::size_t Capacity, class Layout>
+template<class F>
+bool lock_free_mpmc_bounded_queue<T, Capacity, Layout>::pop_with(F&& take, std::size_t* seq) {
 
-    int old_tail;
-    int tail_new;
+    std::size_t old_tail;
+    std::size_t tail_new;
     for(;;) {
         old_tail = tail_.load(std::memory_order_acquire);
         tail_new = old_tail + 1;
-        if ((old_tail & MASK) == (head_.load(std::memory_order_acquire) & MASK)) {
-            return std::unique_ptr<T>();
+        if ((old_tail & mask()) == (head_.load(std::memory_order_acquire) & mask())) {
+            return false;
         }
-        int node_gen = data_[old_tail & MASK].gen_.load(std::memory_order_acquire);
-        if (tail_new != node_gen) {
+        if (!data_[old_tail & mask()].has_gen(tail_new)) {
             continue;
         }
         if (tail_.compare_exchange_weak(old_tail, tail_new, std::memory_order_acq_rel)) {
-            Node& cell = data_[old_tail & MASK];
-            T* ptr = cell.content_;
-            cell.content_ = nullptr;
-            cell.gen_.store(old_tail + size_, std::memory_order_release);
-            return std::unique_ptr<T>(ptr); 
+            Node& cell = data_[old_tail & mask()];
+            if (!cell.full()) {
+                // The push into this cell has thrown
+                cell.put_empty(old_tail + size());
+                not_full_.notify_one();
+                continue;
+            }
+            if (seq) {
+                *seq = old_tail;
+            }
+            cell.take(old_tail + size(), take);
+            not_full_.notify_one();
+            return true;
+        }
+    }
+}
+
+template<class T, std::size_t Capacity, class Layout>
+std::unique_ptr<T> lock_free_mpmc_bounded_queue<T, Capacity, Layout>::pop() {
+
+    std::unique_ptr<T> res;
+    pop_with([&res](T& val) {
+        res = std::make_unique<T>(std::move(val));
+    });
+    return res;
+}
+
+template<class T, std::size_t Capacity, class Layout>
+bool lock_free_mpmc_bounded_queue<T, Capacity, Layout>::try_pop(T& val) {
+
+    return pop_with([&val](T& cell) {
+        val = std::move(cell);
+    });
+}
+
+template<class T, std::size_t Capacity, class Layout>
+std::optional<T> lock_free_mpmc_bounded_queue<T, Capacity, Layout>::try_pop() {
+
+    std::optional<T> res;
+    pop_with([&res](T& val) {
+        res.emplace(std::move(val));
+    });
+    return res;
+}
+
+template<class T, std::size_t Capacity, class Layout>
+bool lock_free_mpmc_bounded_queue<T, Capacity, Layout>::try_pop(T& val, std::size_t& seq) {
+
+    return pop_with([&val](T& cell) {
+        val = std::move(cell);
+    }, &seq);
+}
+
+template<class T, std::size_t Capacity, class Layout>
+template<class It>
+std::size_t lock_free_mpmc_bounded_queue<T, Capacity, Layout>::push_bulk(It first, It last) {
+
+    std::size_t want = std::distance(first, last);
+    std::size_t old_head;
+    std::size_t count;
+    for (;;) {
+        std::size_t tail = tail_.load(std::memory_order_acquire);
+        old_head = head_.load(std::memory_order_acquire);
+        // One cell is always kept free, as in push
+        // The differences of the indices are wrap-safe
+        std::ptrdiff_t free = static_cast<std::ptrdiff_t>(size() - 1) -
+                              static_cast<std::ptrdiff_t>(old_head - tail);
+        if (want == 0 || free <= 0) {
+            return 0;
+        }
+        count = std::min<std::size_t>(want, free);
+        if (head_.compare_exchange_weak(old_head, old_head + count, std::memory_order_acq_rel)) {
+            break;
+        }
+    }
+    std::size_t i = 0;
+    try {
+        for (; i < count; ++first) {
+            std::size_t pos = old_head + i;
+            Node& cell = data_[pos & mask()];
+            wait_gen(cell, pos);
+            auto&& val = *first;
+            // put gives the cell away, even if the constructor throws
+            ++i;
+            cell.put(pos + 1, val);
+        }
+    } catch (...) {
+        // The range is ours already, hand the
+        // rest of it to the poppers empty
+        for (; i < count; ++i) {
+            std::size_t pos = old_head + i;
+            Node& cell = data_[pos & mask()];
+            wait_gen(cell, pos);
+            cell.put_empty(pos + 1);
         }
+        not_empty_.notify_all();
+        throw;
     }
+    not_empty_.notify_all();
+    return count;
 }
 
-template<class T>
-bool lock_free_mpmc_bounded_queue<T>::empty() {
+template<class T, std::size_t Capacity, class Layout>
+template<class Out>
+std::size_t lock_free_mpmc_bounded_queue<T, Capacity, Layout>::pop_bulk(Out out, std::size_t max) {
+
+    std::size_t old_tail;
+    std::size_t count;
+    for (;;) {
+        old_tail = tail_.load(std::memory_order_acquire);
+        std::size_t head = head_.load(std::memory_order_acquire);
+        std::ptrdiff_t avail = static_cast<std::ptrdiff_t>(head - old_tail);
+        if (max == 0 || avail <= 0) {
+            return 0;
+        }
+        count = std::min<std::size_t>(max, avail);
+        if (tail_.compare_exchange_weak(old_tail, old_tail + count, std::memory_order_acq_rel)) {
+            break;
+        }
+    }
+    std::size_t popped = 0;
+    std::size_t i = 0;
+    try {
+        while (i < count) {
+            std::size_t pos = old_tail + i;
+            Node& cell = data_[pos & mask()];
+            wait_gen(cell, pos + 1);
+            // take gives the cell away, even if the move throws
+            ++i;
+            if (!cell.full()) {
+                cell.put_empty(pos + size());
+                continue;
+            }
+            cell.take(pos + size(), [&out](T& val) {
+                *out = std::move(val);
+            });
+            ++out;
+            ++popped;
+        }
+    } catch (...) {
+        // The cells are ours, so they have to be given
+        // to the next round, the values in them are lost
+        for (; i < count; ++i) {
+            std::size_t pos = old_tail + i;
+            Node& cell = data_[pos & mask()];
+            wait_gen(cell, pos + 1);
+            cell.destroy();
+            cell.put_empty(pos + size());
+        }
+        not_full_.notify_all();
+        throw;
+    }
+    not_full_.notify_all();
+    return popped;
+}
+
+template<class T, std::size_t Capacity, class Layout>
+void lock_free_mpmc_bounded_queue<T, Capacity, Layout>::wait_pop(T& val) {
+
+    not_empty_.await([this, &val]() {
+        return try_pop(val);
+    });
+}
+
+template<class T, std::size_t Capacity, class Layout>
+template<class Rep, class Period>
+bool lock_free_mpmc_bounded_queue<T, Capacity, Layout>::wait_pop_for(T& val, const std::chrono::duration<Rep, Period>& timeout) {
+
+    return not_empty_.await_for([this, &val]() {
+        return try_pop(val);
+    }, timeout);
+}
+
+template<class T, std::size_t Capacity, class Layout>
+void lock_free_mpmc_bounded_queue<T, Capacity, Layout>::wait_push(T val) {
+
+    // emplace does not touch the value, if the queue is full
+    not_full_.await([this, &val]() {
+        return emplace(std::move(val));
+    });
+}
+
+template<class T, std::size_t Capacity, class Layout>
+template<class Rep, class Period>
+bool lock_free_mpmc_bounded_queue<T, Capacity, Layout>::wait_push_for(T val, const std::chrono::duration<Rep, Period>& timeout) {
+
+    return not_full_.await_for([this, &val]() {
+        return emplace(std::move(val));
+    }, timeout);
+}
+
+template<class T, std::size_t Capacity, class Layout>
+bool lock_free_mpmc_bounded_queue<T, Capacity, Layout>::empty() {
     
     if(head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire)) {
         return true;
     }
     return false;
-}
\ No newline at end of file
+}
@@ -0,0 +1,397 @@
+#pragma once
+
+#include "cache-line.hpp"
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+
+/*
+
+    Bounded multiple producer multiple consumer queue after
+    the SCQ of R. Nikolaev ("A Scalable, Portable, and Memory-Efficient
+    Lock-Free FIFO Queue", 2019).
+
+    In lock_free_mpmc_bounded_queue every thread tries to move
+    the index with cas, and under contention most of the cas fail
+    and are retried. Here the indices are moved with fetch_add, which
+    always succeeds: every thread gets its own position at once, and
+    only checks the entry at that position.
+
+    The values are stored in a plain array of n cells, and the queue
+    itself is a pair of rings of the indices of these cells:
+
+    -> aq -- indices of the cells with values, in the FIFO order
+    -> fq -- indices of the free cells
+
+    PUSH                                POP
+
+    1. take a free index from fq        1. take an index from aq
+        -> if there is none, full          -> if there is none, empty
+    2. construct the value in the cell  2. move the value out of the cell
+    3. put the index into aq            3. put the index back to fq
+
+    Ring of indices (scq_ring)
+
+    The ring has 2n entries for at most n indices, that is why a
+    producer always finds a place for its index and never has to report
+    that the ring is full. Every entry is one 64 bit word:
+
+        | cycle | safe | index |
+
+    where cycle is the round (position / 2n), in which the entry was
+    written, and index == BOTTOM marks an empty entry.
+
+    ENQUEUE
+
+    In a while loop
+    1. T = fetch_add(tail), look at the entry at T
+    2. If the entry is from the previous cycle, is empty, and is
+        safe (or no dequeuer has passed this position yet)
+        -> cas it to (cycle of T, safe, index) and return
+    3. Otherwise it is still occupied, take the next position
+    4. Reset the threshold (see below)
+
+    DEQUEUE
+
+    In a while loop
+    1. H = fetch_add(head), look at the entry at H
+    2. If the entry is of the cycle of H -> this is our index:
+        consume it with fetch_or(BOTTOM) and return it
+    3. Otherwise make sure that the enqueuer that will come to
+        this position later does not use it:
+        -> if the entry is empty, move it to the cycle of H
+        -> if it holds an index of the older cycle (its dequeuer is late),
+           mark it unsafe
+    4. If the tail is behind us, the ring is empty: move the tail
+        up to the head (catchup), so that enqueuers do not waste the
+        positions we have passed, and return nothing
+
+    Threshold
+
+    A dequeuer that finds the ring empty still increments the head,
+    and many dequeuers could push each other forward forever without
+    ever seeing an element (livelock). The threshold bounds that: every
+    enqueue sets it to 3n - 1 and every unsuccessful iteration of a
+    dequeue decrements it; once it is below zero the ring is certainly
+    empty and dequeue returns immediately without touching the head.
+    3n - 1 is enough for a dequeuer to reach the last enqueued element.
+
+    Cache remap
+
+    Entries of consecutive positions are put into different cache lines,
+    so that the threads that got neighbouring positions do not fight
+    for one line.
+
+    Cycles are never wrapped: 64 bit indices would need centuries to overflow.
+
+*/
+
+class scq_ring {
+
+private:
+
+    using Entry = std::uint64_t;
+
+    static constexpr std::size_t entries_per_line = cache_line_size / sizeof(Entry);
+
+    Entry make(std::uint64_t cycle, bool safe, std::uint64_t index) const {
+        return (cycle << cycle_shift_) | (Entry(safe) << order_) | index;
+    }
+
+    std::uint64_t cycle(Entry e) const {
+        return e >> cycle_shift_;
+    }
+
+    bool safe(Entry e) const {
+        return (e >> order_) & 1;
+    }
+
+    std::uint64_t index(Entry e) const {
+        return e & BOTTOM;
+    }
+
+    // Position -> entry. Neighbouring positions go to
+    // neighbouring cache lines
+    std::size_t remap(std::uint64_t pos) const {
+        std::size_t idx = pos & MASK;
+        if (ring_size_ < entries_per_line) {
+            return idx;
+        }
+        return (idx % entries_per_line) * (ring_size_ / entries_per_line) + idx / entries_per_line;
+    }
+
+    void catchup(std::uint64_t tail, std::uint64_t head);
+
+    alignas(cache_line_size) std::atomic<std::uint64_t> tail_;
+    alignas(cache_line_size) std::atomic<std::uint64_t> head_;
+    alignas(cache_line_size) std::atomic<std::int64_t> threshold_;
+
+    alignas(cache_line_size) std::unique_ptr<std::atomic<Entry>[]> data_;
+    std::size_t   ring_size_;       // 2n
+    std::size_t   order_;           // log2(2n)
+    std::size_t   cycle_shift_;
+    std::uint64_t BOTTOM;           // 2n - 1, also the mask of the index
+    std::uint64_t MASK;
+    std::int64_t  THRESHOLD;        // 3n - 1
+
+public:
+
+    // n -- power of 2, number of indices. If full is true, the
+    // ring is created with all the indices 0 .. n - 1 in it
+    scq_ring(std::size_t n, bool full);
+
+    scq_ring(const scq_ring&) = delete;
+    scq_ring& operator = (const scq_ring&) = delete;
+
+    void enqueue(std::uint64_t idx);
+
+    bool dequeue(std::uint64_t& idx);
+
+    bool empty() const {
+        return threshold_.load(std::memory_order_acquire) < 0 ||
+               head_.load(std::memory_order_acquire) >= tail_.load(std::memory_order_acquire);
+    }
+};
+
+inline scq_ring::scq_ring(std::size_t n, bool full) {
+
+    ring_size_ = 2 * n;
+    order_ = 0;
+    while ((std::size_t(1) << order_) < ring_size_) {
+        ++order_;
+    }
+    cycle_shift_ = order_ + 1;
+    BOTTOM = ring_size_ - 1;
+    MASK = ring_size_ - 1;
+    THRESHOLD = 3 * static_cast<std::int64_t>(n) - 1;
+
+    // Positions start from the cycle 1, so that the
+    // empty entries of the cycle 0 can be taken right away
+    data_ = std::make_unique<std::atomic<Entry>[]>(ring_size_);
+    for (std::size_t i = 0; i < ring_size_; ++i) {
+        data_[i].store(make(0, true, BOTTOM), std::memory_order_relaxed);
+    }
+    head_.store(ring_size_, std::memory_order_relaxed);
+    if (full) {
+        for (std::size_t i = 0; i < n; ++i) {
+            data_[remap(ring_size_ + i)].store(make(1, true, i), std::memory_order_relaxed);
+        }
+        tail_.store(ring_size_ + n, std::memory_order_relaxed);
+        threshold_.store(THRESHOLD, std::memory_order_release);
+    } else {
+        tail_.store(ring_size_, std::memory_order_relaxed);
+        threshold_.store(-1, std::memory_order_release);
+    }
+}
+
+inline void scq_ring::enqueue(std::uint64_t idx) {
+
+    for (;;) {
+        std::uint64_t tail = tail_.fetch_add(1, std::memory_order_acq_rel);
+        std::uint64_t tail_cycle = tail >> order_;
+        std::atomic<Entry>& entry = data_[remap(tail)];
+        Entry e = entry.load(std::memory_order_acquire);
+        while (cycle(e) < tail_cycle && index(e) == BOTTOM &&
+               (safe(e) || head_.load(std::memory_order_acquire) <= tail)) {
+            if (entry.compare_exchange_weak(e, make(tail_cycle, true, idx),
+                                            std::memory_order_acq_rel, std::memory_order_acquire)) {
+                if (threshold_.load(std::memory_order_acquire) != THRESHOLD) {
+                    threshold_.store(THRESHOLD, std::memory_order_release);
+                }
+                return;
+            }
+        }
+    }
+}
+
+inline bool scq_ring::dequeue(std::uint64_t& idx) {
+
+    if (threshold_.load(std::memory_order_acquire) < 0) {
+        return false;
+    }
+    for (;;) {
+        std::uint64_t head = head_.fetch_add(1, std::memory_order_acq_rel);
+        std::uint64_t head_cycle = head >> order_;
+        std::atomic<Entry>& entry = data_[remap(head)];
+        Entry e = entry.load(std::memory_order_acquire);
+        for (;;) {
+            if (cycle(e) == head_cycle) {
+                // Only the index is reset, the cycle stays, so
+                // the entry is free for the enqueuers of the next cycle
+                entry.fetch_or(BOTTOM, std::memory_order_acq_rel);
+                idx = index(e);
+                return true;
+            }
+            Entry next = (index(e) == BOTTOM)
+                ? make(head_cycle, safe(e), BOTTOM)
+                : make(cycle(e), false, index(e));
+            if (cycle(e) < head_cycle &&
+                !entry.compare_exchange_weak(e, next, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                continue;
+            }
+            break;
+        }
+        std::uint64_t tail = tail_.load(std::memory_order_acquire);
+        if (tail <= head + 1) {
+            catchup(tail, head + 1);
+            threshold_.fetch_sub(1, std::memory_order_acq_rel);
+            return false;
+        }
+        if (threshold_.fetch_sub(1, std::memory_order_acq_rel) <= 0) {
+            return false;
+        }
+    }
+}
+
+inline void scq_ring::catchup(std::uint64_t tail, std::uint64_t head) {
+
+    while (!tail_.compare_exchange_weak(tail, head, std::memory_order_acq_rel)) {
+        head = head_.load(std::memory_order_acquire);
+        tail = tail_.load(std::memory_order_acquire);
+        if (tail >= head) {
+            break;
+        }
+    }
+}
+
+template<class T>
+class lock_free_mpmc_scq_queue {
+
+private:
+
+    struct Slot {
+
+        T* get() {
+            return std::launder(reinterpret_cast<T*>(data_));
+        }
+
+        alignas(T) unsigned char data_[sizeof(T)];
+    };
+
+    static std::size_t round_size(std::size_t size) {
+        std::size_t res = 1;
+        while (res < size) {
+            res <<= 1;
+        }
+        return res;
+    }
+
+    std::size_t size_;
+    scq_ring aq_;
+    scq_ring fq_;
+    std::unique_ptr<Slot[]> data_;
+
+public:
+
+    lock_free_mpmc_scq_queue()
+    : lock_free_mpmc_scq_queue(1 << 16)
+    {}
+
+    lock_free_mpmc_scq_queue(std::size_t size)
+    : size_(round_size(size))
+    , aq_(size_, false)
+    , fq_(size_, true)
+    , data_(std::make_unique<Slot[]>(size_))
+    {}
+
+    lock_free_mpmc_scq_queue(const lock_free_mpmc_scq_queue&) = delete;
+    lock_free_mpmc_scq_queue& operator = (const lock_free_mpmc_scq_queue&) = delete;
+
+    ~lock_free_mpmc_scq_queue() {
+        std::uint64_t idx;
+        while (aq_.dequeue(idx)) {
+            data_[idx].get()->~T();
+        }
+    }
+
+    // 1. push -- returns false in case the queue is full
+
+    bool push(T val);
+
+    template<class... Args>
+    bool emplace(Args&&... args);
+
+    // 2. pop -- returns false (empty optional) in case the queue is empty.
+    // If the move out throws, the element goes to the end of the queue
+
+    bool try_pop(T& val);
+
+    std::optional<T> try_pop();
+
+    // 3. empty
+    bool empty() const {
+        return aq_.empty();
+    }
+
+    std::size_t capacity() const {
+        return size_;
+    }
+};
+
+template<class T>
+bool lock_free_mpmc_scq_queue<T>::push(T val) {
+
+    return emplace(std::move(val));
+}
+
+template<class T>
+template<class... Args>
+bool lock_free_mpmc_scq_queue<T>::emplace(Args&&... args) {
+
+    std::uint64_t idx;
+    if (!fq_.dequeue(idx)) {
+        return false;
+    }
+    try {
+        new (data_[idx].data_) T(std::forward<Args>(args)...);
+    } catch (...) {
+        fq_.enqueue(idx);
+        throw;
+    }
+    aq_.enqueue(idx);
+    return true;
+}
+
+template<class T>
+bool lock_free_mpmc_scq_queue<T>::try_pop(T& val) {
+
+    std::uint64_t idx;
+    if (!aq_.dequeue(idx)) {
+        return false;
+    }
+    T* ptr = data_[idx].get();
+    try {
+        val = std::move(*ptr);
+    } catch (...) {
+        aq_.enqueue(idx);
+        throw;
+    }
+    ptr->~T();
+    fq_.enqueue(idx);
+    return true;
+}
+
+template<class T>
+std::optional<T> lock_free_mpmc_scq_queue<T>::try_pop() {
+
+    std::uint64_t idx;
+    if (!aq_.dequeue(idx)) {
+        return std::nullopt;
+    }
+    T* ptr = data_[idx].get();
+    std::optional<T> res;
+    try {
+        res.emplace(std::move(*ptr));
+    } catch (...) {
+        aq_.enqueue(idx);
+        throw;
+    }
+    ptr->~T();
+    fq_.enqueue(idx);
+    return res;
+}
@@ -0,0 +1,386 @@
+#pragma once
+
+#include "cache-line.hpp"
+#include "hazard-pointers.hpp"
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+#include <cstddef>
+
+/*
+
+    Unbounded multiple producer multiple consumer queue, built
+    as a linked list of bounded rings (as LCRQ is built of CRQs).
+
+    Every segment is a ring with the same generation protocol as
+    lock_free_mpmc_bounded_queue: the cell with gen == pos is free for
+    the pusher of the position pos, the cell with gen == pos + 1 is
+    full for the popper of this position. As long as the consumers keep
+    up with the producers, everybody works in one segment, which is used
+    as a ring over and over again, and nothing is allocated.
+
+    Members
+
+    -> head segment (consumers pop from it)
+    -> tail segment (producers push into it)
+    -> hazard pointers for the segments
+
+    The Layout policy (see cache-line.hpp) decides whether the indices
+    of the segment and the queue sit on their own cache lines
+    (layout_padded, default), and whether every cell does too.
+
+    The tail index of the segment has the CLOSED bit. When a pusher finds
+    the segment full it sets the bit, and after that no push can take a
+    position in this segment anymore. Only a closed segment gets the next one.
+
+    PUSH
+
+    In a while loop
+    1. Protect the tail segment with the hazard pointer
+    2. If it has the next segment already -> help to move the tail, repeat
+    3. Try to push into the segment as into the bounded queue
+        -> if the segment is full, close it
+    4. If the segment is closed -> link a fresh segment after it
+        (if somebody was faster, throw ours away), move the tail, repeat
+
+    POP
+
+    In a while loop
+    1. Protect the head segment with the hazard pointer
+    2. Try to pop from the segment as from the bounded queue
+    3. If there is nothing:
+        -> if there is no next segment, the queue is empty
+        -> if the segment is not drained completely (a push into
+        it is not finished yet), the queue is empty for now
+        -> otherwise move the head to the next segment and retire
+        the drained one through the hazard pointers
+
+    The tail segment is moved forward before the head one, so a retired
+    segment can never be reached from the tail anymore.
+
+*/
+
+template<class T, std::size_t SegmentSize = 1024, class Layout = layout_padded>
+class lock_free_mpmc_unbounded_queue {
+
+    static_assert((SegmentSize & (SegmentSize - 1)) == 0, "SegmentSize has to be a power of 2");
+
+private:
+
+    template<class X>
+    static constexpr std::size_t index_align = layout_align<X, Layout::index_align>;
+
+    static constexpr std::size_t CLOSED = std::size_t(1) << (sizeof(std::size_t) * 8 - 1);
+    static constexpr std::size_t MASK = SegmentSize - 1;
+
+    struct Cell {
+        static constexpr std::size_t CELL_ALIGN = layout_align<std::atomic<std::size_t>, Layout::cell_align>;
+
+        alignas(CELL_ALIGN) std::atomic<std::size_t> gen_;
+        bool                     full_;
+        alignas(T) unsigned char data_[sizeof(T)];
+
+        T* get() {
+            return std::launder(reinterpret_cast<T*>(data_));
+        }
+    };
+
+    struct Segment {
+
+        Segment()
+        : tail_(0)
+        , head_(0)
+        , next_(nullptr)
+        {
+            for (std::size_t i = 0; i < SegmentSize; ++i) {
+                data_[i].gen_.store(i, std::memory_order_relaxed);
+                data_[i].full_ = false;
+            }
+        }
+
+        ~Segment() {
+            std::size_t tail = tail_.load(std::memory_order_acquire) & ~CLOSED;
+            for (std::size_t i = head_.load(std::memory_order_acquire); i < tail; ++i) {
+                Cell& cell = data_[i & MASK];
+                if (cell.full_) {
+                    cell.get()->~T();
+                }
+            }
+        }
+
+        template<class... Args>
+        bool try_push(Args&&... args);
+
+        template<class F>
+        bool try_pop(F&& take);
+
+        bool drained() {
+            std::size_t tail = tail_.load(std::memory_order_acquire);
+            return (tail & CLOSED) && head_.load(std::memory_order_acquire) == (tail & ~CLOSED);
+        }
+
+        alignas(index_align<std::atomic<std::size_t>>) std::atomic<std::size_t> tail_;
+        alignas(index_align<std::atomic<std::size_t>>) std::atomic<std::size_t> head_;
+        alignas(index_align<std::atomic<Segment*>>)    std::atomic<Segment*>    next_;
+        alignas(index_align<Cell>)                     Cell                     data_[SegmentSize];
+    };
+
+    using HP = typename hazard_pointers<Segment, Layout>::HP;
+
+    Segment* protect(std::atomic<Segment*>& seg, HP* hp);
+
+    template<class F>
+    bool pop_with(F&& take);
+
+    alignas(index_align<std::atomic<Segment*>>) std::atomic<Segment*> head_;
+    alignas(index_align<std::atomic<Segment*>>) std::atomic<Segment*> tail_;
+    hazard_pointers<Segment, Layout> hazard_ptrs_;
+
+public:
+
+    lock_free_mpmc_unbounded_queue()
+    : head_(new Segment())
+    , tail_(head_.load())
+    {}
+
+    lock_free_mpmc_unbounded_queue(const lock_free_mpmc_unbounded_queue&) = delete;
+    lock_free_mpmc_unbounded_queue& operator = (const lock_free_mpmc_unbounded_queue&) = delete;
+
+    ~lock_free_mpmc_unbounded_queue() {
+        Segment* seg = head_.load(std::memory_order_acquire);
+        while (seg) {
+            Segment* next = seg->next_.load(std::memory_order_acquire);
+            delete seg;
+            seg = next;
+        }
+    }
+
+    // 1. push -- never fails, allocates
+    // a new segment when the current one is full
+
+    void push(T val);
+
+    template<class... Args>
+    void emplace(Args&&... args);
+
+    // 2. pop -- returns false (empty pointer, empty optional)
+    // in case the queue is empty. If the move of the value out of
+    // the queue throws, the element is lost
+
+    std::unique_ptr<T> pop();
+
+    bool try_pop(T& val);
+
+    std::optional<T> try_pop();
+
+    // 3. empty
+    bool empty();
+};
+
+template<class T, std::size_t SegmentSize, class Layout>
+template<class... Args>
+bool lock_free_mpmc_unbounded_queue<T, SegmentSize, Layout>::Segment::try_push(Args&&... args) {
+
+    std::size_t pos = tail_.load(std::memory_order_acquire);
+    for (;;) {
+        if (pos & CLOSED) {
+            return false;
+        }
+        Cell& cell = data_[pos & MASK];
+        std::size_t gen = cell.gen_.load(std::memory_order_acquire);
+        if (gen == pos) {
+            if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_acq_rel)) {
+                try {
+                    new (cell.data_) T(std::forward<Args>(args)...);
+                    cell.full_ = true;
+                } catch (...) {
+                    // The cell is taken, give it to the popper empty
+                    cell.full_ = false;
+                    cell.gen_.store(pos + 1, std::memory_order_release);
+                    throw;
+                }
+                cell.gen_.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (gen < pos) {
+            // The cell is not popped yet in the previous round ->
+            // the segment is full, nobody pushes here anymore
+            tail_.fetch_or(CLOSED, std::memory_order_acq_rel);
+            return false;
+        } else {
+            pos = tail_.load(std::memory_order_acquire);
+        }
+    }
+}
+
+template<class T, std::size_t SegmentSize, class Layout>
+template<class F>
+bool lock_free_mpmc_unbounded_queue<T, SegmentSize, Layout>::Segment::try_pop(F&& take) {
+
+    std::size_t pos = head_.load(std::memory_order_acquire);
+    for (;;) {
+        Cell& cell = data_[pos & MASK];
+        std::size_t gen = cell.gen_.load(std::memory_order_acquire);
+        if (gen == pos + 1) {
+            if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_acq_rel)) {
+                if (!cell.full_) {
+                    // The push into this cell has thrown
+                    cell.gen_.store(pos + SegmentSize, std::memory_order_release);
+                    pos = head_.load(std::memory_order_acquire);
+                    continue;
+                }
+                T* ptr = cell.get();
+                try {
+                    take(*ptr);
+                } catch (...) {
+                    ptr->~T();
+                    cell.full_ = false;
+                    cell.gen_.store(pos + SegmentSize, std::memory_order_release);
+                    throw;
+                }
+                ptr->~T();
+                cell.full_ = false;
+                cell.gen_.store(pos + SegmentSize, std::memory_order_release);
+                return true;
+            }
+        } else if (gen < pos + 1) {
+            // Nothing is pushed into this position yet
+            return false;
+        } else {
+            pos = head_.load(std::memory_order_acquire);
+        }
+    }
+}
+
+template<class T, std::size_t SegmentSize, class Layout>
+typename lock_free_mpmc_unbounded_queue<T, SegmentSize, Layout>::Segment*
+lock_free_mpmc_unbounded_queue<T, SegmentSize, Layout>::protect(std::atomic<Segment*>& seg, HP* hp) {
+
+    Segment* ptr = seg.load(std::memory_order_acquire);
+    for (;;) {
+        hp->ptr_.store(ptr, std::memory_order_seq_cst);
+        Segment* tmp = seg.load(std::memory_order_seq_cst);
+        if (tmp == ptr) {
+            return ptr;
+        }
+        ptr = tmp;
+    }
+}
+
+template<class T, std::size_t SegmentSize, class Layout>
+void lock_free_mpmc_unbounded_queue<T, SegmentSize, Layout>::push(T val) {
+
+    emplace(std::move(val));
+}
+
+template<class T, std::size_t SegmentSize, class Layout>
+template<class... Args>
+void lock_free_mpmc_unbounded_queue<T, SegmentSize, Layout>::emplace(Args&&... args) {
+
+    HP* hp = hazard_ptrs_.acquire_hazard();
+    for (;;) {
+        Segment* seg = protect(tail_, hp);
+        Segment* next = seg->next_.load(std::memory_order_acquire);
+        if (next) {
+            tail_.compare_exchange_strong(seg, next, std::memory_order_acq_rel);
+            continue;
+        }
+        try {
+            if (seg->try_push(std::forward<Args>(args)...)) {
+                break;
+            }
+        } catch (...) {
+            hazard_ptrs_.release_hazard(hp);
+            throw;
+        }
+        // The segment is closed: it gets the next one
+        Segment* seg_new = new Segment();
+        if (seg->next_.compare_exchange_strong(next, seg_new, std::memory_order_acq_rel)) {
+            tail_.compare_exchange_strong(seg, seg_new, std::memory_order_acq_rel);
+        } else {
+            delete seg_new;
+        }
+    }
+    hazard_ptrs_.release_hazard(hp);
+}
+
+template<class T, std::size_t SegmentSize, class Layout>
+template<class F>
+bool lock_free_mpmc_unbounded_queue<T, SegmentSize, Layout>::pop_with(F&& take) {
+
+    HP* hp = hazard_ptrs_.acquire_hazard();
+    bool res = false;
+    for (;;) {
+        Segment* seg = protect(head_, hp);
+        try {
+            if (seg->try_pop(take)) {
+                res = true;
+                break;
+            }
+        } catch (...) {
+            hazard_ptrs_.release_hazard(hp);
+            throw;
+        }
+        Segment* next = seg->next_.load(std::memory_order_acquire);
+        if (!next || !seg->drained()) {
+            break;
+        }
+        // Move the tail first, so that the retired
+        // segment is not reachable from it
+        Segment* tail = seg;
+        tail_.compare_exchange_strong(tail, next, std::memory_order_acq_rel);
+        if (head_.compare_exchange_strong(seg, next, std::memory_order_acq_rel)) {
+            hazard_ptrs_.release_hazard(hp);
+            hazard_ptrs_.reclaim_later(seg);
+            // Segments are retired rarely, but they are big,
+            // so we do not wait for the list to grow
+            hazard_ptrs_.delete_nodes_with_no_hazards();
+            hp = hazard_ptrs_.acquire_hazard();
+        }
+    }
+    hazard_ptrs_.release_hazard(hp);
+    return res;
+}
+
+template<class T, std::size_t SegmentSize, class Layout>
+std::unique_ptr<T> lock_free_mpmc_unbounded_queue<T, SegmentSize, Layout>::pop() {
+
+    std::unique_ptr<T> res;
+    pop_with([&res](T& val) {
+        res = std::make_unique<T>(std::move(val));
+    });
+    return res;
+}
+
+template<class T, std::size_t SegmentSize, class Layout>
+bool lock_free_mpmc_unbounded_queue<T, SegmentSize, Layout>::try_pop(T& val) {
+
+    return pop_with([&val](T& cell) {
+        val = std::move(cell);
+    });
+}
+
+template<class T, std::size_t SegmentSize, class Layout>
+std::optional<T> lock_free_mpmc_unbounded_queue<T, SegmentSize, Layout>::try_pop() {
+
+    std::optional<T> res;
+    pop_with([&res](T& val) {
+        res.emplace(std::move(val));
+    });
+    return res;
+}
+
+template<class T, std::size_t SegmentSize, class Layout>
+bool lock_free_mpmc_unbounded_queue<T, SegmentSize, Layout>::empty() {
+
+    HP* hp = hazard_ptrs_.acquire_hazard();
+    Segment* seg = protect(head_, hp);
+    std::size_t head = seg->head_.load(std::memory_order_acquire);
+    std::size_t tail = seg->tail_.load(std::memory_order_acquire) & ~CLOSED;
+    bool res = (head == tail) && !seg->next_.load(std::memory_order_acquire);
+    hazard_ptrs_.release_hazard(hp);
+    return res;
+}
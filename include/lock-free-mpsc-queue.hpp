@@ -1,120 +1,114 @@
 #pragma once
 
+#include "cache-line.hpp"
+#include "intrusive-hook.hpp"
+
 #include <memory>
 #include <atomic>
-#include <iostream>
-#include <assert.h>
+#include <utility>
+#include <cstddef>
 
 /*
 
-The implementation of the queue supporst the functionality for
-1. Single producer
-2. Multiple consumers
-
-We use reference counting approach in order to deal
-with dagling pointers problem
-i.e. we shall not delete nodes, where the number of
-external references is non 0
-
-The members of the queue are:
-    - atomic node* head
-    - atomic node* tail
-
-Each node consitst of
-    - shared ptr to data
-    - atomic internal counter
-    - atomic struct for next
-        -> with next ptr
-        -> external counter
-
-Push
-    1. Create new external counter
-        -> with count value equal to 1
-        -> next value equal to the dummy node
-    2. Set value in tail for new ptr
-    3. If managed, then set another next to the tail
-    4. Atomically change the tail to the new external count (the one that we created)
-
-Pop
-    1. Take the pointer to the current head
-    2. Increase the external pointer by 1
-    3. Try to pop (exhange head with head_next)
-    4. If you managed
-        --> save the result
-        --> call separate function
-        --> atomically change the value of internal counter to += external - 2
-        --> In case we have that internal counter became 0 => delete ptr
-        --> return shared ptr
-    5. If you failed -> decrease the reference in internal counter
-
-Observe that we need only one refernce counter
-Since multiple threads can h
-
-For pop
-    Check that head is not equal to tail
-    if it is not, then pop as usual
+    Multiple producers single consumer queue of D. Vyukov
+    (the non-intrusive version of his intrusive MPSC node queue).
+
+    Members
+
+    -> head -- the last pushed node (written by the producers)
+    -> tail -- the stub node, the one before the first element
+               (written by the consumer only, not atomic)
+
+    Every node has an atomic next and the pointer to the value.
+    There is always at least one node -- the stub, whose value is
+    already taken. The list goes from tail to head.
+
+    PUSH (wait-free)
+
+    1. Allocate the value and the node, next = nullptr
+    2. Exchange head with the new node -> previous node
+    3. previous->next = new node (release)
+
+    There is no loop: every producer is done after one exchange
+    and one store, whatever the others do.
+
+    POP (no read-modify-write)
+
+    1. next = tail->next (acquire)
+        -> nullptr, the queue is empty
+    2. Take the value out of next, next becomes the new stub
+    3. Delete the old stub
+
+    Between the steps 2 and 3 of push the new node is not linked
+    yet. If the producer is preempted there, the consumer sees the
+    queue as empty (and everything pushed after it) until the producer
+    runs again. That is the price for the wait-free push, nothing is
+    lost, but pop is not linearizable.
+
+    Only one thread is allowed to pop.
+
+    DRAIN
+
+    The chain from tail to head belongs to the consumer already, so
+    to take everything that has arrived it does not need even one
+    exchange: drain walks the chain in FIFO order with one acquire
+    load per node and no read-modify-write, and stops at the first
+    node that is not linked yet. Nothing has to be reversed either,
+    the list goes from the oldest element to the newest.
+
+    INTRUSIVE
+
+    lock_free_intrusive_mpsc_queue is the original intrusive version:
+    the caller's objects (see intrusive-hook.hpp) are the nodes, so
+    nothing is allocated. The stub can not be one of them, as pop gives
+    every object back to the caller, so the queue has its own stub hook,
+    and when the consumer reaches the last object, it pushes the stub
+    behind it to be able to let it go:
+
+    1. Skip the stub, if tail is it
+    2. tail has next -> tail becomes next, return the old tail
+    3. tail is the last one (head) -> push the stub, and go to 2 once more
+       (tail is not head -> a producer is in the middle of push, empty)
+
 */
 
-template <class T>
+template<class T, class Layout = layout_padded>
 class lock_free_mpsc_queue {
 
 private:
 
-    struct Node;
-
-    struct external_count {
-        int external_count_;
-        Node* node_;
-    };
-
-    struct internal_count {
-        unsigned internal_count_ : 30;
-        unsigned ext_counters_    : 2;
-    };
+    template<class X>
+    static constexpr std::size_t index_align = layout_align<X, Layout::index_align>;
 
     struct Node {
 
-        Node()
-        {
-            external_count ext_cnt;
-            ext_cnt.external_count_ = 0;
-            ext_cnt.node_ = nullptr;
-            next_.store(ext_cnt);
-            internal_count intr_cnt;
-            intr_cnt.internal_count_  = 0; 
-            intr_cnt.ext_counters_    = 2;
-            counter_.store(intr_cnt);
-            data_.store(nullptr);
-        }
+        Node(T* data = nullptr)
+        : next_(nullptr)
+        , data_(data)
+        {}
 
-        void ref_release();
-
-        std::atomic<external_count> next_;
-        // # 1. This part should be changed for 
-        // struct with counter and counter for external counts
-        std::atomic<internal_count> counter_;
-        // # 2. Becomes atomic pointer
-        // In order to swap it in push
-        std::atomic<T*> data_;
+        std::atomic<Node*> next_;
+        // nullptr in the stub
+        T*                 data_;
     };
 
-    void increase_external(std::atomic<external_count>&, external_count&);
+    // Takes the first node with the value, if there is any
+    // (its value is still in it), and makes it the stub
+    Node* pop_node();
 
-    void free_external(external_count& old_count);
+    // Producers part
+    alignas(index_align<std::atomic<Node*>>) std::atomic<Node*> head_;
 
-    std::atomic<external_count> head_;
-    std::atomic<external_count> tail_;
+    // Consumer part
+    alignas(index_align<Node*>) Node* tail_;
 
 public:
 
     lock_free_mpsc_queue()
     {
-        Node* node = new Node();
-        external_count cnt;
-        cnt.node_ = node;
-        cnt.external_count_ = 2;
-        tail_.store(cnt);
-        head_.store(cnt);
+        Node* stub = new Node();
+        head_.store(stub, std::memory_order_relaxed);
+        tail_ = stub;
     }
 
     lock_free_mpsc_queue(const lock_free_mpsc_queue&) = delete;
@@ -123,142 +117,196 @@ public:
     ~lock_free_mpsc_queue() {
 
         while(pop());
-        assert(empty());
-
-        delete head_.load().node_;
+        delete tail_;
     }
 
+    // 1. push -- wait-free, any thread
+
     void push(T val);
 
-    // Sorrowly only one version of pop
-    // is available in this case due to exception
-    // safety. If we were to use pop(T&) version, then
-    // at some point we have to copy or move T type, leading
-    // to possibility of exception in copy/move assignment
+    // 2. pop -- consumer thread only, returns nullptr
+    // (false) in case the queue is empty. If the move
+    // assignment in try_pop throws, the element stays
+
     std::unique_ptr<T> pop();
 
-    bool empty();
+    bool try_pop(T& val);
 
+    // 3. drain -- consumer thread only, passes every element
+    // that has arrived to f(T&) in FIFO order, returns their
+    // number. If f throws, the element stays in the queue
+
+    template<class F>
+    std::size_t drain(F&& f);
+
+    // 4. empty -- consumer thread only
+
+    bool empty() const {
+        return tail_->next_.load(std::memory_order_acquire) == nullptr;
+    }
 };
 
-template<class T>
-void lock_free_mpsc_queue<T>::increase_external(std::atomic<external_count>& target,
-                                                external_count& old_count) {
+template<class T, class Layout>
+void lock_free_mpsc_queue<T, Layout>::push(T val) {
 
-    external_count count_new;
-    do {
-        count_new = old_count;
-        ++count_new.external_count_;
-    } while (!target.compare_exchange_strong(old_count, count_new));
-    old_count.external_count_ = count_new.external_count_;
+    std::unique_ptr<T> data_new(new T(std::move(val)));
+    Node* node = new Node(data_new.get());
+    data_new.release();
+    Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+    prev->next_.store(node, std::memory_order_release);
 }
 
-template<class T>
-void lock_free_mpsc_queue<T>::Node::ref_release() {
-
-    // # 6. Now we cannot just substract, so we need
-    // CAS loop to decrease internal count structure by 1
-    internal_count count_old = counter_.load();
-    internal_count count_new;
-    do {
-        count_new = count_old;
-        --count_new.internal_count_;
-    } while (!counter_.compare_exchange_strong(count_old, count_new));
-    // # 7. In the end we check if internal counter is 0 and number
-    // of external counters is 2
-    if (!count_new.internal_count_ && !count_new.ext_counters_) {
-        delete this;
+template<class T, class Layout>
+typename lock_free_mpsc_queue<T, Layout>::Node* lock_free_mpsc_queue<T, Layout>::pop_node() {
+
+    Node* next = tail_->next_.load(std::memory_order_acquire);
+    if (next == nullptr) {
+        return nullptr;
     }
+    delete tail_;
+    tail_ = next;
+    return next;
 }
 
-template<class T>
-void lock_free_mpsc_queue<T>::free_external(external_count& extr) {
-
-    Node* const ptr = extr.node_;
-    int const internal_upd = extr.external_count_ - 2;
-    // # 8. Save old counter
-    // Decrease the number of external counters
-    // And update the internal
-    internal_count count_old = ptr->counter_.load();
-    internal_count count_new;
-    do {
-        count_new = count_old;
-        --count_new.ext_counters_;
-        count_new.internal_count_ += internal_upd;
-    } while (!ptr->counter_.compare_exchange_strong(count_old, count_new));
-
-    // # 9. In case internal counter is 0 and the number of external counters is 0
-    // delete pointer 
-    if (!count_new.internal_count_ && !count_new.ext_counters_) {
-        delete ptr;
+template<class T, class Layout>
+std::unique_ptr<T> lock_free_mpsc_queue<T, Layout>::pop() {
+
+    Node* node = pop_node();
+    if (node == nullptr) {
+        return std::unique_ptr<T>();
     }
+    std::unique_ptr<T> res(node->data_);
+    node->data_ = nullptr;
+    return res;
 }
 
-template<class T> 
-void lock_free_mpsc_queue<T>::push(T val) {
-
-    // # 3. Instead of putting pointer in shared_ptr
-    // put it in unique_ptr
-    std::unique_ptr<T> data_new(new T(val));
-    external_count count_new;
-    count_new.node_ = new Node();
-    count_new.external_count_ = 1;
-    external_count old_tail = tail_.load();
-    // # 4. Here we swtich to a similar loop as in pop
-    // In the CAS if statement set the pointer of node that
-    // unique ptr is pointing to, and release the ptr in unique pointer
-    for (;;) {
-
-        increase_external(tail_, old_tail);
-        T* old_data = nullptr;
-        if (old_tail.node_->data_.compare_exchange_strong(old_data, data_new.get())) {
-            old_tail.node_->next_.store(count_new);
-            old_tail = tail_.exchange(count_new); 
-            free_external(old_tail);
-            data_new.release();
-            break ;
-        }
-        old_tail.node_->ref_release();
+template<class T, class Layout>
+bool lock_free_mpsc_queue<T, Layout>::try_pop(T& val) {
+
+    Node* next = tail_->next_.load(std::memory_order_acquire);
+    if (next == nullptr) {
+        return false;
     }
+    // Can throw, the queue is not changed yet
+    val = std::move(*next->data_);
+    pop();
+    return true;
 }
 
-template<class T> 
-std::unique_ptr<T> lock_free_mpsc_queue<T>::pop() {
-
-    external_count old_head = head_.load();
-    for(;;) {
-        // # 5. Fix this function, making it use external count atomic (head_ or tail_)
-        increase_external(head_, old_head);
-        Node* const ptr = old_head.node_;
-        if (ptr == tail_.load().node_) {
-            ptr->ref_release();
-            return std::unique_ptr<T>();
-        }
-        if (head_.compare_exchange_strong(old_head, ptr->next_)) {
-            T* const res = ptr->data_.exchange(nullptr);
-            free_external(old_head);
-            return std::unique_ptr<T>(res);
-        }
-        ptr->ref_release();
+template<class T, class Layout>
+template<class F>
+std::size_t lock_free_mpsc_queue<T, Layout>::drain(F&& f) {
+
+    std::size_t count = 0;
+    Node* next;
+    while ((next = tail_->next_.load(std::memory_order_acquire)) != nullptr) {
+        f(*next->data_);
+        delete next->data_;
+        next->data_ = nullptr;
+        delete tail_;
+        tail_ = next;
+        ++count;
     }
+    return count;
 }
 
+template<class T, class Layout = layout_padded>
+class lock_free_intrusive_mpsc_queue {
+
+    static_assert(is_intrusive_v<T>, "T has to derive from intrusive_hook");
+
+private:
+
+    template<class X>
+    static constexpr std::size_t index_align = layout_align<X, Layout::index_align>;
+
+    void push_hook(intrusive_hook* hook);
+
+    // Producers part
+    alignas(index_align<std::atomic<intrusive_hook*>>) std::atomic<intrusive_hook*> head_;
+
+    // Consumer part
+    alignas(index_align<intrusive_hook*>) intrusive_hook* tail_;
+    intrusive_hook                                        stub_;
+
+public:
+
+    lock_free_intrusive_mpsc_queue()
+    : head_(&stub_)
+    , tail_(&stub_)
+    {}
+
+    lock_free_intrusive_mpsc_queue(const lock_free_intrusive_mpsc_queue&) = delete;
+    lock_free_intrusive_mpsc_queue& operator = (const lock_free_intrusive_mpsc_queue&) = delete;
+
+    // 1. push -- wait-free, any thread. The object stays
+    // the caller's, the queue only links it
+
+    void push(T* obj) {
+        push_hook(obj);
+    }
+
+    // 2. pop -- consumer thread only, returns nullptr in
+    // case the queue is empty (or the next push is not
+    // finished yet)
 
-template<class T> 
-bool lock_free_mpsc_queue<T>::empty() {
+    T* pop();
 
-    external_count head_count = head_.load();
-    external_count tail_count = tail_.load();
-    for(;;) {
-        increase_external(head_, head_count);
-        increase_external(tail_, tail_count);
-        if (head_count.node_ == tail_count.node_) {
-            head_count.node_->ref_release();
-            tail_count.node_->ref_release();
-            return true;
+    // 3. drain -- consumer thread only, passes every
+    // object that has arrived to f(T*) in FIFO order,
+    // returns their number
+
+    template<class F>
+    std::size_t drain(F&& f) {
+        std::size_t count = 0;
+        while (T* obj = pop()) {
+            f(obj);
+            ++count;
+        }
+        return count;
+    }
+
+    // 4. empty -- consumer thread only
+
+    bool empty() const {
+        return tail_ == &stub_ && stub_.next_.load(std::memory_order_acquire) == nullptr;
+    }
+};
+
+template<class T, class Layout>
+void lock_free_intrusive_mpsc_queue<T, Layout>::push_hook(intrusive_hook* hook) {
+
+    hook->next_.store(nullptr, std::memory_order_relaxed);
+    intrusive_hook* prev = head_.exchange(hook, std::memory_order_acq_rel);
+    prev->next_.store(hook, std::memory_order_release);
+}
+
+template<class T, class Layout>
+T* lock_free_intrusive_mpsc_queue<T, Layout>::pop() {
+
+    intrusive_hook* tail = tail_;
+    intrusive_hook* next = tail->next_.load(std::memory_order_acquire);
+    if (tail == &stub_) {
+        if (next == nullptr) {
+            return nullptr;
         }
-        head_count.node_->ref_release();
-        tail_count.node_->ref_release();
+        tail_ = next;
+        tail = next;
+        next = next->next_.load(std::memory_order_acquire);
     }
-    return false;
-}
\ No newline at end of file
+    if (next) {
+        tail_ = next;
+        return static_cast<T*>(tail);
+    }
+    if (tail != head_.load(std::memory_order_acquire)) {
+        // A producer has taken head, but has not linked it yet
+        return nullptr;
+    }
+    push_hook(&stub_);
+    next = tail->next_.load(std::memory_order_acquire);
+    if (next) {
+        tail_ = next;
+        return static_cast<T*>(tail);
+    }
+    return nullptr;
+}
@@ -0,0 +1,327 @@
+#pragma once
+
+#include "cache-line.hpp"
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <vector>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <cstddef>
+
+/*
+
+    Multicast ring after the LMAX Disruptor: one ring, and every
+    consumer sees every element of it, instead of a queue (and a copy
+    of the element) per consumer.
+
+    Members
+
+    -> head -- the next sequence for the producers
+    -> array of cells, every cell with the generation stamp as in
+       lock_free_mpmc_bounded_queue: the cell of the sequence s is
+       published, when its stamp is s + 1
+    -> cursor per consumer -- the next sequence that it is going to read
+       (written by this consumer only)
+
+    The ring does not give the elements away: the consumers read them
+    in place by const reference, and an element stays in its cell until
+    the producer comes to this cell in the next round.
+
+    Gating
+
+    The producer can take the sequence s only when every consumer has
+    read the element s - size that sits in its cell. It is enough to look
+    at the consumers nobody depends on (see below), because the others are
+    always ahead of them. As in the spsc ring, the producer keeps the
+    minimum of these cursors cached and looks at the cursors only when the
+    cached value says that the ring is full.
+
+    Dependencies
+
+    A consumer can be registered after the others, then it reads the
+    sequence s only when all of them have moved past s (the risk check
+    sees only the journaled events). It keeps the minimum of their cursors
+    cached the same way.
+
+    PUSH
+
+    1. Take the next sequence (single producer -- just its own head,
+       MultiProducer -- cas on the head), if the slowest cursor lets it
+        -> otherwise return false
+    2. Destroy the old value of the previous round, construct the new one
+    3. Publish the cell by storing the stamp s + 1 with release
+
+    READ (read_bulk)
+
+    1. While the cell at own cursor has the stamp of the cursor,
+       and the dependencies have passed it
+        -> pass the value to f, move to the next sequence
+    2. Store the cursor once for the whole batch with release
+
+    With several producers a thread that has taken a sequence can be
+    late to publish it, the consumers just wait for its stamp. If its
+    constructor throws, the cell is published empty and skipped.
+
+    The consumers are registered before the producers start, every
+    consumer is one thread. The cursors are never wrapped, as everywhere.
+
+*/
+
+template<class T, bool MultiProducer = false, class Layout = layout_padded>
+class lock_free_multicast_ring {
+
+private:
+
+    template<class X>
+    static constexpr std::size_t index_align = layout_align<X, Layout::index_align>;
+
+    static constexpr std::size_t CELL_ALIGN = layout_align<std::atomic<std::size_t>, Layout::cell_align>;
+
+    struct Cell {
+
+        Cell() : stamp_(0), full_(false) {}
+
+        T* get() {
+            return std::launder(reinterpret_cast<T*>(data_));
+        }
+
+        alignas(CELL_ALIGN) std::atomic<std::size_t> stamp_;
+        bool             full_;
+        alignas(T) unsigned char data_[sizeof(T)];
+    };
+
+    struct Cursor {
+
+        // Next sequence to read, written by its consumer only
+        alignas(index_align<std::atomic<std::size_t>>) std::atomic<std::size_t> seq_;
+        // The dependencies have read everything before it
+        std::size_t                deps_cache_;
+        std::vector<const Cursor*> deps_;
+    };
+
+    // The smallest sequence of the cursors, bound -- the
+    // sequence that none of them can be ahead of
+    static std::size_t min_seq(const std::vector<const Cursor*>& cursors, std::size_t bound);
+
+    // Claims the sequence for the push, false if the ring is full
+    bool claim(std::size_t& seq);
+
+    // Producer part
+    alignas(index_align<std::atomic<std::size_t>>) std::atomic<std::size_t> head_;
+    std::atomic<std::size_t>                       gate_cache_;
+
+    // Read only after the consumers are registered
+    alignas(index_align<std::unique_ptr<Cell[]>>)  std::unique_ptr<Cell[]>  data_;
+    std::size_t                                    size_;
+    std::size_t                                    MASK;
+    std::vector<std::unique_ptr<Cursor>>           cursors_;
+    std::vector<const Cursor*>                     gating_;
+
+public:
+
+    lock_free_multicast_ring()
+    : lock_free_multicast_ring(1 << 16)
+    {}
+
+    lock_free_multicast_ring(std::size_t size)
+    : head_(0)
+    , gate_cache_(0)
+    {
+        size_ = 1;
+        while (size_ < size) {
+            size_ <<= 1;
+        }
+        data_ = std::make_unique<Cell[]>(size_);
+        MASK = size_ - 1;
+    }
+
+    lock_free_multicast_ring(const lock_free_multicast_ring&) = delete;
+    lock_free_multicast_ring& operator = (const lock_free_multicast_ring&) = delete;
+
+    ~lock_free_multicast_ring() {
+        for (std::size_t i = 0; i < size_; ++i) {
+            if (data_[i].full_) {
+                data_[i].get()->~T();
+            }
+        }
+    }
+
+    // 1. add_consumer -- registers a consumer, that reads
+    // everything pushed from now on, after all the consumers
+    // in deps have read it. Returns the id of the consumer.
+    // Not thread safe, call it before the producers start
+
+    std::size_t add_consumer(std::initializer_list<std::size_t> deps = {});
+
+    // 2. push -- returns false in case the slowest
+    // consumer has not read the cell of the previous round yet
+
+    bool push(T val);
+
+    template<class... Args>
+    bool emplace(Args&&... args);
+
+    // 3. read -- the consumer copies the next element (passes at
+    // most max elements to f(const T&)), returns false (0) in case
+    // there is nothing to read yet. If f throws, the element stays unread
+
+    bool try_read(std::size_t consumer, T& val);
+
+    template<class F>
+    std::size_t read_bulk(std::size_t consumer, F&& f, std::size_t max);
+
+    std::size_t capacity() const {
+        return size_;
+    }
+};
+
+template<class T, bool MultiProducer, class Layout>
+std::size_t lock_free_multicast_ring<T, MultiProducer, Layout>::min_seq(const std::vector<const Cursor*>& cursors, std::size_t bound) {
+
+    // The differences are wrap-safe
+    std::size_t res = bound;
+    for (const Cursor* c : cursors) {
+        std::size_t seq = c->seq_.load(std::memory_order_acquire);
+        if (static_cast<std::ptrdiff_t>(seq - res) < 0) {
+            res = seq;
+        }
+    }
+    return res;
+}
+
+template<class T, bool MultiProducer, class Layout>
+std::size_t lock_free_multicast_ring<T, MultiProducer, Layout>::add_consumer(std::initializer_list<std::size_t> deps) {
+
+    auto cursor = std::make_unique<Cursor>();
+    std::size_t head = head_.load(std::memory_order_acquire);
+    cursor->seq_.store(head, std::memory_order_release);
+    cursor->deps_cache_ = head;
+    for (std::size_t id : deps) {
+        if (id >= cursors_.size()) {
+            throw std::invalid_argument("multicast ring: unknown consumer " + std::to_string(id));
+        }
+        cursor->deps_.push_back(cursors_[id].get());
+    }
+    cursors_.push_back(std::move(cursor));
+
+    // Only the consumers nobody depends on gate the producer
+    gating_.clear();
+    for (auto& c : cursors_) {
+        bool leaf = true;
+        for (auto& other : cursors_) {
+            for (const Cursor* dep : other->deps_) {
+                leaf = leaf && (dep != c.get());
+            }
+        }
+        if (leaf) {
+            gating_.push_back(c.get());
+        }
+    }
+    return cursors_.size() - 1;
+}
+
+template<class T, bool MultiProducer, class Layout>
+bool lock_free_multicast_ring<T, MultiProducer, Layout>::claim(std::size_t& seq) {
+
+    for (;;) {
+        seq = head_.load(MultiProducer ? std::memory_order_acquire : std::memory_order_relaxed);
+        if (seq - gate_cache_.load(std::memory_order_relaxed) >= size_) {
+            std::size_t gate = min_seq(gating_, seq);
+            gate_cache_.store(gate, std::memory_order_relaxed);
+            if (seq - gate >= size_) {
+                return false;
+            }
+        }
+        if constexpr (!MultiProducer) {
+            return true;
+        } else if (head_.compare_exchange_weak(seq, seq + 1, std::memory_order_acq_rel)) {
+            return true;
+        }
+    }
+}
+
+template<class T, bool MultiProducer, class Layout>
+bool lock_free_multicast_ring<T, MultiProducer, Layout>::push(T val) {
+
+    return emplace(std::move(val));
+}
+
+template<class T, bool MultiProducer, class Layout>
+template<class... Args>
+bool lock_free_multicast_ring<T, MultiProducer, Layout>::emplace(Args&&... args) {
+
+    std::size_t seq;
+    if (!claim(seq)) {
+        return false;
+    }
+    // Every consumer is done with the old value
+    Cell& cell = data_[seq & MASK];
+    if (cell.full_) {
+        cell.get()->~T();
+        cell.full_ = false;
+    }
+    try {
+        new (cell.data_) T(std::forward<Args>(args)...);
+        cell.full_ = true;
+    } catch (...) {
+        if constexpr (MultiProducer) {
+            // The sequence is taken, publish it empty
+            cell.stamp_.store(seq + 1, std::memory_order_release);
+        }
+        throw;
+    }
+    cell.stamp_.store(seq + 1, std::memory_order_release);
+    if constexpr (!MultiProducer) {
+        head_.store(seq + 1, std::memory_order_release);
+    }
+    return true;
+}
+
+template<class T, bool MultiProducer, class Layout>
+bool lock_free_multicast_ring<T, MultiProducer, Layout>::try_read(std::size_t consumer, T& val) {
+
+    return read_bulk(consumer, [&val](const T& cell) {
+        val = cell;
+    }, 1) == 1;
+}
+
+template<class T, bool MultiProducer, class Layout>
+template<class F>
+std::size_t lock_free_multicast_ring<T, MultiProducer, Layout>::read_bulk(std::size_t consumer, F&& f, std::size_t max) {
+
+    Cursor& cursor = *cursors_[consumer];
+    std::size_t start = cursor.seq_.load(std::memory_order_relaxed);
+    std::size_t seq = start;
+    std::size_t count = 0;
+    try {
+        while (count < max) {
+            if (!cursor.deps_.empty() && seq == cursor.deps_cache_) {
+                cursor.deps_cache_ = min_seq(cursor.deps_, seq + size_);
+                if (seq == cursor.deps_cache_) {
+                    break;
+                }
+            }
+            Cell& cell = data_[seq & MASK];
+            if (cell.stamp_.load(std::memory_order_acquire) != seq + 1) {
+                break;
+            }
+            if (cell.full_) {
+                f(static_cast<const T&>(*cell.get()));
+                ++count;
+            }
+            ++seq;
+        }
+    } catch (...) {
+        cursor.seq_.store(seq, std::memory_order_release);
+        throw;
+    }
+    // Nothing new -- do not touch the line the producer reads
+    if (seq != start) {
+        cursor.seq_.store(seq, std::memory_order_release);
+    }
+    return count;
+}
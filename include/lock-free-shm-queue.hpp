@@ -0,0 +1,474 @@
+#pragma once
+
+#include "cache-line.hpp"
+
+#include <atomic>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <cerrno>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+
+    Bounded queues that live in POSIX shared memory, so that
+    two processes can talk through them without any syscall
+    on the way of an element.
+
+    There are two of them:
+
+    -> lock_free_shm_spsc_queue -- the ring queue for one producer
+        and one consumer (same algorithm as lock_free_spsc_ring_queue)
+    -> lock_free_shm_mpmc_queue -- the queue with generations for multiple
+        producers and consumers (same idea as lock_free_mpmc_bounded_queue)
+
+    One process creates the queue with a name and a size, that creates
+    /dev/shm/<name>. The other processes attach to it by the name only.
+    The one who created the segment removes the name in the destructor,
+    the ones who attached just unmap it.
+
+    Layout of the segment
+
+    -> control block: magic, size and size of the element,
+        the indices (each on its own cache line)
+    -> array of cells
+
+    The segment can be mapped at different addresses in different processes,
+    therefore nothing in it is a pointer: the indices are positions in the
+    array, and every process computes the addresses from its own mapping.
+    For the same reason T has to be trivially copyable (it is copied
+    byte by byte and nobody owns its resources), and the atomics have to be
+    always lock-free (otherwise their lock would be process local).
+
+    The creator publishes the control block by storing the magic last,
+    attach throws, if the segment is not ready or was created for
+    another type.
+
+*/
+
+// Owner of the mapping of a named shared memory segment
+class shm_region {
+
+public:
+
+    // Create the segment of the given size. Throws if it already exists
+    shm_region(const std::string& name, std::size_t size)
+    : name_(name)
+    , owner_(true)
+    {
+        fd_ = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd_ == -1) {
+            throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+        }
+        if (::ftruncate(fd_, size) == -1) {
+            int err = errno;
+            ::close(fd_);
+            ::shm_unlink(name.c_str());
+            throw std::system_error(err, std::generic_category(), "ftruncate " + name);
+        }
+        map(size);
+    }
+
+    // Attach to the existing segment
+    explicit shm_region(const std::string& name)
+    : name_(name)
+    , owner_(false)
+    {
+        fd_ = ::shm_open(name.c_str(), O_RDWR, 0);
+        if (fd_ == -1) {
+            throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+        }
+        struct stat st;
+        if (::fstat(fd_, &st) == -1) {
+            int err = errno;
+            ::close(fd_);
+            throw std::system_error(err, std::generic_category(), "fstat " + name);
+        }
+        map(st.st_size);
+    }
+
+    shm_region(const shm_region&) = delete;
+    shm_region& operator = (const shm_region&) = delete;
+
+    ~shm_region() {
+        ::munmap(addr_, size_);
+        ::close(fd_);
+        if (owner_) {
+            ::shm_unlink(name_.c_str());
+        }
+    }
+
+    void* data() const {
+        return addr_;
+    }
+
+    std::size_t size() const {
+        return size_;
+    }
+
+private:
+
+    void map(std::size_t size) {
+        size_ = size;
+        addr_ = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (addr_ == MAP_FAILED) {
+            int err = errno;
+            ::close(fd_);
+            if (owner_) {
+                ::shm_unlink(name_.c_str());
+            }
+            throw std::system_error(err, std::generic_category(), "mmap " + name_);
+        }
+    }
+
+    std::string name_;
+    bool        owner_;
+    int         fd_;
+    void*       addr_;
+    std::size_t size_;
+};
+
+// Control block at the beginning of the segment.
+// Cells start at the next cache line after it
+struct shm_queue_control {
+
+    std::atomic<std::uint64_t> magic_;
+    std::uint64_t              size_;
+    std::uint64_t              elem_size_;
+
+    // Producer part
+    alignas(cache_line_size) std::atomic<std::size_t> tail_;
+
+    // Consumer part
+    alignas(cache_line_size) std::atomic<std::size_t> head_;
+};
+
+static_assert(std::atomic<std::size_t>::is_always_lock_free,
+              "shared memory queues need address-free atomics");
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+              "shared memory queues need address-free atomics");
+
+/*
+
+    SPSC
+
+    The same ring as lock_free_spsc_ring_queue: the indices grow forever
+    and are taken & MASK, each side keeps a cached copy of the index of
+    the other side in its own process, and reloads it only when the queue
+    looks full (empty).
+
+*/
+
+template<class T>
+class lock_free_shm_spsc_queue {
+
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "only trivially copyable types can be shared between processes");
+    static_assert(alignof(T) <= cache_line_size, "over aligned types are not supported");
+
+private:
+
+    static constexpr std::uint64_t MAGIC = 0x73707363'71756575;     // "spscqueu"
+
+    static std::size_t round_size(std::size_t size) {
+        std::size_t res = 1;
+        while (res < size) {
+            res <<= 1;
+        }
+        return res;
+    }
+
+    static std::size_t bytes(std::size_t size) {
+        return sizeof(shm_queue_control) + size * sizeof(T);
+    }
+
+    void attach();
+
+    shm_region         region_;
+    shm_queue_control* ctl_;
+    T*                 data_;
+    std::size_t        size_;
+    std::size_t        MASK;
+
+    // Process local caches
+    alignas(cache_line_size) std::size_t head_cache_;
+    alignas(cache_line_size) std::size_t tail_cache_;
+
+public:
+
+    // Create the queue with the name (without "/dev/shm")
+    // for at least size elements
+    lock_free_shm_spsc_queue(const std::string& name, std::size_t size)
+    : region_(name, bytes(round_size(size)))
+    {
+        ctl_ = new (region_.data()) shm_queue_control();
+        ctl_->size_ = round_size(size);
+        ctl_->elem_size_ = sizeof(T);
+        ctl_->tail_.store(0, std::memory_order_relaxed);
+        ctl_->head_.store(0, std::memory_order_relaxed);
+        ctl_->magic_.store(MAGIC, std::memory_order_release);
+        attach();
+    }
+
+    // Attach to the queue created by another process
+    explicit lock_free_shm_spsc_queue(const std::string& name)
+    : region_(name)
+    {
+        ctl_ = static_cast<shm_queue_control*>(region_.data());
+        if (region_.size() < sizeof(shm_queue_control) ||
+            ctl_->magic_.load(std::memory_order_acquire) != MAGIC ||
+            ctl_->elem_size_ != sizeof(T) ||
+            region_.size() < bytes(ctl_->size_)) {
+            throw std::runtime_error("shared memory segment " + name + " is not an spsc queue of T");
+        }
+        attach();
+    }
+
+    lock_free_shm_spsc_queue(const lock_free_shm_spsc_queue&) = delete;
+    lock_free_shm_spsc_queue& operator = (const lock_free_shm_spsc_queue&) = delete;
+
+    // 1. push -- returns false in case the queue is full.
+    // Only one thread (of all the processes) is supposed to push
+    bool push(const T& val);
+
+    // 2. pop -- returns false in case the queue is empty.
+    // Only one thread (of all the processes) is supposed to pop
+    bool pop(T& val);
+
+    // 3. empty
+    bool empty();
+
+    std::size_t capacity() const {
+        return size_;
+    }
+};
+
+template<class T>
+void lock_free_shm_spsc_queue<T>::attach() {
+
+    data_ = reinterpret_cast<T*>(static_cast<char*>(region_.data()) + sizeof(shm_queue_control));
+    size_ = ctl_->size_;
+    MASK = size_ - 1;
+    head_cache_ = ctl_->head_.load(std::memory_order_acquire);
+    tail_cache_ = ctl_->tail_.load(std::memory_order_acquire);
+}
+
+template<class T>
+bool lock_free_shm_spsc_queue<T>::push(const T& val) {
+
+    std::size_t tail = ctl_->tail_.load(std::memory_order_relaxed);
+    if (tail - head_cache_ == size_) {
+        head_cache_ = ctl_->head_.load(std::memory_order_acquire);
+        if (tail - head_cache_ == size_) {
+            return false;
+        }
+    }
+    data_[tail & MASK] = val;
+    ctl_->tail_.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+template<class T>
+bool lock_free_shm_spsc_queue<T>::pop(T& val) {
+
+    std::size_t head = ctl_->head_.load(std::memory_order_relaxed);
+    if (head == tail_cache_) {
+        tail_cache_ = ctl_->tail_.load(std::memory_order_acquire);
+        if (head == tail_cache_) {
+            return false;
+        }
+    }
+    val = data_[head & MASK];
+    ctl_->head_.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+template<class T>
+bool lock_free_shm_spsc_queue<T>::empty() {
+
+    return ctl_->head_.load(std::memory_order_acquire) == ctl_->tail_.load(std::memory_order_acquire);
+}
+
+/*
+
+    MPMC
+
+    Every cell has a generation, that tells whose turn it is:
+
+    -> gen == pos      -- the cell is free for the pusher that took position pos
+    -> gen == pos + 1  -- the cell is full for the popper that took position pos
+    -> after the pop the cell gets gen = pos + size, i.e. it is free for
+        the pusher of the next round
+
+    PUSH
+
+    In a while loop
+    1. Load the tail and the generation of its cell
+    2. If gen == tail, try to take the position with cas on the tail
+        -> on success copy the value and store gen = tail + 1
+    3. If gen is behind the tail, the cell is not popped yet in the
+        previous round -> the queue is full, return false
+    4. Otherwise somebody has taken the position already -> repeat
+
+    POP
+
+    The same, with gen == head + 1 for the full cell, and gen = head + size
+    after the value is copied out
+
+    In contrast to lock_free_mpmc_bounded_queue there is no separate check
+    of the opposite index: the generation alone tells that the queue is full
+    or empty, so every side reads only its own index.
+
+*/
+
+template<class T>
+class lock_free_shm_mpmc_queue {
+
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "only trivially copyable types can be shared between processes");
+    static_assert(alignof(T) <= cache_line_size, "over aligned types are not supported");
+
+private:
+
+    static constexpr std::uint64_t MAGIC = 0x6d706d63'71756575;     // "mpmcqueu"
+
+    struct Cell {
+        std::atomic<std::size_t> gen_;
+        T                        value_;
+    };
+
+    static std::size_t round_size(std::size_t size) {
+        std::size_t res = 1;
+        while (res < size) {
+            res <<= 1;
+        }
+        return res;
+    }
+
+    static std::size_t bytes(std::size_t size) {
+        return sizeof(shm_queue_control) + size * sizeof(Cell);
+    }
+
+    void attach();
+
+    shm_region         region_;
+    shm_queue_control* ctl_;
+    Cell*              data_;
+    std::size_t        size_;
+    std::size_t        MASK;
+
+public:
+
+    // Create the queue with the name (without "/dev/shm")
+    // for at least size elements
+    lock_free_shm_mpmc_queue(const std::string& name, std::size_t size)
+    : region_(name, bytes(round_size(size)))
+    {
+        ctl_ = new (region_.data()) shm_queue_control();
+        ctl_->size_ = round_size(size);
+        ctl_->elem_size_ = sizeof(T);
+        ctl_->tail_.store(0, std::memory_order_relaxed);
+        ctl_->head_.store(0, std::memory_order_relaxed);
+        attach();
+        for (std::size_t i = 0; i < size_; ++i) {
+            new (&data_[i].gen_) std::atomic<std::size_t>(i);
+        }
+        ctl_->magic_.store(MAGIC, std::memory_order_release);
+    }
+
+    // Attach to the queue created by another process
+    explicit lock_free_shm_mpmc_queue(const std::string& name)
+    : region_(name)
+    {
+        ctl_ = static_cast<shm_queue_control*>(region_.data());
+        if (region_.size() < sizeof(shm_queue_control) ||
+            ctl_->magic_.load(std::memory_order_acquire) != MAGIC ||
+            ctl_->elem_size_ != sizeof(T) ||
+            region_.size() < bytes(ctl_->size_)) {
+            throw std::runtime_error("shared memory segment " + name + " is not an mpmc queue of T");
+        }
+        attach();
+    }
+
+    lock_free_shm_mpmc_queue(const lock_free_shm_mpmc_queue&) = delete;
+    lock_free_shm_mpmc_queue& operator = (const lock_free_shm_mpmc_queue&) = delete;
+
+    // 1. push -- returns false in case the queue is full
+    bool push(const T& val);
+
+    // 2. pop -- returns false in case the queue is empty
+    bool pop(T& val);
+
+    // 3. empty
+    bool empty();
+
+    std::size_t capacity() const {
+        return size_;
+    }
+};
+
+template<class T>
+void lock_free_shm_mpmc_queue<T>::attach() {
+
+    data_ = reinterpret_cast<Cell*>(static_cast<char*>(region_.data()) + sizeof(shm_queue_control));
+    size_ = ctl_->size_;
+    MASK = size_ - 1;
+}
+
+template<class T>
+bool lock_free_shm_mpmc_queue<T>::push(const T& val) {
+
+    std::size_t tail = ctl_->tail_.load(std::memory_order_relaxed);
+    for (;;) {
+        Cell& cell = data_[tail & MASK];
+        std::size_t gen = cell.gen_.load(std::memory_order_acquire);
+        std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(gen - tail);
+        if (diff == 0) {
+            if (ctl_->tail_.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) {
+                cell.value_ = val;
+                cell.gen_.store(tail + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            tail = ctl_->tail_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+template<class T>
+bool lock_free_shm_mpmc_queue<T>::pop(T& val) {
+
+    std::size_t head = ctl_->head_.load(std::memory_order_relaxed);
+    for (;;) {
+        Cell& cell = data_[head & MASK];
+        std::size_t gen = cell.gen_.load(std::memory_order_acquire);
+        std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(gen - (head + 1));
+        if (diff == 0) {
+            if (ctl_->head_.compare_exchange_weak(head, head + 1, std::memory_order_relaxed)) {
+                val = cell.value_;
+                cell.gen_.store(head + size_, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            head = ctl_->head_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+template<class T>
+bool lock_free_shm_mpmc_queue<T>::empty() {
+
+    return ctl_->head_.load(std::memory_order_acquire) == ctl_->tail_.load(std::memory_order_acquire);
+}
@@ -1,8 +1,13 @@
 #pragma once
 
+#include "cache-line.hpp"
+#include "counted-ptr.hpp"
+
 #include <memory>
 #include <atomic>
 #include <iostream>
+#include <thread>
+#include <cstdint>
 
 /*
 
@@ -52,28 +57,32 @@ Since multiple threads can h
 For pop
     Check that head is not equal to tail
     if it is not, then pop as usual
+
+The external counter and the pointer are changed together by
+atomic_counted_ptr (see counted-ptr.hpp): packed into one 64 bit
+word (or with cmpxchg16b), so the cas on head, tail and next is lock-free
+instead of the libatomic lock
 */
 
-template <class T>
+template<class T, class Layout = layout_padded>
 class lock_free_spmc_queue {
 
 private:
 
+    template<class X>
+    static constexpr std::size_t index_align = layout_align<X, Layout::index_align>;
+
     struct Node;
 
-    struct external_count {
-        int external_count_;
-        Node* node_;
-    };
+    using external_count = counted_ptr<Node>;
 
-    struct Node {
+    // Aligned to 64 bytes, so that the packed counted pointer
+    // has 6 more bits for the counter (see counted-ptr.hpp)
+    struct alignas(64) Node {
 
         Node()
         {
-            external_count cnt;
-            cnt.external_count_ = 0;
-            cnt.node_ = nullptr;
-            next_.store(cnt, std::memory_order_release);
+            next_.store(external_count(nullptr, 0), std::memory_order_release);
             internal_count_.store(0, std::memory_order_release);
             data_.store(nullptr, std::memory_order_release);
 
@@ -81,27 +90,28 @@ private:
 
         void ref_release();
 
-        std::atomic<external_count> next_;
-        std::atomic<int> internal_count_;
+        atomic_counted_ptr<Node> next_;
+        std::atomic<std::int64_t> internal_count_;
         std::atomic<T*> data_;
 
     };
 
-    void increase_external(external_count&);
+    // false, if the counter is at max_count(), then old_count
+    // is not changed
+    bool increase_external(external_count&);
 
     void free_external(external_count& old_count);
 
-    std::atomic<external_count> head_;
-    std::atomic<external_count> tail_;
+    alignas(index_align<atomic_counted_ptr<Node>>) atomic_counted_ptr<Node> head_;
+    alignas(index_align<atomic_counted_ptr<Node>>) atomic_counted_ptr<Node> tail_;
 
 public:
 
     lock_free_spmc_queue()
     {
-        Node* node = new Node();
-        external_count cnt;
-        cnt.node_ = node;
-        cnt.external_count_ = 2;
+        // 1 as for the pushed nodes: the pop that unlinks
+        // the node has added one more, and frees it
+        external_count cnt(new Node(), 1);
         tail_.store(cnt, std::memory_order_release);
         head_.store(cnt, std::memory_order_release);
     }
@@ -120,10 +130,10 @@ public:
 
 
     ~lock_free_spmc_queue() {
-        while(head_.load(std::memory_order_acquire).node_->next_.load(std::memory_order_acquire).node_) {
+        while(head_.load(std::memory_order_acquire).ptr()->next_.load(std::memory_order_acquire).ptr()) {
             pop();
         }
-        delete head_.load(std::memory_order_acquire).node_;
+        delete head_.load(std::memory_order_acquire).ptr();
     }
 
     bool empty();
@@ -131,44 +141,46 @@ public:
     // This check helps to find out
     // if the key structure for lock free
     // algorithm is lock-free
+    // (counted-ptr.hpp asserts it for the packed word)
     bool extern_is_lock_free() {
-        std::atomic<external_count> ec;
-        return ec.is_lock_free();
+        return head_.is_lock_free();
     }
 };
 
-template<class T> 
-void lock_free_spmc_queue<T>::push(T val) {
+template<class T, class Layout>
+void lock_free_spmc_queue<T, Layout>::push(T val) {
 
     std::unique_ptr<T> data_new(new T(std::move(val)));
     Node* node_new = new Node();
-    external_count count_new;
-    count_new.external_count_ = 1;
-    count_new.node_ = node_new;
+    external_count count_new(node_new, 1);
     external_count old_tail = tail_.load(std::memory_order_acquire);
-    old_tail.node_->next_.store(count_new, std::memory_order_release);
-    old_tail.node_->data_.store(data_new.get(), std::memory_order_release);
+    old_tail.ptr()->next_.store(count_new, std::memory_order_release);
+    old_tail.ptr()->data_.store(data_new.get(), std::memory_order_release);
     tail_.store(count_new, std::memory_order_release);
     data_new.release();
 }
 
-template<class T>
-void lock_free_spmc_queue<T>::increase_external(external_count& old_count) {
+template<class T, class Layout>
+bool lock_free_spmc_queue<T, Layout>::increase_external(external_count& old_count) {
 
     external_count count_new;
     do {
+        if (old_count.count() == atomic_counted_ptr<Node>::max_count()) {
+            return false;
+        }
         count_new = old_count;
-        ++count_new.external_count_;
+        count_new.set_count(old_count.count() + 1);
     } while (!head_.compare_exchange_strong(old_count, count_new,
          std::memory_order_acq_rel, std::memory_order_relaxed));
-    old_count.external_count_ = count_new.external_count_;
+    old_count.set_count(count_new.count());
+    return true;
 }
 
-template<class T>
-void lock_free_spmc_queue<T>::Node::ref_release() {
+template<class T, class Layout>
+void lock_free_spmc_queue<T, Layout>::Node::ref_release() {
 
-    int old_internal = internal_count_.load(std::memory_order_acquire);
-    int internal_new;
+    std::int64_t old_internal = internal_count_.load(std::memory_order_acquire);
+    std::int64_t internal_new;
     do {
         internal_new = old_internal;
         --internal_new;
@@ -180,24 +192,35 @@ void lock_free_spmc_queue<T>::Node::ref_release() {
     }
 }
 
-template<class T>
-void lock_free_spmc_queue<T>::free_external(external_count& old_count) {
+template<class T, class Layout>
+void lock_free_spmc_queue<T, Layout>::free_external(external_count& old_count) {
 
-    Node* ptr = old_count.node_;
-    int const internal_upd = old_count.external_count_ - 2;
+    Node* ptr = old_count.ptr();
+    std::int64_t const internal_upd = old_count.count() - 2;
     if (ptr->internal_count_.fetch_add(internal_upd, std::memory_order_acq_rel) == -internal_upd) {
         delete ptr;
     }
 }
 
-template<class T> 
-std::unique_ptr<T> lock_free_spmc_queue<T>::pop() {
+template<class T, class Layout>
+std::unique_ptr<T> lock_free_spmc_queue<T, Layout>::pop() {
 
     external_count old_count = head_.load(std::memory_order_acquire);
     for(;;) {
-        increase_external(old_count);
-        Node* const ptr = old_count.node_;
-        if (ptr == tail_.load(std::memory_order_acquire).node_) {
+        // The counter of the head goes down only when the head is
+        // unlinked, so the polls of the empty queue do not touch it
+        if (old_count.ptr() == tail_.load(std::memory_order_acquire).ptr()) {
+            return std::unique_ptr<T>();
+        }
+        if (!increase_external(old_count)) {
+            // Too many attempts on this head at the same time,
+            // wait for one of them to unlink it
+            std::this_thread::yield();
+            old_count = head_.load(std::memory_order_acquire);
+            continue;
+        }
+        Node* const ptr = old_count.ptr();
+        if (ptr == tail_.load(std::memory_order_acquire).ptr()) {
             ptr->ref_release();
             return std::unique_ptr<T>();
         }
@@ -213,17 +236,11 @@ std::unique_ptr<T> lock_free_spmc_queue<T>::pop() {
 }
 
 
-template<class T> 
-bool lock_free_spmc_queue<T>::empty() {
+template<class T, class Layout>
+bool lock_free_spmc_queue<T, Layout>::empty() {
 
-    external_count old_count = head_.load(std::memory_order_acquire);
-    for(;;) {
-        increase_external(old_count);
-        if (old_count.node_ == tail_.load(std::memory_order_acquire).node_) {
-            old_count.node_->ref_release();
-            return true;
-        }
-        old_count.node_->ref_release();
-    }
-    return false;
+    // Only the pointers are compared, nothing is dereferenced,
+    // so the head does not have to be held
+    return head_.load(std::memory_order_acquire).ptr() ==
+           tail_.load(std::memory_order_acquire).ptr();
 }
\ No newline at end of file
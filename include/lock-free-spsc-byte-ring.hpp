@@ -0,0 +1,225 @@
+#pragma once
+
+#include "cache-line.hpp"
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/*
+
+    Single producer single consumer ring of variable-length
+    byte records. The producer writes the record directly into
+    the ring, the consumer reads it directly from the ring, so
+    nothing is allocated or copied on the way.
+
+    Every record is prefixed with an 8 byte header with its length,
+    and takes the header plus the payload rounded up to 8 bytes,
+    therefore every header is aligned. A record is never split by
+    the end of the buffer: if it does not fit before the end, the
+    rest of the buffer is filled with a padding header, and the record
+    is written from the beginning.
+
+    Members are the same as in the ring queue: head and tail grow forever,
+    are taken & MASK, live on their own cache lines, and every side keeps
+    a cached copy of the index of the other side.
+
+    RESERVE(n)
+
+    1. Count the space: the record, and the padding if the record
+        does not fit before the end of the buffer
+    2. If there is not enough free space with the cached head -> reload head
+        -> if it is still not enough return nullptr
+    3. Write the padding header, if we need it
+    4. Return the pointer to the payload
+
+    COMMIT
+
+    1. If there is no reservation, or n is larger than it -> return false
+    2. Write the length into the header
+    3. Publish the padding and the record by storing the new tail with release
+    4. Drop the reservation, the record belongs to the consumer now
+
+    PEEK
+
+    1. If there is nothing with the cached tail -> reload tail
+        -> if it is still empty return an empty view
+    2. If the header is the padding -> skip to the beginning of the buffer
+    3. Return the view of the payload
+
+    RELEASE
+
+    1. Give the space back by storing the head after the record with release
+
+*/
+
+class lock_free_spsc_byte_ring {
+
+private:
+
+    using Header = std::uint64_t;
+
+    static constexpr Header PAD = ~Header(0);
+
+    // reserved_len_ when there is nothing to commit
+    static constexpr std::size_t NO_RESERVATION = ~std::size_t(0);
+
+    static constexpr std::size_t align(std::size_t n) {
+        return (n + sizeof(Header) - 1) & ~(sizeof(Header) - 1);
+    }
+
+    char* at(std::size_t pos) {
+        return reinterpret_cast<char*>(data_.get()) + (pos & MASK);
+    }
+
+    Header& header(std::size_t pos) {
+        return data_[(pos & MASK) / sizeof(Header)];
+    }
+
+    // Producer part
+    alignas(cache_line_size) std::atomic<std::size_t> tail_;
+    std::size_t head_cache_;
+    std::size_t reserved_pos_;
+    std::size_t reserved_len_;
+
+    // Consumer part
+    alignas(cache_line_size) std::atomic<std::size_t> head_;
+    std::size_t tail_cache_;
+    std::size_t peeked_end_;
+
+    // Read only after construction
+    alignas(cache_line_size) std::unique_ptr<Header[]> data_;
+    std::size_t size_;
+    std::size_t MASK;
+
+public:
+
+    lock_free_spsc_byte_ring()
+    : lock_free_spsc_byte_ring(1 << 20)
+    {}
+
+    // size -- size of the buffer in bytes,
+    // is rounded up to a power of 2
+    lock_free_spsc_byte_ring(std::size_t size)
+    : tail_(0)
+    , head_cache_(0)
+    , reserved_pos_(0)
+    , reserved_len_(NO_RESERVATION)
+    , head_(0)
+    , tail_cache_(0)
+    , peeked_end_(0)
+    {
+        size_ = 2 * sizeof(Header);
+        while (size_ < size) {
+            size_ <<= 1;
+        }
+        data_ = std::make_unique<Header[]>(size_ / sizeof(Header));
+        MASK = size_ - 1;
+    }
+
+    lock_free_spsc_byte_ring(const lock_free_spsc_byte_ring&) = delete;
+    lock_free_spsc_byte_ring& operator = (const lock_free_spsc_byte_ring&) = delete;
+
+    // 1. reserve -- returns the place for n bytes in the ring,
+    // or nullptr in case there is not enough free space.
+    // The record becomes visible to the consumer only after commit.
+    // Calling reserve again before commit drops the previous reservation,
+    // a failed reserve drops it as well.
+    // commit returns false and does nothing if there is no reservation.
+    // Only one thread is supposed to reserve and commit
+
+    char* reserve(std::size_t n);
+
+    bool commit();
+
+    // commit only the first n bytes of the reservation,
+    // false if n is larger than the reservation
+    bool commit(std::size_t n);
+
+    // 2. peek -- returns the oldest record, or a view with data() == nullptr
+    // in case the ring is empty. The view is valid until release.
+    // Only one thread is supposed to peek and release
+
+    std::string_view peek();
+
+    void release();
+
+    // 3. empty
+    bool empty();
+
+    std::size_t capacity() const {
+        return size_;
+    }
+};
+
+inline char* lock_free_spsc_byte_ring::reserve(std::size_t n) {
+
+    std::size_t tail = tail_.load(std::memory_order_relaxed);
+    std::size_t need = align(sizeof(Header) + n);
+    std::size_t to_end = size_ - (tail & MASK);
+    std::size_t pad = (need > to_end) ? to_end : 0;
+    if (need + pad > size_ - (tail - head_cache_)) {
+        head_cache_ = head_.load(std::memory_order_acquire);
+        if (need + pad > size_ - (tail - head_cache_)) {
+            reserved_len_ = NO_RESERVATION;
+            return nullptr;
+        }
+    }
+    // The padding is not visible to the consumer
+    // until the record after it is committed
+    if (pad) {
+        header(tail) = PAD;
+    }
+    reserved_pos_ = tail + pad;
+    reserved_len_ = n;
+    return at(reserved_pos_) + sizeof(Header);
+}
+
+inline bool lock_free_spsc_byte_ring::commit() {
+
+    return commit(reserved_len_);
+}
+
+inline bool lock_free_spsc_byte_ring::commit(std::size_t n) {
+
+    // The record at reserved_pos_ can be already published,
+    // and the consumer can read it
+    if (reserved_len_ == NO_RESERVATION || n > reserved_len_) {
+        return false;
+    }
+    header(reserved_pos_) = n;
+    tail_.store(reserved_pos_ + align(sizeof(Header) + n), std::memory_order_release);
+    reserved_len_ = NO_RESERVATION;
+    return true;
+}
+
+inline std::string_view lock_free_spsc_byte_ring::peek() {
+
+    std::size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_cache_) {
+        tail_cache_ = tail_.load(std::memory_order_acquire);
+        if (head == tail_cache_) {
+            return std::string_view();
+        }
+    }
+    // The padding is always followed by a record
+    // from the beginning of the buffer
+    if (header(head) == PAD) {
+        head += size_ - (head & MASK);
+    }
+    std::size_t len = header(head);
+    peeked_end_ = head + align(sizeof(Header) + len);
+    return std::string_view(at(head) + sizeof(Header), len);
+}
+
+inline void lock_free_spsc_byte_ring::release() {
+
+    head_.store(peeked_end_, std::memory_order_release);
+}
+
+inline bool lock_free_spsc_byte_ring::empty() {
+
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+}
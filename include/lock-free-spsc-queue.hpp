@@ -1,16 +1,50 @@
 #pragma once
 
+#include "cache-line.hpp"
+#include "event-count.hpp"
+
 #include <memory>
 #include <atomic>
+#include <chrono>
+#include <cstddef>
+
+/*
+
+    Lazy publication mode
+
+    By default every push publishes the new tail right away.
+    If the queue is constructed with publish_batch = N > 1, the
+    producer links the nodes privately and stores the tail only
+    every N pushes, or when flush() is called. The consumer, in its
+    turn, always remembers the last tail it has seen, and goes to
+    the shared tail only when it has consumed everything before it.
+
+    Therefore for streaming workloads the line with the tail moves
+    between the cores once per N elements instead of once per element.
+    The price is the latency: an element can wait in the producer until
+    N - 1 more elements are pushed, so the producer has to call flush()
+    when it has nothing more to send.
+
+    Blocking pop
 
-template <class T>
+    wait_pop sleeps on the event count (see event-count.hpp), when the
+    queue stays empty for long. The producer notifies it on every
+    publication of the tail, which costs one fence and one load, as
+    long as the consumer is not sleeping.
+
+*/
+
+template<class T, class Layout = layout_padded>
 class lock_free_spsc_queue {
 
 private:
 
+    template<class X>
+    static constexpr std::size_t index_align = layout_align<X, Layout::index_align>;
+
     struct Node {
 
-        Node* next_;
+        alignas(layout_align<Node*, Layout::cell_align>) Node* next_;
         std::shared_ptr<T> data_;
     };
 
@@ -18,20 +52,42 @@ private:
 
     Node* pop_head(T&);
 
-    std::atomic<Node*> head_;
-    std::atomic<Node*> tail_;
+    bool load_tail(Node*);
+
+    // Consumer part
+    alignas(index_align<std::atomic<Node*>>) std::atomic<Node*> head_;
+    Node* tail_cache_;
+
+    // Producer part
+    alignas(index_align<std::atomic<Node*>>) std::atomic<Node*> tail_;
+    Node* tail_local_;
+    std::size_t unpublished_;
+    std::size_t publish_batch_;
+
+    alignas(index_align<event_count>) event_count not_empty_;
 
 public:
 
     lock_free_spsc_queue()
+    : lock_free_spsc_queue(1)
+    {}
+
+    // publish_batch -- how many pushes are collected
+    // before the tail is published, see lazy publication mode
+    explicit lock_free_spsc_queue(std::size_t publish_batch)
     : head_(new Node())
-    , tail_(head_.load())
+    , tail_cache_(head_.load())
+    , tail_(tail_cache_)
+    , tail_local_(tail_cache_)
+    , unpublished_(0)
+    , publish_batch_(publish_batch ? publish_batch : 1)
     {}
 
     lock_free_spsc_queue(const lock_free_spsc_queue&) = delete;
     lock_free_spsc_queue& operator = (const lock_free_spsc_queue&) = delete;
 
     ~lock_free_spsc_queue() {
+        flush();
         while(pop()); 
         delete head_.load(std::memory_order_seq_cst);
     }
@@ -47,34 +103,82 @@ public:
 
     bool pop(T& val);
 
-    // 3. empty
+    // 3. bulk versions -- the whole batch is published
+    // (or consumed) with a single store to tail_ (head_)
+
+    template<class It>
+    void push_bulk(It first, It last);
+
+    // Pops at most max elements into out,
+    // returns how many were popped
+    template<class Out>
+    std::size_t pop_bulk(Out out, std::size_t max);
+
+    // 4. flush -- publish the elements that were pushed,
+    // but not published yet in lazy publication mode.
+    // Is supposed to be called by the producer
+    void flush();
+
+    // 5. blocking pop -- waits until the element is published,
+    // sleeping on the futex if it takes long. The timed version
+    // returns false, if nothing came before the timeout
+
+    void wait_pop(T& val);
+
+    template<class Rep, class Period>
+    bool wait_pop_for(T& val, const std::chrono::duration<Rep, Period>& timeout);
+
+    // 6. empty -- elements that are not published yet
+    // are not taken into account
     bool empty();
 
 };
 
-template<class T> 
-void lock_free_spsc_queue<T>::push(T val) {
+template<class T, class Layout>
+void lock_free_spsc_queue<T, Layout>::push(T val) {
 
     // 1. create new data pointer 
     std::shared_ptr<T> data = std::make_shared<T>(std::move(val));
     // 2. create new dummy ptr
     Node* ptr = new Node();
     // 3. Save old_tail in a variable
-    Node* old_tail = tail_.load(std::memory_order_acquire);
+    Node* old_tail = tail_local_;
     // 4. Swap the data
     old_tail->data_.swap(data);
     // 5. Set next of the old tail to the ptr
     old_tail->next_ = ptr;
-    // 6. store ptr in tail
-    tail_.store(ptr, std::memory_order_release);
+    tail_local_ = ptr;
+    // 6. store ptr in tail, if it is time to publish
+    if (++unpublished_ >= publish_batch_) {
+        flush();
+    }
 }
 
-template<class T>
-typename lock_free_spsc_queue<T>::Node* 
-lock_free_spsc_queue<T>::pop_head() {
+template<class T, class Layout>
+void lock_free_spsc_queue<T, Layout>::flush() {
+
+    tail_.store(tail_local_, std::memory_order_release);
+    unpublished_ = 0;
+    not_empty_.notify_one();
+}
+
+template<class T, class Layout>
+bool lock_free_spsc_queue<T, Layout>::load_tail(Node* head) {
+
+    // We go to the shared tail only when everything
+    // up to the last seen tail is consumed
+    if (head == tail_cache_) {
+        tail_cache_ = tail_.load(std::memory_order_acquire);
+    }
+    return head != tail_cache_;
+}
+
+template<class T, class Layout>
+typename lock_free_spsc_queue<T, Layout>::Node* 
+lock_free_spsc_queue<T, Layout>::pop_head() {
 
     Node* old_head = head_.load(std::memory_order_acquire);
-    if (old_head == tail_.load(std::memory_order_acquire)) {
+    if (!load_tail(old_head)) {
         return nullptr;
     }
     // 3. We can set the head to the 
@@ -83,12 +187,12 @@ lock_free_spsc_queue<T>::pop_head() {
     return old_head;
 }
 
-template<class T>
-typename lock_free_spsc_queue<T>::Node* 
-lock_free_spsc_queue<T>::pop_head(T& val) {
+template<class T, class Layout>
+typename lock_free_spsc_queue<T, Layout>::Node* 
+lock_free_spsc_queue<T, Layout>::pop_head(T& val) {
 
     Node* old_head = head_.load(std::memory_order_acquire);
-    if (old_head == tail_.load(std::memory_order_acquire)) {
+    if (!load_tail(old_head)) {
         return nullptr;
     }
     // Difference from the previos pop_head 
@@ -98,8 +202,8 @@ lock_free_spsc_queue<T>::pop_head(T& val) {
     return old_head;
 }
 
-template<class T> 
-std::shared_ptr<T> lock_free_spsc_queue<T>::pop() {
+template<class T, class Layout>
+std::shared_ptr<T> lock_free_spsc_queue<T, Layout>::pop() {
     // 1. load old_head to work with
     Node* old_head = pop_head();
     // 2. Check that old_had is not null
@@ -111,8 +215,8 @@ std::shared_ptr<T> lock_free_spsc_queue<T>::pop() {
     return res;
 }
 
-template<class T> 
-bool lock_free_spsc_queue<T>::pop(T& val) {
+template<class T, class Layout>
+bool lock_free_spsc_queue<T, Layout>::pop(T& val) {
     // 1. load old_head to work with
     Node* old_head = pop_head(val);
     // 2. Check that old_had is not null
@@ -123,8 +227,90 @@ bool lock_free_spsc_queue<T>::pop(T& val) {
     return true;
 }
 
-template<class T> 
-bool lock_free_spsc_queue<T>::empty() {
+template<class T, class Layout>
+template<class It>
+void lock_free_spsc_queue<T, Layout>::push_bulk(It first, It last) {
+
+    if (first == last) {
+        return;
+    }
+    // 1. The first value goes to the current dummy node (old tail),
+    // the rest of them go to the private chain of new nodes,
+    // where the last one is the new dummy
+    std::shared_ptr<T> data = std::make_shared<T>(*first);
+    Node* chain_head = new Node();
+    Node* chain_tail = chain_head;
+    try {
+        for (++first; first != last; ++first) {
+            chain_tail->data_ = std::make_shared<T>(*first);
+            chain_tail->next_ = new Node();
+            chain_tail = chain_tail->next_;
+        }
+    } catch (...) {
+        // Nothing is linked to the queue yet
+        while (chain_head) {
+            Node* next = chain_head->next_;
+            delete chain_head;
+            chain_head = next;
+        }
+        throw;
+    }
+    // 2. Link the chain after the old tail
+    Node* old_tail = tail_local_;
+    old_tail->data_.swap(data);
+    old_tail->next_ = chain_head;
+    tail_local_ = chain_tail;
+    // 3. Publish the whole chain at once (together
+    // with whatever was pushed before in lazy mode)
+    flush();
+}
+
+template<class T, class Layout>
+template<class Out>
+std::size_t lock_free_spsc_queue<T, Layout>::pop_bulk(Out out, std::size_t max) {
+
+    // 1. One look at the tail is enough for the whole batch
+    Node* head = head_.load(std::memory_order_acquire);
+    tail_cache_ = tail_.load(std::memory_order_acquire);
+    Node* const tail = tail_cache_;
+    std::size_t count = 0;
+    try {
+        for (; count < max && head != tail; ++count) {
+            // If the move throws the element stays in the queue
+            *out = std::move(*head->data_);
+            ++out;
+            Node* next = head->next_;
+            delete head;
+            head = next;
+        }
+    } catch (...) {
+        head_.store(head, std::memory_order_release);
+        throw;
+    }
+    // 2. Consume the whole batch at once
+    head_.store(head, std::memory_order_release);
+    return count;
+}
+
+template<class T, class Layout>
+void lock_free_spsc_queue<T, Layout>::wait_pop(T& val) {
+
+    not_empty_.await([this, &val]() {
+        return pop(val);
+    });
+}
+
+template<class T, class Layout>
+template<class Rep, class Period>
+bool lock_free_spsc_queue<T, Layout>::wait_pop_for(T& val, const std::chrono::duration<Rep, Period>& timeout) {
+
+    return not_empty_.await_for([this, &val]() {
+        return pop(val);
+    }, timeout);
+}
+
+template<class T, class Layout>
+bool lock_free_spsc_queue<T, Layout>::empty() {
     if (head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire)) {
         return true;
     }
@@ -0,0 +1,283 @@
+#pragma once
+
+#include "cache-line.hpp"
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+/*
+
+    Bounded version of the single producer single consumer
+    queue. Instead of allocating a node per element, the values
+    are stored inline in a contiguous array of slots, which
+    is used as a ring buffer.
+
+    Members
+
+    -> tail (written by the producer only)
+    -> head (written by the consumer only)
+    -> array of slots, with raw storage for T
+
+    Both head and tail are never wrapped: they grow forever
+    and we take them modulo the size of the buffer (size is
+    a power of 2, so that modulo is just & MASK). Therefore
+    tail - head is always the number of elements in the queue.
+
+    Each index lives on its own cache line, so that the producer
+    and the consumer are not invalidating each other's line on
+    every operation. On top of that every side keeps a cached copy
+    of the index of the other side, and reloads the real one only
+    when the cached value says that the queue is full (for the producer)
+    or empty (for the consumer).
+
+    PUSH
+
+    1. Load own tail
+    2. If the queue looks full with the cached head -> reload head
+        -> if it is still full return false
+    3. Construct the value in place in the slot
+    4. Publish it by storing tail + 1 with release
+
+    POP
+
+    1. Load own head
+    2. If the queue looks empty with the cached tail -> reload tail
+        -> if it is still empty return false
+    3. Move the value out and destroy it in the slot
+    4. Give the slot back by storing head + 1 with release
+
+    BULK
+
+    push_bulk and pop_bulk work the same way, but check the free space
+    (available elements) once for the whole batch, and publish it with a
+    single store. When T is trivially copyable and the batch comes
+    from (goes to) a plain array, it is copied with at most two memcpy
+    calls -- one up to the end of the buffer and one after the wrap point.
+
+*/
+
+template<class T, class Layout = layout_padded>
+class lock_free_spsc_ring_queue {
+
+private:
+
+    template<class X>
+    static constexpr std::size_t index_align = layout_align<X, Layout::index_align>;
+
+    struct Slot {
+
+        T* get() {
+            return std::launder(reinterpret_cast<T*>(data_));
+        }
+
+        alignas(layout_align<T, Layout::cell_align>) unsigned char data_[sizeof(T)];
+    };
+
+    // Batch can be memcpy-ed, if it is a plain array of T
+    // (padded cells are not)
+    template<class Ptr>
+    static constexpr bool is_raw_copy_ =
+        std::is_trivially_copyable<T>::value &&
+        std::is_pointer<Ptr>::value &&
+        std::is_same<std::remove_cv_t<std::remove_pointer_t<Ptr>>, T>::value &&
+        sizeof(Slot) == sizeof(T);
+
+    // Producer part
+    alignas(index_align<std::atomic<std::size_t>>) std::atomic<std::size_t> tail_;
+    std::size_t head_cache_;
+
+    // Consumer part
+    alignas(index_align<std::atomic<std::size_t>>) std::atomic<std::size_t> head_;
+    std::size_t tail_cache_;
+
+    // Read only after construction
+    alignas(index_align<std::unique_ptr<Slot[]>>) std::unique_ptr<Slot[]> data_;
+    std::size_t size_;
+    std::size_t MASK;
+
+public:
+
+    lock_free_spsc_ring_queue()
+    : lock_free_spsc_ring_queue(1 << 16)
+    {}
+
+    lock_free_spsc_ring_queue(std::size_t size)
+    : tail_(0)
+    , head_cache_(0)
+    , head_(0)
+    , tail_cache_(0)
+    {
+        size_ = 1;
+        while (size_ < size) {
+            size_ <<= 1;
+        }
+        data_ = std::make_unique<Slot[]>(size_);
+        MASK = size_ - 1;
+    }
+
+    lock_free_spsc_ring_queue(const lock_free_spsc_ring_queue&) = delete;
+    lock_free_spsc_ring_queue& operator = (const lock_free_spsc_ring_queue&) = delete;
+
+    ~lock_free_spsc_ring_queue() {
+        std::size_t head = head_.load(std::memory_order_acquire);
+        std::size_t tail = tail_.load(std::memory_order_acquire);
+        for (; head != tail; ++head) {
+            data_[head & MASK].get()->~T();
+        }
+    }
+
+    // 1. push -- returns false in case the queue is full.
+    // Only one thread is supposed to push
+
+    bool push(T val);
+
+    template<class... Args>
+    bool emplace(Args&&... args);
+
+    // 2. pop -- returns false in case the queue is empty.
+    // Only one thread is supposed to pop
+
+    bool pop(T& val);
+
+    // 3. bulk versions -- push as many elements of [first, last)
+    // as fit (pop at most max elements), return how many.
+    // The iterators of push_bulk have to be at least forward ones
+
+    template<class It>
+    std::size_t push_bulk(It first, It last);
+
+    template<class Out>
+    std::size_t pop_bulk(Out out, std::size_t max);
+
+    // 4. empty
+    bool empty();
+
+    std::size_t capacity() const {
+        return size_;
+    }
+};
+
+template<class T, class Layout>
+bool lock_free_spsc_ring_queue<T, Layout>::push(T val) {
+
+    return emplace(std::move(val));
+}
+
+template<class T, class Layout>
+template<class... Args>
+bool lock_free_spsc_ring_queue<T, Layout>::emplace(Args&&... args) {
+
+    std::size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_cache_ == size_) {
+        head_cache_ = head_.load(std::memory_order_acquire);
+        if (tail - head_cache_ == size_) {
+            return false;
+        }
+    }
+    // In case the constructor throws the tail is not moved,
+    // and the slot stays free
+    new (data_[tail & MASK].data_) T(std::forward<Args>(args)...);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+template<class T, class Layout>
+bool lock_free_spsc_ring_queue<T, Layout>::pop(T& val) {
+
+    std::size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_cache_) {
+        tail_cache_ = tail_.load(std::memory_order_acquire);
+        if (head == tail_cache_) {
+            return false;
+        }
+    }
+    T* ptr = data_[head & MASK].get();
+    // If the move throws, the element stays in the queue
+    val = std::move(*ptr);
+    ptr->~T();
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+template<class T, class Layout>
+bool lock_free_spsc_ring_queue<T, Layout>::empty() {
+
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+}
+
+template<class T, class Layout>
+template<class It>
+std::size_t lock_free_spsc_ring_queue<T, Layout>::push_bulk(It first, It last) {
+
+    std::size_t tail = tail_.load(std::memory_order_relaxed);
+    std::size_t count = std::distance(first, last);
+    if (size_ - (tail - head_cache_) < count) {
+        head_cache_ = head_.load(std::memory_order_acquire);
+    }
+    count = std::min(count, size_ - (tail - head_cache_));
+    if (count == 0) {
+        return 0;
+    }
+
+    if constexpr (is_raw_copy_<It>) {
+        std::size_t pos = tail & MASK;
+        std::size_t part = std::min(count, size_ - pos);
+        std::memcpy(static_cast<void*>(&data_[pos]), first, part * sizeof(T));
+        std::memcpy(static_cast<void*>(&data_[0]), first + part, (count - part) * sizeof(T));
+    } else {
+        for (std::size_t i = 0; i < count; ++i, ++first) {
+            try {
+                new (data_[(tail + i) & MASK].data_) T(*first);
+            } catch (...) {
+                // Publish the part that was constructed
+                tail_.store(tail + i, std::memory_order_release);
+                throw;
+            }
+        }
+    }
+    tail_.store(tail + count, std::memory_order_release);
+    return count;
+}
+
+template<class T, class Layout>
+template<class Out>
+std::size_t lock_free_spsc_ring_queue<T, Layout>::pop_bulk(Out out, std::size_t max) {
+
+    std::size_t head = head_.load(std::memory_order_relaxed);
+    if (tail_cache_ - head < max) {
+        tail_cache_ = tail_.load(std::memory_order_acquire);
+    }
+    std::size_t count = std::min(max, tail_cache_ - head);
+    if (count == 0) {
+        return 0;
+    }
+
+    if constexpr (is_raw_copy_<Out>) {
+        std::size_t pos = head & MASK;
+        std::size_t part = std::min(count, size_ - pos);
+        std::memcpy(out, static_cast<void*>(&data_[pos]), part * sizeof(T));
+        std::memcpy(out + part, static_cast<void*>(&data_[0]), (count - part) * sizeof(T));
+    } else {
+        for (std::size_t i = 0; i < count; ++i, ++out) {
+            T* ptr = data_[(head + i) & MASK].get();
+            try {
+                *out = std::move(*ptr);
+            } catch (...) {
+                // Give back the part that was consumed,
+                // the current element stays in the queue
+                head_.store(head + i, std::memory_order_release);
+                throw;
+            }
+            ptr->~T();
+        }
+    }
+    head_.store(head + count, std::memory_order_release);
+    return count;
+}
@@ -0,0 +1,270 @@
+#pragma once
+
+#include "cache-line.hpp"
+#include "lock-free-spsc-ring-queue.hpp"
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <cstddef>
+#include <utility>
+
+/*
+
+    Unbounded single producer single consumer queue, that
+    does not allocate per element.
+
+    The queue is a linked list of segments. Each segment is
+    a fixed size array of slots with inline storage for T,
+    and a counter of slots that were already published by
+    the producer.
+
+    -> producer owns the tail segment and the index inside of it
+    -> consumer owns the head segment and the index inside of it
+
+    The only shared data is the counter of published slots
+    (and the next pointer) in the segment that both of the threads
+    are working with.
+
+    PUSH
+
+    1. If the tail segment is full
+        -> take a segment from the recycle cache, or allocate a new one
+        -> link it after the tail segment and make it the tail
+    2. Construct the value in the next free slot
+    3. Publish it by storing the new counter with release
+
+    POP
+
+    1. If we consumed everything that we have seen in the head segment
+        -> if the segment is consumed completely and has the next one,
+        hand the segment back to the producer and switch to the next one
+        -> reload the counter of published slots
+        -> if there is still nothing new return false
+    2. Move the value out and destroy it in the slot
+
+    Recycling
+
+    Drained segments are given back to the producer through
+    a small SPSC ring queue (where the roles are swapped: the consumer
+    of the queue is the producer of the ring). If the ring is full the
+    segment is deleted. Therefore, in the steady state, when the consumer
+    keeps up with the producer, no allocation happens at all.
+
+    The Layout policy (see cache-line.hpp) keeps the producer and the
+    consumer parts on their own cache lines (layout_padded, default),
+    and with layout_padded_cells gives every slot its own line too.
+*/
+
+template<class T, std::size_t SegmentSize = 1024, class Layout = layout_padded>
+class lock_free_spsc_segmented_queue {
+
+private:
+
+    template<class X>
+    static constexpr std::size_t index_align = layout_align<X, Layout::index_align>;
+
+    struct Slot {
+
+        T* get() {
+            return std::launder(reinterpret_cast<T*>(data_));
+        }
+
+        alignas(layout_align<T, Layout::cell_align>) unsigned char data_[sizeof(T)];
+    };
+
+    struct Segment {
+
+        Segment()
+        : tail_(0)
+        , next_(nullptr)
+        {}
+
+        alignas(index_align<std::atomic<std::size_t>>) std::atomic<std::size_t> tail_;
+        std::atomic<Segment*> next_;
+        alignas(index_align<Slot>) Slot data_[SegmentSize];
+    };
+
+    Segment* get_segment();
+
+    void put_segment(Segment*);
+
+    T* front();
+
+    void pop_front();
+
+    // Producer part
+    alignas(index_align<Segment*>) Segment* tail_seg_;
+    std::size_t tail_idx_;
+
+    // Consumer part
+    alignas(index_align<Segment*>) Segment* head_seg_;
+    std::size_t head_idx_;
+    std::size_t tail_cache_;
+
+    // Drained segments on their way back to the producer
+    lock_free_spsc_ring_queue<Segment*> recycle_;
+
+public:
+
+    lock_free_spsc_segmented_queue()
+    : lock_free_spsc_segmented_queue(4)
+    {}
+
+    // recycle_size - how many drained segments we
+    // keep for reuse instead of deleting them
+    lock_free_spsc_segmented_queue(std::size_t recycle_size)
+    : tail_seg_(new Segment())
+    , tail_idx_(0)
+    , head_seg_(tail_seg_)
+    , head_idx_(0)
+    , tail_cache_(0)
+    , recycle_(recycle_size)
+    {}
+
+    lock_free_spsc_segmented_queue(const lock_free_spsc_segmented_queue&) = delete;
+    lock_free_spsc_segmented_queue& operator = (const lock_free_spsc_segmented_queue&) = delete;
+
+    ~lock_free_spsc_segmented_queue() {
+
+        Segment* seg = head_seg_;
+        std::size_t idx = head_idx_;
+        while (seg) {
+            std::size_t tail = seg->tail_.load(std::memory_order_acquire);
+            for (; idx < tail; ++idx) {
+                seg->data_[idx].get()->~T();
+            }
+            Segment* next = seg->next_.load(std::memory_order_acquire);
+            delete seg;
+            seg = next;
+            idx = 0;
+        }
+        while (recycle_.pop(seg)) {
+            delete seg;
+        }
+    }
+
+    // 1. push is not supposed
+    // for usage of more than 1 thread
+
+    void push(T val);
+
+    template<class... Args>
+    void emplace(Args&&... args);
+
+    // 2. pop -- two versions: with std::shared and not.
+    // Only the consumer thread is supposed to pop
+
+    std::shared_ptr<T> pop();
+
+    bool pop(T& val);
+
+    // 3. empty -- is supposed to be called by the consumer
+    bool empty();
+};
+
+template<class T, std::size_t SegmentSize, class Layout>
+typename lock_free_spsc_segmented_queue<T, SegmentSize, Layout>::Segment*
+lock_free_spsc_segmented_queue<T, SegmentSize, Layout>::get_segment() {
+
+    Segment* seg;
+    if (recycle_.pop(seg)) {
+        return seg;
+    }
+    return new Segment();
+}
+
+template<class T, std::size_t SegmentSize, class Layout>
+void lock_free_spsc_segmented_queue<T, SegmentSize, Layout>::put_segment(Segment* seg) {
+
+    // Reset the segment before it is published to the
+    // producer through the ring
+    seg->tail_.store(0, std::memory_order_relaxed);
+    seg->next_.store(nullptr, std::memory_order_relaxed);
+    if (!recycle_.push(seg)) {
+        delete seg;
+    }
+}
+
+template<class T, std::size_t SegmentSize, class Layout>
+void lock_free_spsc_segmented_queue<T, SegmentSize, Layout>::push(T val) {
+
+    emplace(std::move(val));
+}
+
+template<class T, std::size_t SegmentSize, class Layout>
+template<class... Args>
+void lock_free_spsc_segmented_queue<T, SegmentSize, Layout>::emplace(Args&&... args) {
+
+    if (tail_idx_ == SegmentSize) {
+        Segment* seg = get_segment();
+        tail_seg_->next_.store(seg, std::memory_order_release);
+        tail_seg_ = seg;
+        tail_idx_ = 0;
+    }
+    // In case the constructor throws nothing is published
+    new (tail_seg_->data_[tail_idx_].data_) T(std::forward<Args>(args)...);
+    tail_seg_->tail_.store(++tail_idx_, std::memory_order_release);
+}
+
+template<class T, std::size_t SegmentSize, class Layout>
+T* lock_free_spsc_segmented_queue<T, SegmentSize, Layout>::front() {
+
+    if (head_idx_ == tail_cache_) {
+        if (head_idx_ == SegmentSize) {
+            // The producer links the next segment only
+            // after this one is full, so it does not touch it anymore
+            Segment* next = head_seg_->next_.load(std::memory_order_acquire);
+            if (!next) {
+                return nullptr;
+            }
+            put_segment(head_seg_);
+            head_seg_ = next;
+            head_idx_ = 0;
+        }
+        tail_cache_ = head_seg_->tail_.load(std::memory_order_acquire);
+        if (head_idx_ == tail_cache_) {
+            return nullptr;
+        }
+    }
+    return head_seg_->data_[head_idx_].get();
+}
+
+template<class T, std::size_t SegmentSize, class Layout>
+void lock_free_spsc_segmented_queue<T, SegmentSize, Layout>::pop_front() {
+
+    head_seg_->data_[head_idx_].get()->~T();
+    ++head_idx_;
+}
+
+template<class T, std::size_t SegmentSize, class Layout>
+std::shared_ptr<T> lock_free_spsc_segmented_queue<T, SegmentSize, Layout>::pop() {
+
+    T* ptr = front();
+    if (!ptr) {
+        return std::shared_ptr<T>();
+    }
+    // If the allocation or the move throws,
+    // the element stays in the queue
+    std::shared_ptr<T> res = std::make_shared<T>(std::move(*ptr));
+    pop_front();
+    return res;
+}
+
+template<class T, std::size_t SegmentSize, class Layout>
+bool lock_free_spsc_segmented_queue<T, SegmentSize, Layout>::pop(T& val) {
+
+    T* ptr = front();
+    if (!ptr) {
+        return false;
+    }
+    val = std::move(*ptr);
+    pop_front();
+    return true;
+}
+
+template<class T, std::size_t SegmentSize, class Layout>
+bool lock_free_spsc_segmented_queue<T, SegmentSize, Layout>::empty() {
+
+    return front() == nullptr;
+}
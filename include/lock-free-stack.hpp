@@ -1,10 +1,19 @@
 #pragma once
 
+#include "cache-line.hpp"
 #include "hazard-pointers.hpp"
+#include "event-count.hpp"
+#include "intrusive-hook.hpp"
+#include "counted-ptr.hpp"
 
 #include <atomic>
 #include <memory>
+#include <chrono>
 #include <iostream>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
 
 /*
 
@@ -30,20 +39,66 @@
     deleted while we are working with it, we secure
     our pointer to old_head in in the hazard pointer
     3. If during the saving of pointer to hazard something
-    changed, we note that and perform loop again
+    changed, we note that and perform loop again. The store of the
+    hazard and the load of the head are seq_cst: otherwise the load
+    can go before the store (x86 allows it), and a drain (or a scan)
+    does not see the hazard on the node we are about to read
     4. If not, then we try to exchange old head with the next one
     in CAS
     5. If we left with some old head, we then get the content
     and add the pointer to the head to reclaim later, in order 
     not to have use-after-free issues
 
+    DRAIN
+
+    A consumer that takes everything at once does not have to pop
+    element by element, fighting the others for the head every time:
+
+    1. Exchange the head with nullptr -- the whole chain is ours
+    2. Walk it newest first (drain), or collect the nodes into a buffer
+       and walk it from the end, oldest first (drain_fifo)
+    3. Every node goes to the reclamation like in pop
+
+    The detached nodes are only read, never changed or linked again: a
+    pop that has validated its hazard on the old head before the exchange
+    can still read its next in the cas (that fails). So if f throws, the
+    values that are not passed are pushed back in new nodes, with one cas.
+
+    WAIT POP
+
+    Pops as above in a loop, and if the stack stays empty
+    for long, goes to sleep on the event count (see event-count.hpp),
+    which every push notifies
+
+    The head is the only word all the threads fight for; the Layout
+    policy (see cache-line.hpp) decides if it gets its own cache line,
+    and is passed on to the hazard pointers.
+
+    INTRUSIVE
+
+    lock_free_intrusive_stack links the caller's objects (see
+    intrusive-hook.hpp), so it allocates nothing and reclaims nothing.
+    The objects are not freed by the stack, therefore no hazard
+    pointers, but the same object can come back on the top while a
+    slow pop still holds it with the old next (ABA). So the head is
+    a counted pointer (see counted-ptr.hpp), and every pop bumps its
+    counter: the cas of a slow pop fails even if the pointer is the
+    same. The counter wraps (16 bits in the packed word), a pop has
+    to sleep through 2^16 pops of the others to be fooled.
+
+    The objects have to stay valid memory (e.g. in a pool) while
+    the stack is used, a slow pop can still read their link.
+
 */
 
-template<class T>
+template<class T, class Layout = layout_padded>
 class lock_free_stack {
 
 private:
 
+    template<class X>
+    static constexpr std::size_t index_align = layout_align<X, Layout::index_align>;
+
     struct Node
     {
 
@@ -52,8 +107,9 @@ private:
     };
     
     
-    std::atomic<Node*> head_;
-    hazard_pointers<Node> hazard_ptrs_;
+    alignas(index_align<std::atomic<Node*>>) std::atomic<Node*> head_;
+    hazard_pointers<Node, Layout> hazard_ptrs_;
+    alignas(index_align<event_count>) event_count not_empty_;
 
 public:
 
@@ -69,11 +125,57 @@ public:
 
     std::shared_ptr<T> pop();
 
+    // Waits until there is an element to pop. The timed
+    // version returns empty pointer on timeout
+    std::shared_ptr<T> wait_pop();
+
+    template<class Rep, class Period>
+    std::shared_ptr<T> wait_pop_for(const std::chrono::duration<Rep, Period>& timeout);
+
     bool empty();
+
+    // Takes all the elements with one exchange, and passes them
+    // to f(std::shared_ptr<T>) newest first (drain) or oldest
+    // first (drain_fifo). Returns the number of elements. If f
+    // throws, the elements that are not passed are pushed back
+    // (if there is no memory for them, std::bad_alloc is thrown
+    // instead, and the ones that did not fit are lost)
+    template<class F>
+    std::size_t drain(F&& f);
+
+    template<class F>
+    std::size_t drain_fifo(F&& f);
+
+private:
+
+    // Moves the values of the detached nodes, that next() gives newest
+    // first (nullptr in the end), into new nodes and pushes them back
+    template<class Next>
+    void push_back_values(Next&& next);
+
+    // next() for push_back_values, that walks the chain from rest
+    static auto chain_from(Node* rest) {
+        return [rest]() mutable {
+            Node* res = rest;
+            rest = rest ? rest->next_ : nullptr;
+            return res;
+        };
+    }
+
+    // push_back_values, and then the whole detached chain from
+    // first goes to the reclamation, even if the push back throws
+    template<class Next>
+    void give_back(Node* first, Next&& next);
+
+    // Pushes the new chain first -> ... -> last with one cas
+    void push_chain(Node* first, Node* last);
+
+    // Passes every node of the detached chain to the reclamation
+    void retire_chain(Node* first);
 };
 
-template<class T>
-void  lock_free_stack<T>::push(T val) {
+template<class T, class Layout>
+void  lock_free_stack<T, Layout>::push(T val) {
 
     std::shared_ptr<T> data(new T(std::move(val)));
     Node* head_new = new Node();
@@ -81,20 +183,26 @@ void  lock_free_stack<T>::push(T val) {
     do {
         head_new->next_ = head_.load(std::memory_order_acquire);
     } while (!head_.compare_exchange_strong(head_new->next_, head_new, std::memory_order_acq_rel));
+    not_empty_.notify_one();
 }
 
-template<class T>
-std::shared_ptr<T>  lock_free_stack<T>::pop() {
+template<class T, class Layout>
+std::shared_ptr<T>  lock_free_stack<T, Layout>::pop() {
 
-    typename  hazard_pointers<Node>::HP* hp = hazard_ptrs_.acquire_hazard();
+    typename  hazard_pointers<Node, Layout>::HP* hp = hazard_ptrs_.acquire_hazard();
     Node* old_head = head_.load(std::memory_order_acquire);
-    do {
-        hp->ptr_.store(old_head, std::memory_order_release);
-        Node* tmp = head_.load(std::memory_order_acquire);
+    for (;;) {
+        hp->ptr_.store(old_head, std::memory_order_seq_cst);
+        Node* tmp = head_.load(std::memory_order_seq_cst);
         if (tmp != old_head) {
-            continue;  // Restart if head changes
+            // Restart if head changes, old_head is not safe to read
+            old_head = tmp;
+            continue;
+        }
+        if (!old_head || head_.compare_exchange_strong(old_head, old_head->next_, std::memory_order_acq_rel)) {
+            break;
         }
-    } while(old_head && !head_.compare_exchange_strong(old_head, old_head->next_, std::memory_order_acq_rel));
+    }
     hazard_ptrs_.release_hazard(hp);
 
     std::shared_ptr<T> res;
@@ -106,11 +214,210 @@ std::shared_ptr<T>  lock_free_stack<T>::pop() {
     return res;
 }
 
-template<class T>
-bool lock_free_stack<T>::empty() {
+template<class T, class Layout>
+std::shared_ptr<T> lock_free_stack<T, Layout>::wait_pop() {
+
+    std::shared_ptr<T> res;
+    not_empty_.await([this, &res]() {
+        res = pop();
+        return res != nullptr;
+    });
+    return res;
+}
+
+template<class T, class Layout>
+template<class Rep, class Period>
+std::shared_ptr<T> lock_free_stack<T, Layout>::wait_pop_for(const std::chrono::duration<Rep, Period>& timeout) {
+
+    std::shared_ptr<T> res;
+    not_empty_.await_for([this, &res]() {
+        res = pop();
+        return res != nullptr;
+    }, timeout);
+    return res;
+}
+
+template<class T, class Layout>
+bool lock_free_stack<T, Layout>::empty() {
 
     if (head_.load(std::memory_order_acquire) == nullptr) {
         return true;
     }
     return false;
-}
\ No newline at end of file
+}
+template<class T, class Layout>
+template<class F>
+std::size_t lock_free_stack<T, Layout>::drain(F&& f) {
+
+    Node* first = head_.exchange(nullptr, std::memory_order_seq_cst);
+    std::size_t count = 0;
+    for (Node* node = first; node; node = node->next_) {
+        try {
+            f(std::move(node->data_));
+        } catch (...) {
+            give_back(first, chain_from(node->next_));
+            throw;
+        }
+        ++count;
+    }
+    retire_chain(first);
+    return count;
+}
+
+template<class T, class Layout>
+template<class F>
+std::size_t lock_free_stack<T, Layout>::drain_fifo(F&& f) {
+
+    Node* first = head_.exchange(nullptr, std::memory_order_seq_cst);
+    // Newest first, as in the chain
+    std::vector<Node*> nodes;
+    try {
+        for (Node* node = first; node; node = node->next_) {
+            nodes.push_back(node);
+        }
+    } catch (...) {
+        // Nothing is passed yet, everything goes back
+        give_back(first, chain_from(first));
+        throw;
+    }
+    std::size_t i = nodes.size();
+    try {
+        while (i > 0) {
+            --i;
+            f(std::move(nodes[i]->data_));
+        }
+    } catch (...) {
+        // nodes[0, i) are not passed, and they are newest first
+        std::size_t j = 0;
+        give_back(first, [&nodes, &j, i]() {
+            return j < i ? nodes[j++] : nullptr;
+        });
+        throw;
+    }
+    retire_chain(first);
+    return nodes.size();
+}
+
+template<class T, class Layout>
+template<class Next>
+void lock_free_stack<T, Layout>::push_back_values(Next&& next) {
+
+    Node* first = nullptr;
+    Node* last = nullptr;
+    try {
+        for (Node* node = next(); node; node = next()) {
+            Node* node_new = new Node{std::move(node->data_), nullptr};
+            if (last) {
+                last->next_ = node_new;
+            } else {
+                first = node_new;
+            }
+            last = node_new;
+        }
+    } catch (...) {
+        // No memory for the rest, at least these go back
+        if (first) {
+            push_chain(first, last);
+        }
+        throw;
+    }
+    if (first) {
+        push_chain(first, last);
+    }
+}
+
+template<class T, class Layout>
+template<class Next>
+void lock_free_stack<T, Layout>::give_back(Node* first, Next&& next) {
+
+    try {
+        push_back_values(std::forward<Next>(next));
+    } catch (...) {
+        retire_chain(first);
+        throw;
+    }
+    retire_chain(first);
+}
+
+template<class T, class Layout>
+void lock_free_stack<T, Layout>::push_chain(Node* first, Node* last) {
+
+    do {
+        last->next_ = head_.load(std::memory_order_acquire);
+    } while (!head_.compare_exchange_strong(last->next_, first, std::memory_order_acq_rel));
+    not_empty_.notify_all();
+}
+
+template<class T, class Layout>
+void lock_free_stack<T, Layout>::retire_chain(Node* first) {
+
+    while (first) {
+        // A scan in reclaim_later can delete the node right away
+        Node* next = first->next_;
+        first->data_ = nullptr;
+        hazard_ptrs_.reclaim_later(first);
+        first = next;
+    }
+}
+
+template<class T, class Layout = layout_padded>
+class lock_free_intrusive_stack {
+
+    static_assert(is_intrusive_v<T>, "T has to derive from intrusive_hook");
+
+private:
+
+    template<class X>
+    static constexpr std::size_t index_align = layout_align<X, Layout::index_align>;
+
+    using counted_hook = counted_ptr<intrusive_hook>;
+
+    alignas(index_align<atomic_counted_ptr<intrusive_hook>>) atomic_counted_ptr<intrusive_hook> head_;
+
+public:
+
+    lock_free_intrusive_stack() {}
+    lock_free_intrusive_stack(const lock_free_intrusive_stack& other) = delete;
+    lock_free_intrusive_stack& operator= (const lock_free_intrusive_stack& other) = delete;
+
+    // The objects left are not touched, they belong to the caller
+
+    void push(T* obj);
+
+    // nullptr in case the stack is empty
+    T* pop();
+
+    bool empty() const {
+        return head_.load(std::memory_order_acquire).ptr() == nullptr;
+    }
+};
+
+template<class T, class Layout>
+void lock_free_intrusive_stack<T, Layout>::push(T* obj) {
+
+    intrusive_hook* hook = obj;
+    counted_hook old_head = head_.load(std::memory_order_relaxed);
+    counted_hook head_new;
+    do {
+        hook->next_.store(old_head.ptr(), std::memory_order_relaxed);
+        head_new = counted_hook(hook, old_head.count());
+    } while (!head_.compare_exchange_strong(old_head, head_new, std::memory_order_release,
+                                                                std::memory_order_relaxed));
+}
+
+template<class T, class Layout>
+T* lock_free_intrusive_stack<T, Layout>::pop() {
+
+    counted_hook old_head = head_.load(std::memory_order_acquire);
+    while (old_head.ptr()) {
+        // Can be stale, then the cas fails
+        intrusive_hook* next = old_head.ptr()->next_.load(std::memory_order_relaxed);
+        std::int64_t count = (old_head.count() == atomic_counted_ptr<intrusive_hook>::max_count()) ?
+                             0 : old_head.count() + 1;
+        if (head_.compare_exchange_strong(old_head, counted_hook(next, count), std::memory_order_acquire,
+                                                                              std::memory_order_acquire)) {
+            return static_cast<T*>(old_head.ptr());
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,259 @@
+#pragma once
+
+#include "cache-line.hpp"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+
+/*
+
+    Work stealing deque of Chase and Lev, with the C11 memory orders
+    of Le, Pop, Cohen and Zappa Nardelli ("Correct and Efficient
+    Work-Stealing for Weak Memory Models").
+
+    One thread owns the deque: it pushes and pops at the bottom, as
+    a stack (the newest task is still hot in its cache). The other
+    threads (thieves) steal at the top, the oldest task. The owner
+    does no read-modify-write, except when it pops the last element
+    and races with the thieves for it.
+
+    Members
+
+    -> top    -- the next element to steal (moved by the thieves, and
+                 by the owner for the last element)
+    -> bottom -- the next free cell (written by the owner only)
+    -> array of cells, a ring of power of 2 size
+
+    Both indices are never wrapped, they are signed, because the owner
+    moves bottom below top for a moment when the deque is empty.
+
+    The cells are atomic, since a thief can read a cell that the owner
+    is writing in the next round: the thief throws the value away then,
+    as its cas on top fails. Therefore T is trivially copyable, the
+    tasks bigger than a word are pushed by pointer.
+
+    PUSH (owner)
+
+    1. If the array is full -> copy [top, bottom) into one twice as big
+    2. Write the cell of bottom
+    3. bottom + 1 (release fence before it)
+
+    POP (owner)
+
+    1. bottom - 1, seq_cst fence, load top
+    2. top > bottom -> empty, put bottom back
+    3. top < bottom -> the element is ours
+    4. top == bottom -> the last one, cas on top against the
+       thieves, put bottom back
+
+    STEAL
+
+    1. Load top, seq_cst fence, load bottom
+    2. top >= bottom -> empty
+    3. Read the cell of top, cas top -> top + 1
+        -> if it fails, another thief (or the owner) has taken it
+
+    The old arrays are kept until the deque is destroyed, a thief can
+    still be reading them. Every array is twice the previous one, so
+    together they take at most as much as the current one.
+
+    ThreadSanitizer does not support fences, under it they are
+    replaced by stronger orders on the indices.
+
+*/
+
+template<class T, class Layout = layout_padded>
+class lock_free_work_stealing_deque {
+
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "T is kept in atomic cells, push bigger tasks by pointer");
+
+private:
+
+    template<class X>
+    static constexpr std::size_t index_align = layout_align<X, Layout::index_align>;
+
+    struct Cell {
+        alignas(layout_align<std::atomic<T>, Layout::cell_align>) std::atomic<T> val_;
+    };
+
+    struct Array {
+
+        Array(std::int64_t size)
+        : size_(size)
+        , MASK(size - 1)
+        , data_(std::make_unique<Cell[]>(size))
+        {}
+
+        T get(std::int64_t i) const {
+            return data_[i & MASK].val_.load(std::memory_order_relaxed);
+        }
+
+        void put(std::int64_t i, T val) {
+            data_[i & MASK].val_.store(val, std::memory_order_relaxed);
+        }
+
+        std::int64_t            size_;
+        std::int64_t            MASK;
+        std::unique_ptr<Cell[]> data_;
+    };
+
+    // Copies [top, bottom) into the array twice as big, and publishes it
+    Array* grow(Array* old, std::int64_t top, std::int64_t bottom);
+
+    // Thieves part
+    alignas(index_align<std::atomic<std::int64_t>>) std::atomic<std::int64_t> top_;
+
+    // Owner part, the thieves only read it
+    alignas(index_align<std::atomic<std::int64_t>>) std::atomic<std::int64_t> bottom_;
+    std::atomic<Array*>                                                       array_;
+    // Current array and all the old ones
+    std::vector<std::unique_ptr<Array>>                                       arrays_;
+
+public:
+
+    lock_free_work_stealing_deque()
+    : lock_free_work_stealing_deque(1 << 10)
+    {}
+
+    lock_free_work_stealing_deque(std::size_t size)
+    : top_(0)
+    , bottom_(0)
+    {
+        std::int64_t cap = 1;
+        while (static_cast<std::size_t>(cap) < size) {
+            cap <<= 1;
+        }
+        arrays_.push_back(std::make_unique<Array>(cap));
+        array_.store(arrays_.back().get(), std::memory_order_relaxed);
+    }
+
+    lock_free_work_stealing_deque(const lock_free_work_stealing_deque&) = delete;
+    lock_free_work_stealing_deque& operator = (const lock_free_work_stealing_deque&) = delete;
+
+    // 1. push -- adds the element at the bottom, grows
+    // the array if it is full. Owner thread only
+
+    void push(T val);
+
+    // 2. pop -- takes the newest element, returns false
+    // in case the deque is empty. Owner thread only
+
+    bool pop(T& val);
+
+    // 3. steal -- takes the oldest element, returns false in
+    // case the deque is empty, or another thread has taken
+    // this element first (then it is worth trying again)
+
+    bool steal(T& val);
+
+    // 4. Approximate, when the other threads are working
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    std::size_t size() const;
+
+    std::size_t capacity() const {
+        return static_cast<std::size_t>(array_.load(std::memory_order_relaxed)->size_);
+    }
+};
+
+template<class T, class Layout>
+typename lock_free_work_stealing_deque<T, Layout>::Array*
+lock_free_work_stealing_deque<T, Layout>::grow(Array* old, std::int64_t top, std::int64_t bottom) {
+
+    auto bigger = std::make_unique<Array>(old->size_ * 2);
+    for (std::int64_t i = top; i < bottom; ++i) {
+        bigger->put(i, old->get(i));
+    }
+    Array* res = bigger.get();
+    arrays_.push_back(std::move(bigger));
+    array_.store(res, std::memory_order_release);
+    return res;
+}
+
+template<class T, class Layout>
+void lock_free_work_stealing_deque<T, Layout>::push(T val) {
+
+    std::int64_t b = bottom_.load(std::memory_order_relaxed);
+    std::int64_t t = top_.load(std::memory_order_acquire);
+    Array* a = array_.load(std::memory_order_relaxed);
+    if (b - t > a->size_ - 1) {
+        a = grow(a, t, b);
+    }
+    a->put(b, val);
+#if defined(__SANITIZE_THREAD__)
+    bottom_.store(b + 1, std::memory_order_release);
+#else
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(b + 1, std::memory_order_relaxed);
+#endif
+}
+
+template<class T, class Layout>
+bool lock_free_work_stealing_deque<T, Layout>::pop(T& val) {
+
+    std::int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+    Array* a = array_.load(std::memory_order_relaxed);
+#if defined(__SANITIZE_THREAD__)
+    bottom_.exchange(b, std::memory_order_seq_cst);
+#else
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+#endif
+    std::int64_t t = top_.load(std::memory_order_relaxed);
+    if (t > b) {
+        bottom_.store(b + 1, std::memory_order_relaxed);
+        return false;
+    }
+    T res = a->get(b);
+    if (t == b) {
+        // The last element, the thieves can be after it too
+        bool won = top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                          std::memory_order_relaxed);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+        if (!won) {
+            return false;
+        }
+    }
+    val = res;
+    return true;
+}
+
+template<class T, class Layout>
+bool lock_free_work_stealing_deque<T, Layout>::steal(T& val) {
+
+#if defined(__SANITIZE_THREAD__)
+    std::int64_t t = top_.fetch_add(0, std::memory_order_seq_cst);
+#else
+    std::int64_t t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+#endif
+    std::int64_t b = bottom_.load(std::memory_order_acquire);
+    if (t >= b) {
+        return false;
+    }
+    // consume in the paper, no compiler implements it
+    Array* a = array_.load(std::memory_order_acquire);
+    T res = a->get(t);
+    if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                std::memory_order_relaxed)) {
+        return false;
+    }
+    val = res;
+    return true;
+}
+
+template<class T, class Layout>
+std::size_t lock_free_work_stealing_deque<T, Layout>::size() const {
+
+    std::int64_t b = bottom_.load(std::memory_order_relaxed);
+    std::int64_t t = top_.load(std::memory_order_relaxed);
+    return b > t ? static_cast<std::size_t>(b - t) : 0;
+}
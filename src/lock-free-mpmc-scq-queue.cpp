@@ -0,0 +1 @@
+#include "lock-free-mpmc-scq-queue.hpp"
@@ -0,0 +1 @@
+#include "lock-free-mpmc-unbounded-queue.hpp"
@@ -0,0 +1 @@
+#include "lock-free-multicast-ring.hpp"
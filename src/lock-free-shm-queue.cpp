@@ -0,0 +1 @@
+#include "lock-free-shm-queue.hpp"
@@ -0,0 +1 @@
+#include "lock-free-spsc-byte-ring.hpp"
@@ -0,0 +1 @@
+#include "lock-free-spsc-ring-queue.hpp"
@@ -0,0 +1 @@
+#include "lock-free-spsc-segmented-queue.hpp"
@@ -0,0 +1 @@
+#include "lock-free-work-stealing-deque.hpp"
@@ -0,0 +1,91 @@
+#include "event-count.hpp"
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+/*
+
+1. Basic Functionality
+
+    - await returns at once, if the condition is true
+    - timed await gives up after the timeout
+
+2. Concurrent Access Tests
+
+    - Sleeping threads are woken up by notify_one (notify_all)
+    - Ping pong of two threads on two event counts, none
+    of the notifications is lost
+
+*/
+
+// 1. Condition is true already
+TEST(Basic, Ready) {
+
+    event_count ec;
+    ec.await([]() { return true; });
+    EXPECT_TRUE(ec.await_for([]() { return true; }, std::chrono::milliseconds(0)));
+    // Nobody waits, nothing happens
+    ec.notify_one();
+    ec.notify_all();
+}
+
+// 2. Condition never comes
+TEST(Basic, Timeout) {
+
+    event_count ec;
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(ec.await_for([]() { return false; }, std::chrono::milliseconds(20)));
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+}
+
+// 3. Several sleepers, notified all together
+TEST(Concurrent, NotifyAll) {
+
+    event_count ec;
+    std::atomic<bool> flag{false};
+    std::atomic<int> woken{0};
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&]() {
+            ec.await([&]() { return flag.load(); });
+            ++woken;
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(0, woken.load());
+    flag.store(true);
+    ec.notify_all();
+    for (auto& t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(4, woken.load());
+}
+
+// 4. Two threads pass the turn to each other,
+//    every notification has to reach the other side
+TEST(Concurrent, PingPong) {
+
+    event_count ping;
+    event_count pong;
+    std::atomic<int> turn{0};
+    int n = 20000;
+
+    std::thread other([&]() {
+        for (int i = 0; i < n; ++i) {
+            ping.await([&]() { return turn.load() == 2 * i + 1; });
+            turn.store(2 * i + 2);
+            pong.notify_one();
+        }
+    });
+    for (int i = 0; i < n; ++i) {
+        turn.store(2 * i + 1);
+        ping.notify_one();
+        pong.await([&]() { return turn.load() == 2 * i + 2; });
+    }
+    other.join();
+    EXPECT_EQ(2 * n, turn.load());
+}
@@ -4,6 +4,8 @@
 #include <iostream>
 #include <thread>
 #include <vector>
+#include <atomic>
+#include <memory>
 
 TEST(Basic, Aquire) {
 
@@ -150,4 +152,159 @@ TEST(Concurrent, RestoreEightThreads) {
     for (int i = 0 ; i < n; ++i) {
         EXPECT_TRUE(res[i].load()) << "i = " << i << "\n";
     }
-}
\ No newline at end of file
+}
+// The thread gets the same record again, without any cas
+TEST(Cache, SameRecord) {
+
+    hazard_pointers<int> hazard_ptrs;
+
+    hazard_pointers<int>::HP* hp = hazard_ptrs.acquire_hazard();
+    hazard_ptrs.release_hazard(hp);
+    for (int i = 0; i < 10; ++i) {
+        hazard_pointers<int>::HP* again = hazard_ptrs.acquire_hazard();
+        EXPECT_EQ(hp, again);
+        hazard_ptrs.release_hazard(again);
+    }
+}
+
+// Two hazards at the same time are two records, and the
+// cached one stays hidden from the other threads
+TEST(Cache, Nested) {
+
+    hazard_pointers<int> hazard_ptrs;
+
+    hazard_pointers<int>::HP* first = hazard_ptrs.acquire_hazard();
+    hazard_pointers<int>::HP* second = hazard_ptrs.acquire_hazard();
+    EXPECT_NE(first, second);
+    hazard_ptrs.release_hazard(second);
+    hazard_ptrs.release_hazard(first);
+
+    hazard_pointers<int>::HP* other = nullptr;
+    std::thread t([&]() {
+        other = hazard_ptrs.acquire_hazard();
+        hazard_ptrs.release_hazard(other);
+    });
+    t.join();
+    EXPECT_EQ(second, other);
+}
+
+// The record of the exited thread goes back to the domain
+TEST(Cache, ThreadExit) {
+
+    hazard_pointers<int> hazard_ptrs;
+
+    hazard_pointers<int>::HP* hp = nullptr;
+    std::thread t([&]() {
+        hp = hazard_ptrs.acquire_hazard();
+        hazard_ptrs.release_hazard(hp);
+    });
+    t.join();
+
+    hazard_pointers<int>::HP* again = hazard_ptrs.acquire_hazard();
+    EXPECT_EQ(hp, again);
+    hazard_ptrs.release_hazard(again);
+}
+
+// The domain is destroyed before the thread that has its record
+// in the cache exits, and the thread uses more domains than
+// the cache has slots
+TEST(Cache, DomainFirst) {
+
+    std::vector<std::unique_ptr<hazard_pointers<int>>> domains;
+    for (std::size_t i = 0; i < 2 * hazard_cache::SLOTS; ++i) {
+        domains.push_back(std::make_unique<hazard_pointers<int>>());
+    }
+    std::atomic<int> step(0);
+    std::thread t([&]() {
+        for (auto& d : domains) {
+            d->release_hazard(d->acquire_hazard());
+        }
+        step.store(1);
+        while (step.load() != 2) {
+            std::this_thread::yield();
+        }
+    });
+    while (step.load() != 1) {
+        std::this_thread::yield();
+    }
+    domains.clear();
+    step.store(2);
+    t.join();
+}
+
+// The thread holds hazards of more domains than the cache has
+// slots at the same time: the records in use are not evicted, and
+// another thread can not take them
+TEST(Cache, EvictBusy) {
+
+    std::size_t n = 2 * hazard_cache::SLOTS;
+    std::vector<std::unique_ptr<hazard_pointers<int>>> domains;
+    std::vector<hazard_pointers<int>::HP*> hps;
+    std::vector<int> vals(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        domains.push_back(std::make_unique<hazard_pointers<int>>());
+        hps.push_back(domains[i]->acquire_hazard());
+        hps[i]->ptr_.store(&vals[i]);
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+        EXPECT_TRUE(hps[i]->active_.load());
+        EXPECT_EQ(&vals[i], hps[i]->ptr_.load());
+    }
+    std::thread t([&]() {
+        for (std::size_t i = 0; i < n; ++i) {
+            hazard_pointers<int>::HP* other = domains[i]->acquire_hazard();
+            EXPECT_NE(hps[i], other);
+            domains[i]->release_hazard(other);
+        }
+    });
+    t.join();
+    for (std::size_t i = 0; i < n; ++i) {
+        EXPECT_EQ(&vals[i], hps[i]->ptr_.load());
+        domains[i]->release_hazard(hps[i]);
+    }
+}
+
+// Counts its destructions, to see what the scan has deleted
+struct Counted {
+    ~Counted() { ++destroyed; }
+    static inline std::atomic<int> destroyed{0};
+};
+
+// Every protected node stays in the reclamation list, the rest
+// is deleted: with a few hazards (linear search of the snapshot)
+// and with many (sorted snapshot)
+void scan_with_hazards(int hazards) {
+
+    hazard_pointers<Counted> hazard_ptrs;
+    Counted::destroyed.store(0);
+
+    std::vector<hazard_pointers<Counted>::HP*> hps;
+    for (int i = 0; i < hazards; ++i) {
+        hazard_pointers<Counted>::HP* hp = hazard_ptrs.acquire_hazard();
+        Counted* node = new Counted();
+        hp->ptr_.store(node);
+        hazard_ptrs.reclaim_later(node);
+        hps.push_back(hp);
+    }
+    int unprotected = 100;
+    for (int i = 0; i < unprotected; ++i) {
+        hazard_ptrs.reclaim_later(new Counted());
+    }
+
+    hazard_ptrs.delete_nodes_with_no_hazards();
+    EXPECT_EQ(unprotected, Counted::destroyed.load());
+
+    for (auto hp : hps) {
+        hazard_ptrs.release_hazard(hp);
+    }
+    hazard_ptrs.delete_nodes_with_no_hazards();
+    EXPECT_EQ(unprotected + hazards, Counted::destroyed.load());
+}
+
+TEST(Scan, FewHazards) {
+    scan_with_hazards(3);
+}
+
+TEST(Scan, ManyHazards) {
+    scan_with_hazards(100);
+}
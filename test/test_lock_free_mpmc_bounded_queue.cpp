@@ -9,6 +9,11 @@
 #include <chrono>
 #include  <stdexcept>
 #include <memory>
+#include <iterator>
+#include <algorithm>
+#include <string>
+#include <cstdint>
+#include <array>
 
 /*
 1. Basic Functionality
@@ -430,3 +435,887 @@ TEST(Exception, MPMC_PTR) {
 }
 
 
+
+/*
+###################################################
+
+            INLINE STORAGE
+
+###################################################
+*/
+
+// 11. Single thread, push and pop by value
+TEST(Inline, TryPop) {
+
+    lock_free_mpmc_bounded_queue<int> q(16);
+
+    EXPECT_TRUE(q.push(1));
+    EXPECT_TRUE(q.emplace(2));
+    EXPECT_TRUE(q.push(3));
+
+    int val;
+    EXPECT_TRUE(q.try_pop(val));
+    EXPECT_EQ(1, val);
+    std::optional<int> res = q.try_pop();
+    ASSERT_TRUE(res);
+    EXPECT_EQ(2, *res);
+    auto ptr = q.pop();
+    ASSERT_TRUE(ptr);
+    EXPECT_EQ(3, *ptr);
+
+    EXPECT_FALSE(q.try_pop(val));
+    EXPECT_FALSE(q.try_pop());
+    EXPECT_TRUE(q.empty());
+}
+
+// 12. Move only type, constructed in place
+TEST(Inline, MoveOnly) {
+
+    lock_free_mpmc_bounded_queue<std::unique_ptr<int>> q(16);
+
+    EXPECT_TRUE(q.emplace(new int(1)));
+    EXPECT_TRUE(q.push(std::make_unique<int>(2)));
+
+    std::unique_ptr<int> val;
+    EXPECT_TRUE(q.try_pop(val));
+    EXPECT_EQ(1, *val);
+    auto res = q.try_pop();
+    ASSERT_TRUE(res);
+    EXPECT_EQ(2, **res);
+}
+
+// 13. Elements left in the queue are
+//  destroyed together with it
+TEST(Inline, Destroy) {
+
+    std::shared_ptr<int> ptr = std::make_shared<int>(1);
+    {
+        lock_free_mpmc_bounded_queue<std::shared_ptr<int>> q(16);
+        q.push(ptr);
+        q.push(ptr);
+        q.push(ptr);
+        q.try_pop();
+        EXPECT_EQ(3, ptr.use_count());
+    }
+    EXPECT_EQ(1, ptr.use_count());
+}
+
+// 14. Constructor that throws inside of the queue
+//    -> the cell is skipped by the popper, the rest
+//          of the elements are there
+TEST(Inline, ThrowingEmplace) {
+
+    lock_free_mpmc_bounded_queue<ExeptInt> q(16);
+    ExeptInt bad(1, true);
+
+    EXPECT_TRUE(q.emplace(0, false));
+    EXPECT_THROW(q.emplace(bad), std::runtime_error);
+    EXPECT_TRUE(q.emplace(2, false));
+
+    ExeptInt val(-1, false);
+    EXPECT_TRUE(q.try_pop(val));
+    EXPECT_EQ(0, val.i_);
+    EXPECT_TRUE(q.try_pop(val));
+    EXPECT_EQ(2, val.i_);
+    EXPECT_FALSE(q.try_pop(val));
+
+    EXPECT_THROW(q.emplace(bad), std::runtime_error);
+    EXPECT_FALSE(q.try_pop(val));
+    EXPECT_TRUE(q.empty());
+}
+
+// 15. Multiple Producres, Multiple Consumers by value
+//    -> in the end we have all the elements that we pushed
+TEST(Inline, MPMC) {
+
+    lock_free_mpmc_bounded_queue<int> q(1024);
+
+    std::vector<std::thread> threads;
+    int concurrency_level = 8;
+    int n = 80000;
+    for (int i = 0; i < (concurrency_level / 2); ++i) {
+        threads.emplace_back([i, &q, n, concurrency_level]() {
+            int beg = i * (n / (concurrency_level / 2));
+            int end = (i + 1) * (n / (concurrency_level / 2));
+            for (int j = beg; j < end; ++j) {
+                while(!q.emplace(j));
+            }
+        });
+    }
+
+    std::vector<std::atomic<bool>> values(n);
+    for (int i = 0; i < (concurrency_level / 2); ++i) {
+        threads.emplace_back([n, &q, &values, concurrency_level]() {
+            int val;
+            for (int j = 0; j < n / (concurrency_level / 2); ++j) {
+                while(!q.try_pop(val));
+                values[val].store(true, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    for (int i = 0; i < concurrency_level; ++i) {
+        threads[i].join();
+    }
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_TRUE(values[i].load(std::memory_order_relaxed)) << "i= " << i << "\n";
+    }
+}
+
+/*
+###################################################
+
+            BULK Functionality
+
+###################################################
+*/
+
+// 16. Single thread, push a batch and pop it
+//    in several smaller batches
+TEST(Bulk, PushPop) {
+
+    lock_free_mpmc_bounded_queue<int> q(16);
+    std::vector<int> in(10);
+    for (int i = 0; i < 10; ++i) {
+        in[i] = i;
+    }
+    EXPECT_EQ(10u, q.push_bulk(in.begin(), in.end()));
+
+    std::vector<int> out;
+    EXPECT_EQ(4u, q.pop_bulk(std::back_inserter(out), 4));
+    EXPECT_EQ(4u, q.pop_bulk(std::back_inserter(out), 4));
+    EXPECT_EQ(2u, q.pop_bulk(std::back_inserter(out), 4));
+    EXPECT_EQ(0u, q.pop_bulk(std::back_inserter(out), 4));
+    EXPECT_EQ(in, out);
+    EXPECT_TRUE(q.empty());
+}
+
+// 17. Only the part that fits is pushed, one cell
+//    is kept free as in push
+TEST(Bulk, Full) {
+
+    lock_free_mpmc_bounded_queue<int> q(8);
+    std::vector<int> in(20, 1);
+    EXPECT_EQ(7u, q.push_bulk(in.begin(), in.end()));
+    EXPECT_EQ(0u, q.push_bulk(in.begin(), in.end()));
+    EXPECT_FALSE(q.push(1));
+
+    int out[20];
+    EXPECT_EQ(7u, q.pop_bulk(out, 20));
+    EXPECT_EQ(0u, q.pop_bulk(out, 20));
+    // Indices keep working after the wrap around
+    for (int round = 0; round < 10; ++round) {
+        EXPECT_EQ(5u, q.push_bulk(in.begin(), in.begin() + 5));
+        EXPECT_EQ(5u, q.pop_bulk(out, 20));
+    }
+}
+
+// 18. Exception in the middle of the batch
+//    -> the elements before it are pushed, the rest
+//          of the taken range is skipped by the poppers
+TEST(Bulk, Exception) {
+
+    lock_free_mpmc_bounded_queue<ExeptInt> q(16);
+    std::vector<ExeptInt> in;
+    for (int i = 0; i < 4; ++i) {
+        in.emplace_back(i, false);
+    }
+    in[2].fail_ = true;
+
+    EXPECT_THROW(q.push_bulk(in.begin(), in.end()), std::runtime_error);
+    EXPECT_TRUE(q.emplace(10, false));
+
+    std::vector<ExeptInt> out(10, ExeptInt(-1, false));
+    EXPECT_EQ(3u, q.pop_bulk(out.begin(), 10));
+    EXPECT_EQ(0, out[0].i_);
+    EXPECT_EQ(1, out[1].i_);
+    EXPECT_EQ(10, out[2].i_);
+    EXPECT_TRUE(q.empty());
+}
+
+// 19. Multiple Producres, Multiple Consumers with batches,
+//    mixed with single operations
+//    -> in the end we have all the elements that we pushed
+TEST(Bulk, MPMC) {
+
+    lock_free_mpmc_bounded_queue<int> q(1024);
+
+    std::vector<std::thread> threads;
+    int concurrency_level = 8;
+    int n = 80000;
+    int batch = 32;
+    for (int i = 0; i < (concurrency_level / 2); ++i) {
+        threads.emplace_back([i, &q, n, batch, concurrency_level]() {
+            int beg = i * (n / (concurrency_level / 2));
+            int end = (i + 1) * (n / (concurrency_level / 2));
+            std::vector<int> in;
+            for (int j = beg; j < end; ) {
+                if (i == 0) {
+                    while(!q.push(j));
+                    ++j;
+                    continue;
+                }
+                in.clear();
+                for (int k = j; k < std::min(end, j + batch); ++k) {
+                    in.push_back(k);
+                }
+                j += q.push_bulk(in.begin(), in.end());
+            }
+        });
+    }
+
+    std::vector<std::atomic<bool>> values(n);
+    std::atomic<int> consumed{0};
+    for (int i = 0; i < (concurrency_level / 2); ++i) {
+        threads.emplace_back([i, n, batch, &q, &values, &consumed]() {
+            std::vector<int> out(batch);
+            while (consumed.load() < n) {
+                std::size_t cnt = 0;
+                if (i == 0) {
+                    cnt = q.try_pop(out[0]) ? 1 : 0;
+                } else {
+                    cnt = q.pop_bulk(out.begin(), batch);
+                }
+                for (std::size_t k = 0; k < cnt; ++k) {
+                    values[out[k]].store(true, std::memory_order_relaxed);
+                }
+                consumed += cnt;
+            }
+        });
+    }
+
+    for (int i = 0; i < concurrency_level; ++i) {
+        threads[i].join();
+    }
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_TRUE(values[i].load(std::memory_order_relaxed)) << "i= " << i << "\n";
+    }
+}
+
+/*
+###################################################
+
+            BLOCKING Functionality
+
+###################################################
+*/
+
+// 20. Timed versions give up on the empty (full) queue
+//    and succeed as soon as there is something to do
+TEST(Blocking, Timeout) {
+
+    lock_free_mpmc_bounded_queue<int> q(4);
+    int val = -1;
+    EXPECT_FALSE(q.wait_pop_for(val, std::chrono::milliseconds(10)));
+    EXPECT_EQ(-1, val);
+
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(q.wait_push_for(i, std::chrono::milliseconds(10)));
+    }
+    EXPECT_FALSE(q.wait_push_for(3, std::chrono::milliseconds(10)));
+
+    EXPECT_TRUE(q.wait_pop_for(val, std::chrono::milliseconds(10)));
+    EXPECT_EQ(0, val);
+}
+
+// 21. Sleeping consumer is woken up by the push
+TEST(Blocking, WakeUp) {
+
+    lock_free_mpmc_bounded_queue<int> q(4);
+    int val = -1;
+    std::thread consumer([&]() {
+        q.wait_pop(val);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    q.push(7);
+    consumer.join();
+    EXPECT_EQ(7, val);
+}
+
+// 22. Multiple Producres, Multiple Consumers on a tiny queue,
+//    so that both sides have to wait for each other
+//    -> in the end we have all the elements that we pushed
+TEST(Blocking, MPMC) {
+
+    lock_free_mpmc_bounded_queue<int> q(4);
+
+    std::vector<std::thread> threads;
+    int concurrency_level = 8;
+    int n = 40000;
+    for (int i = 0; i < (concurrency_level / 2); ++i) {
+        threads.emplace_back([i, &q, n, concurrency_level]() {
+            int beg = i * (n / (concurrency_level / 2));
+            int end = (i + 1) * (n / (concurrency_level / 2));
+            for (int j = beg; j < end; ++j) {
+                q.wait_push(j);
+            }
+        });
+    }
+
+    std::vector<std::atomic<bool>> values(n);
+    for (int i = 0; i < (concurrency_level / 2); ++i) {
+        threads.emplace_back([&q, n, concurrency_level, &values]() {
+            int val;
+            for (int j = 0; j < n / (concurrency_level / 2); ++j) {
+                q.wait_pop(val);
+                values[val].store(true, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_TRUE(values[i].load(std::memory_order_relaxed)) << "i= " << i << "\n";
+    }
+    EXPECT_TRUE(q.empty());
+}
+
+/*
+###################################################
+
+            PACKED Cells
+
+###################################################
+*/
+
+struct Handle {
+    short kind_;
+    short id_;
+};
+
+// Trivially copyable, but its constructor from int can throw
+struct Checked {
+
+    Checked(int i)
+    : i_(i)
+    {
+        if (i < 0) {
+            throw std::runtime_error(std::to_string(i));
+        }
+    }
+
+    int i_;
+};
+
+static_assert(lock_free_mpmc_bounded_queue<int>::packed, "int is packed");
+static_assert(lock_free_mpmc_bounded_queue<Handle>::packed, "Handle is packed");
+static_assert(lock_free_mpmc_bounded_queue<Checked>::packed, "Checked is packed");
+static_assert(lock_free_mpmc_bounded_queue<std::uint64_t>::packed, "8 bytes take two words");
+static_assert(lock_free_mpmc_bounded_queue<void*>::packed, "pointers take two words");
+static_assert(!lock_free_mpmc_bounded_queue<std::array<int, 3>>::packed, "12 bytes do not fit");
+static_assert(!lock_free_mpmc_bounded_queue<ExeptInt>::packed, "not trivially copyable");
+
+// 23. Packed cells keep the order and the
+//    bytes of the value through many rounds
+TEST(Packed, Rounds) {
+
+    lock_free_mpmc_bounded_queue<Handle> q(8);
+    Handle val{0, 0};
+    for (short round = 0; round < 100; ++round) {
+        for (short i = 0; i < 7; ++i) {
+            EXPECT_TRUE(q.push(Handle{round, static_cast<short>(-i)}));
+        }
+        EXPECT_FALSE(q.push(Handle{0, 0}));
+        for (short i = 0; i < 7; ++i) {
+            EXPECT_TRUE(q.try_pop(val));
+            EXPECT_EQ(round, val.kind_);
+            EXPECT_EQ(-i, val.id_);
+        }
+        EXPECT_FALSE(q.try_pop(val));
+    }
+    EXPECT_TRUE(q.empty());
+}
+
+// 24. Constructor that throws in a packed cell,
+//    single and in the batch
+//    -> the cell is skipped by the poppers
+TEST(Packed, ThrowingEmplace) {
+
+    lock_free_mpmc_bounded_queue<Checked> q(16);
+    EXPECT_TRUE(q.emplace(1));
+    EXPECT_THROW(q.emplace(-1), std::runtime_error);
+    EXPECT_TRUE(q.emplace(2));
+
+    std::vector<int> in = {3, 4, -5, 6};
+    EXPECT_THROW(q.push_bulk(in.begin(), in.end()), std::runtime_error);
+    EXPECT_TRUE(q.emplace(7));
+
+    std::vector<Checked> out(10, Checked(0));
+    EXPECT_EQ(5u, q.pop_bulk(out.begin(), 10));
+    EXPECT_EQ(1, out[0].i_);
+    EXPECT_EQ(2, out[1].i_);
+    EXPECT_EQ(3, out[2].i_);
+    EXPECT_EQ(4, out[3].i_);
+    EXPECT_EQ(7, out[4].i_);
+    EXPECT_TRUE(q.empty());
+}
+
+// 25. Multiple Producres, Multiple Consumers on packed cells
+//    -> in the end we have all the elements that we pushed
+TEST(Packed, MPMC) {
+
+    lock_free_mpmc_bounded_queue<int> q(1024);
+
+    std::vector<std::thread> threads;
+    int concurrency_level = 8;
+    int n = 80000;
+    for (int i = 0; i < (concurrency_level / 2); ++i) {
+        threads.emplace_back([i, &q, n, concurrency_level]() {
+            int beg = i * (n / (concurrency_level / 2));
+            int end = (i + 1) * (n / (concurrency_level / 2));
+            for (int j = beg; j < end; ++j) {
+                while(!q.push(j));
+            }
+        });
+    }
+
+    std::vector<std::atomic<bool>> values(n);
+    for (int i = 0; i < (concurrency_level / 2); ++i) {
+        threads.emplace_back([&q, n, concurrency_level, &values]() {
+            int val;
+            for (int j = 0; j < n / (concurrency_level / 2); ++j) {
+                while(!q.try_pop(val));
+                values[val].store(true, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_TRUE(values[i].load(std::memory_order_relaxed)) << "i= " << i << "\n";
+    }
+    EXPECT_TRUE(q.empty());
+}
+
+// 26. Two word cells keep all 8 bytes of the value,
+//    integers and pointers
+TEST(Packed, Wide) {
+
+    lock_free_mpmc_bounded_queue<std::uint64_t> q(8);
+    std::uint64_t val = 0;
+    for (std::uint64_t round = 0; round < 100; ++round) {
+        for (std::uint64_t i = 0; i < 7; ++i) {
+            EXPECT_TRUE(q.push(~round << 32 | i));
+        }
+        EXPECT_FALSE(q.push(0));
+        for (std::uint64_t i = 0; i < 7; ++i) {
+            EXPECT_TRUE(q.try_pop(val));
+            EXPECT_EQ(~round << 32 | i, val);
+        }
+        EXPECT_FALSE(q.try_pop(val));
+    }
+    EXPECT_TRUE(q.empty());
+
+    std::vector<int> objs(4);
+    lock_free_mpmc_bounded_queue<void*> ptrs(8);
+    for (auto& obj : objs) {
+        EXPECT_TRUE(ptrs.push(&obj));
+    }
+    void* ptr;
+    for (auto& obj : objs) {
+        EXPECT_TRUE(ptrs.try_pop(ptr));
+        EXPECT_EQ(&obj, ptr);
+    }
+    EXPECT_FALSE(ptrs.try_pop(ptr));
+}
+
+// 27. Multiple Producres, Multiple Consumers on two word cells
+//    -> in the end we have all the elements that we pushed
+TEST(Packed, WideMPMC) {
+
+    lock_free_mpmc_bounded_queue<std::uint64_t> q(1024);
+
+    std::vector<std::thread> threads;
+    int concurrency_level = 8;
+    int n = 80000;
+    // The upper bits check that the whole word goes through
+    std::uint64_t high = std::uint64_t(0xabcd) << 48;
+    for (int i = 0; i < (concurrency_level / 2); ++i) {
+        threads.emplace_back([i, &q, n, concurrency_level, high]() {
+            int beg = i * (n / (concurrency_level / 2));
+            int end = (i + 1) * (n / (concurrency_level / 2));
+            for (int j = beg; j < end; ++j) {
+                while(!q.push(high | j));
+            }
+        });
+    }
+
+    std::vector<std::atomic<bool>> values(n);
+    for (int i = 0; i < (concurrency_level / 2); ++i) {
+        threads.emplace_back([&q, n, concurrency_level, &values, high]() {
+            std::uint64_t val;
+            for (int j = 0; j < n / (concurrency_level / 2); ++j) {
+                while(!q.try_pop(val));
+                EXPECT_EQ(high, val & ~std::uint64_t(0xffffffff));
+                values[val & 0xffffffff].store(true, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_TRUE(values[i].load(std::memory_order_relaxed)) << "i= " << i << "\n";
+    }
+    EXPECT_TRUE(q.empty());
+}
+
+/*
+###################################################
+
+            STATIC Capacity
+
+###################################################
+*/
+
+static lock_free_mpmc_bounded_queue<int, 1024> static_queue;
+
+static_assert(sizeof(lock_free_mpmc_bounded_queue<int, 1024>) >= 1024 * sizeof(std::uint64_t),
+              "the cells are in the object");
+
+// 28. Queue in the static storage, and on the stack,
+//    holds Capacity - 1 elements as the dynamic one
+TEST(Static, PushPop) {
+
+    EXPECT_TRUE(static_queue.empty());
+    for (int i = 0; i < 1023; ++i) {
+        EXPECT_TRUE(static_queue.push(i));
+    }
+    EXPECT_FALSE(static_queue.push(1023));
+    int val;
+    for (int i = 0; i < 1023; ++i) {
+        EXPECT_TRUE(static_queue.try_pop(val));
+        EXPECT_EQ(i, val);
+    }
+    EXPECT_TRUE(static_queue.empty());
+
+    lock_free_mpmc_bounded_queue<std::string, 4> q;
+    EXPECT_TRUE(q.push("a"));
+    EXPECT_TRUE(q.push("b"));
+    EXPECT_TRUE(q.push("c"));
+    EXPECT_FALSE(q.push("d"));
+    std::string str;
+    EXPECT_TRUE(q.try_pop(str));
+    EXPECT_EQ("a", str);
+}
+
+// 29. Multiple Producres, Multiple Consumers on the fixed capacity
+//    -> in the end we have all the elements that we pushed
+TEST(Static, MPMC) {
+
+    auto q = std::make_unique<lock_free_mpmc_bounded_queue<int, 256>>();
+
+    std::vector<std::thread> threads;
+    int concurrency_level = 8;
+    int n = 80000;
+    for (int i = 0; i < (concurrency_level / 2); ++i) {
+        threads.emplace_back([i, &q, n, concurrency_level]() {
+            int beg = i * (n / (concurrency_level / 2));
+            int end = (i + 1) * (n / (concurrency_level / 2));
+            std::vector<int> in;
+            for (int j = beg; j < end; ) {
+                in.clear();
+                for (int k = j; k < std::min(end, j + 16); ++k) {
+                    in.push_back(k);
+                }
+                j += q->push_bulk(in.begin(), in.end());
+            }
+        });
+    }
+
+    std::vector<std::atomic<bool>> values(n);
+    for (int i = 0; i < (concurrency_level / 2); ++i) {
+        threads.emplace_back([&q, n, concurrency_level, &values]() {
+            int val;
+            for (int j = 0; j < n / (concurrency_level / 2); ++j) {
+                q->wait_pop(val);
+                values[val].store(true, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_TRUE(values[i].load(std::memory_order_relaxed)) << "i= " << i << "\n";
+    }
+    EXPECT_TRUE(q->empty());
+}
+
+/*
+###################################################
+
+            WRAP around of the indices
+
+###################################################
+*/
+
+// 30. Queue that starts right before the wrap around of
+//    the 64 bit indices (and of the 31 bit generations of
+//    the packed cells) keeps working after it
+TEST(Wrap, Indices) {
+
+    std::size_t start = SIZE_MAX - 100;
+    lock_free_mpmc_bounded_queue<int> packed(8, start);
+    lock_free_mpmc_bounded_queue<std::string> inl(8, start);
+
+    int val;
+    std::string str;
+    for (int round = 0; round < 100; ++round) {
+        for (int i = 0; i < 7; ++i) {
+            EXPECT_TRUE(packed.push(round + i));
+            EXPECT_TRUE(inl.push(std::to_string(round + i)));
+        }
+        EXPECT_FALSE(packed.push(0));
+        EXPECT_FALSE(inl.push("0"));
+        for (int i = 0; i < 7; ++i) {
+            EXPECT_TRUE(packed.try_pop(val));
+            EXPECT_EQ(round + i, val);
+            EXPECT_TRUE(inl.try_pop(str));
+            EXPECT_EQ(std::to_string(round + i), str);
+        }
+        EXPECT_TRUE(packed.empty());
+        EXPECT_TRUE(inl.empty());
+    }
+}
+
+// 31. Bulk operations across the wrap around
+TEST(Wrap, Bulk) {
+
+    lock_free_mpmc_bounded_queue<int> q(16, SIZE_MAX - 5);
+    std::vector<int> in(20);
+    for (int i = 0; i < 20; ++i) {
+        in[i] = i;
+    }
+    for (int round = 0; round < 10; ++round) {
+        EXPECT_EQ(15u, q.push_bulk(in.begin(), in.end()));
+        EXPECT_EQ(0u, q.push_bulk(in.begin(), in.end()));
+        std::vector<int> out;
+        EXPECT_EQ(15u, q.pop_bulk(std::back_inserter(out), 20));
+        EXPECT_EQ(0u, q.pop_bulk(std::back_inserter(out), 20));
+        EXPECT_TRUE(std::equal(out.begin(), out.end(), in.begin()));
+    }
+}
+
+// 32. Multiple Producres, Multiple Consumers across the wrap around
+//    -> in the end we have all the elements that we pushed
+TEST(Wrap, MPMC) {
+
+    lock_free_mpmc_bounded_queue<int> q(64, SIZE_MAX - 1000);
+
+    std::vector<std::thread> threads;
+    int concurrency_level = 8;
+    int n = 40000;
+    for (int i = 0; i < (concurrency_level / 2); ++i) {
+        threads.emplace_back([i, &q, n, concurrency_level]() {
+            int beg = i * (n / (concurrency_level / 2));
+            int end = (i + 1) * (n / (concurrency_level / 2));
+            for (int j = beg; j < end; ++j) {
+                q.wait_push(j);
+            }
+        });
+    }
+
+    std::vector<std::atomic<bool>> values(n);
+    for (int i = 0; i < (concurrency_level / 2); ++i) {
+        threads.emplace_back([&q, n, concurrency_level, &values]() {
+            int val;
+            for (int j = 0; j < n / (concurrency_level / 2); ++j) {
+                q.wait_pop(val);
+                values[val].store(true, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_TRUE(values[i].load(std::memory_order_relaxed)) << "i= " << i << "\n";
+    }
+    EXPECT_TRUE(q.empty());
+}
+
+/*
+###############################################################################################
+
+            LAYOUT
+
+###############################################################################################
+*/
+
+// 33. Layout policies change only the alignment,
+//    not the behaviour
+TEST(Layout, PushPop) {
+
+    static_assert(alignof(lock_free_mpmc_bounded_queue<int, 16, layout_padded>) == cache_line_size, "padded");
+    static_assert(sizeof(lock_free_mpmc_bounded_queue<int, 16, layout_packed>) <
+                  sizeof(lock_free_mpmc_bounded_queue<int, 16, layout_padded>), "packed is smaller");
+    static_assert(sizeof(lock_free_mpmc_bounded_queue<int, 16, layout_padded_cells>) >=
+                  16 * cache_line_size, "a line per cell");
+
+    // One cell is always kept free
+    lock_free_mpmc_bounded_queue<std::string, 0, layout_packed> packed(8);
+    lock_free_mpmc_bounded_queue<std::string, 0, layout_padded_cells> padded(8);
+    for (int i = 0; i < 7; ++i) {
+        EXPECT_TRUE(packed.push(std::to_string(i)));
+        EXPECT_TRUE(padded.push(std::to_string(i)));
+    }
+    EXPECT_FALSE(packed.push("x"));
+    EXPECT_FALSE(padded.push("x"));
+    std::string a, b;
+    for (int i = 0; i < 7; ++i) {
+        EXPECT_TRUE(packed.try_pop(a));
+        EXPECT_TRUE(padded.try_pop(b));
+        EXPECT_EQ(std::to_string(i), a);
+        EXPECT_EQ(std::to_string(i), b);
+    }
+    EXPECT_TRUE(packed.empty());
+    EXPECT_TRUE(padded.empty());
+}
+
+// 34. Multiple Producres, Multiple Consumers
+//      with a cache line per cell
+TEST(Layout, MPMC) {
+
+    lock_free_mpmc_bounded_queue<int, 64, layout_padded_cells> q;
+
+    std::vector<std::thread> threads;
+    int n = 40000;
+    for (int i = 0; i < 2; ++i) {
+        threads.emplace_back([i, &q, n]() {
+            for (int j = i * (n / 2); j < (i + 1) * (n / 2); ++j) {
+                q.wait_push(j);
+            }
+        });
+    }
+
+    std::vector<std::atomic<bool>> values(n);
+    for (int i = 0; i < 2; ++i) {
+        threads.emplace_back([&q, n, &values]() {
+            int val;
+            for (int j = 0; j < n / 2; ++j) {
+                q.wait_pop(val);
+                values[val].store(true, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_TRUE(values[i].load(std::memory_order_relaxed)) << "i= " << i << "\n";
+    }
+    EXPECT_TRUE(q.empty());
+}
+
+/*
+###############################################################################################
+
+            OVERWRITE
+
+###############################################################################################
+*/
+
+// 35. The oldest elements are dropped, and the
+//      sequence numbers show where
+TEST(Overwrite, DropOldest) {
+
+    lock_free_mpmc_bounded_queue<int> q(8);
+    for (int i = 0; i < 20; ++i) {
+        q.push_overwrite(i);
+    }
+    // One cell is always kept free
+    EXPECT_EQ(13u, q.dropped());
+    EXPECT_FALSE(q.push(20));
+
+    int val;
+    std::size_t seq;
+    for (int i = 13; i < 20; ++i) {
+        EXPECT_TRUE(q.try_pop(val, seq));
+        EXPECT_EQ(i, val);
+        EXPECT_EQ(std::size_t(i), seq);
+    }
+    EXPECT_FALSE(q.try_pop(val, seq));
+    EXPECT_TRUE(q.empty());
+}
+
+// 36. Dropped elements are destroyed
+TEST(Overwrite, Destroyed) {
+
+    auto ptr = std::make_shared<int>(1);
+    {
+        lock_free_mpmc_bounded_queue<std::shared_ptr<int>> q(4);
+        for (int i = 0; i < 10; ++i) {
+            q.push_overwrite(ptr);
+        }
+        EXPECT_EQ(7u, q.dropped());
+        EXPECT_EQ(4, ptr.use_count());
+    }
+    EXPECT_EQ(1, ptr.use_count());
+}
+
+// 37. Producers that never wait, one slow consumer
+//    -> the sequence numbers only grow, and every element
+//          is either popped or counted as dropped
+TEST(Overwrite, MPSC) {
+
+    lock_free_mpmc_bounded_queue<int> q(64);
+    int producers = 3;
+    int n = 30000;
+    std::atomic<int> done{0};
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < producers; ++i) {
+        threads.emplace_back([i, &q, n, &done]() {
+            for (int j = 0; j < n; ++j) {
+                q.push_overwrite(i * n + j);
+            }
+            done.fetch_add(1);
+        });
+    }
+
+    std::size_t popped = 0;
+    std::size_t gaps = 0;
+    std::size_t last = 0;
+    bool first = true;
+    int val;
+    std::size_t seq;
+    while (done.load() != producers || !q.empty()) {
+        if (!q.try_pop(val, seq)) {
+            continue;
+        }
+        ASSERT_TRUE(val >= 0 && val < producers * n);
+        if (!first) {
+            ASSERT_LT(last, seq);
+            gaps += seq - last - 1;
+        } else {
+            gaps += seq;
+        }
+        first = false;
+        last = seq;
+        ++popped;
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    EXPECT_EQ(std::size_t(producers * n), popped + q.dropped());
+    EXPECT_EQ(gaps, q.dropped());
+}
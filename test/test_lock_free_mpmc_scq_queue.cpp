@@ -0,0 +1,297 @@
+#include "lock-free-mpmc-scq-queue.hpp"
+
+#include <gtest/gtest.h>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <random>
+#include <chrono>
+#include  <stdexcept>
+#include <memory>
+#include <string>
+
+/*
+1. Basic Functionality
+
+    - Elements pushed into the queue can be popped
+    in the correct order
+    - Ensure that empty returns true for new queue
+    - Push fails on a full queue, and succeeds again
+    after a pop
+    - Many wrap arounds of the rings, pops from the empty
+    queue in between
+
+2. Concurrent Access Tests
+
+    - Single Producer, Single Consumer
+        -> order of the elements is preserved
+    - Multiple Producers, Multiple Consumers
+        -> each element is consumed exactly once
+
+3. Stress Tests
+    - Many threads through a small queue, with
+    a lot of pops from the empty queue
+
+4. Exception Safety Tests
+    - Throwing constructor does not take the cell
+
+5. Lifetime
+    - Elements left in the queue are destroyed together with it
+*/
+
+// 1. Single thread, empty
+TEST(Basic, Empty) {
+    lock_free_mpmc_scq_queue<int> q(16);
+    EXPECT_TRUE(q.empty());
+    EXPECT_EQ(16u, q.capacity());
+    int val;
+    EXPECT_FALSE(q.try_pop(val));
+    EXPECT_FALSE(q.try_pop());
+}
+
+// 2. Single thread, Push and then pop
+TEST(Basic, Push_TryPop) {
+
+    lock_free_mpmc_scq_queue<int> q(16);
+
+    EXPECT_TRUE(q.push(1));
+    EXPECT_TRUE(q.emplace(2));
+    EXPECT_TRUE(q.push(3));
+    EXPECT_FALSE(q.empty());
+
+    int val;
+    EXPECT_TRUE(q.try_pop(val));
+    EXPECT_EQ(1, val);
+    auto res = q.try_pop();
+    ASSERT_TRUE(res);
+    EXPECT_EQ(2, *res);
+    EXPECT_TRUE(q.try_pop(val));
+    EXPECT_EQ(3, val);
+    EXPECT_FALSE(q.try_pop(val));
+    EXPECT_TRUE(q.empty());
+}
+
+// 3. All the n cells can be used, and no more
+TEST(Basic, Full) {
+
+    lock_free_mpmc_scq_queue<int> q(100);
+    ASSERT_EQ(128u, q.capacity());
+    for (int i = 0; i < 128; ++i) {
+        EXPECT_TRUE(q.push(i));
+    }
+    EXPECT_FALSE(q.push(128));
+
+    int val;
+    EXPECT_TRUE(q.try_pop(val));
+    EXPECT_EQ(0, val);
+    EXPECT_TRUE(q.push(128));
+    for (int i = 1; i <= 128; ++i) {
+        EXPECT_TRUE(q.try_pop(val));
+        EXPECT_EQ(i, val);
+    }
+    EXPECT_FALSE(q.try_pop(val));
+}
+
+// 4. Many wrap arounds, with pops from the
+//  empty queue in between, that move the head
+TEST(Basic, Wraps) {
+
+    lock_free_mpmc_scq_queue<int> q(8);
+    int val;
+    for (int round = 0; round < 10000; ++round) {
+        int cnt = round % 9;
+        for (int i = 0; i < cnt; ++i) {
+            EXPECT_TRUE(q.push(round + i));
+        }
+        for (int i = 0; i < cnt; ++i) {
+            EXPECT_TRUE(q.try_pop(val));
+            EXPECT_EQ(round + i, val);
+        }
+        EXPECT_FALSE(q.try_pop(val));
+        EXPECT_FALSE(q.try_pop(val));
+    }
+}
+
+// 5. Single Producer, Single Consumer
+//    -> in the end we must have all the elemens in
+//          the same order as we pushed
+TEST(Concurrent, SPSC) {
+
+    lock_free_mpmc_scq_queue<int> q(1024);
+    int n = 100000;
+
+    std::thread producer([&]() {
+        for (int i = 0; i < n; ++i) {
+            while(!q.push(i));
+        }
+    });
+
+    std::vector<int> values(n);
+    std::thread consumer([&]() {
+        for (int i = 0; i < n; ++i) {
+            while(!q.try_pop(values[i]));
+        }
+    });
+
+    producer.join();
+    consumer.join();
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_EQ(i, values[i]);
+    }
+}
+
+// 6. Multiple Producres, Multiple Consumers
+//    -> in the end we have all the elements that we pushed
+TEST(Concurrent, MPMC) {
+
+    lock_free_mpmc_scq_queue<int> q(1024);
+
+    std::vector<std::thread> threads;
+    int concurrency_level = 8;
+    int n = 80000;
+    for (int i = 0; i < (concurrency_level / 2); ++i) {
+        threads.emplace_back([i, &q, n, concurrency_level]() {
+            int beg = i * (n / (concurrency_level / 2));
+            int end = (i + 1) * (n / (concurrency_level / 2));
+            for (int j = beg; j < end; ++j) {
+                while(!q.push(j));
+            }
+        });
+    }
+
+    std::vector<std::atomic<int>> values(n);
+    for (int i = 0; i < (concurrency_level / 2); ++i) {
+        threads.emplace_back([n, &q, &values, concurrency_level]() {
+            int val;
+            for (int j = 0; j < n / (concurrency_level / 2); ++j) {
+                while(!q.try_pop(val));
+                values[val].fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    for (int i = 0; i < concurrency_level; ++i) {
+        threads[i].join();
+    }
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_EQ(1, values[i].load(std::memory_order_relaxed)) << "i= " << i << "\n";
+    }
+    EXPECT_TRUE(q.empty());
+}
+
+// 7. Many threads through a tiny queue: the queue is
+//    full and empty all the time
+TEST(Stress, SmallMPMC) {
+
+    lock_free_mpmc_scq_queue<int> q(4);
+
+    std::vector<std::thread> threads;
+    int number_of_producers = 8;
+    int number_of_consumers = 8;
+    int n = 40000;
+    for (int i = 0; i < number_of_producers; ++i) {
+        threads.emplace_back([i, &q, n, number_of_producers]() {
+            int beg = i * (n / number_of_producers);
+            int end = (i + 1) * (n / number_of_producers);
+            for (int j = beg; j < end; ++j) {
+                while(!q.push(j)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::vector<std::atomic<int>> values(n);
+    for (int i = 0; i < number_of_consumers; ++i) {
+        threads.emplace_back([n, &q, &values, number_of_consumers]() {
+            int val;
+            for (int j = 0; j < n / number_of_consumers; ++j) {
+                while(!q.try_pop(val)) {
+                    std::this_thread::yield();
+                }
+                values[val].fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_EQ(1, values[i].load(std::memory_order_relaxed)) << "i= " << i << "\n";
+    }
+}
+
+struct ExeptInt {
+
+    ExeptInt(int i, bool ex)
+    : i_(i)
+    , fail_(ex)
+    {}
+
+    ExeptInt(const ExeptInt& other)
+    : i_(other.i_), fail_(other.fail_)
+    {
+        if (fail_) {
+            throw std::runtime_error(std::to_string(i_));
+        }
+    }
+
+    ExeptInt& operator= (const ExeptInt& other) {
+
+        if (fail_) {
+            throw std::runtime_error(std::to_string(i_));
+        }
+
+        i_ = other.i_;
+        fail_ = other.fail_;
+
+        return *this;
+    }
+
+    int i_;
+    bool fail_;
+};
+
+// 8. Throwing constructor gives the cell back,
+//    throwing assignment leaves the element in the queue
+TEST(Exception, Emplace) {
+
+    lock_free_mpmc_scq_queue<ExeptInt> q(2);
+    ExeptInt bad(1, true);
+
+    EXPECT_THROW(q.push(bad), std::runtime_error);
+    EXPECT_THROW(q.emplace(bad), std::runtime_error);
+    EXPECT_TRUE(q.empty());
+    EXPECT_TRUE(q.emplace(2, false));
+    EXPECT_TRUE(q.emplace(3, false));
+    EXPECT_FALSE(q.emplace(4, false));
+
+    ExeptInt val(-1, true);
+    EXPECT_THROW(q.try_pop(val), std::runtime_error);
+    val.fail_ = false;
+    EXPECT_TRUE(q.try_pop(val));
+    EXPECT_EQ(3, val.i_);
+    EXPECT_TRUE(q.try_pop(val));
+    EXPECT_EQ(2, val.i_);
+    EXPECT_FALSE(q.try_pop(val));
+}
+
+// 9. Elements left in the queue are
+//  destroyed together with it
+TEST(Lifetime, Destroy) {
+
+    std::shared_ptr<int> ptr = std::make_shared<int>(1);
+    {
+        lock_free_mpmc_scq_queue<std::shared_ptr<int>> q(16);
+        q.push(ptr);
+        q.push(ptr);
+        q.push(ptr);
+        q.try_pop();
+        EXPECT_EQ(3, ptr.use_count());
+    }
+    EXPECT_EQ(1, ptr.use_count());
+}
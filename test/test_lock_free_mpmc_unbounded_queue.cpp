@@ -0,0 +1,269 @@
+#include "lock-free-mpmc-unbounded-queue.hpp"
+
+#include <gtest/gtest.h>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <random>
+#include <chrono>
+#include  <stdexcept>
+#include <memory>
+#include <string>
+
+/*
+1. Basic Functionality
+
+    - Elements pushed into the queue can be popped
+    in the correct order
+    - Ensure that empty returns true for new queue
+    - The queue grows over many segments and shrinks back
+
+2. Concurrent Access Tests
+
+    - Single Producer, Single Consumer
+        -> order of the elements is preserved
+    - Multiple Producers, Multiple Consumers
+        -> each element is consumed exactly once
+
+3. Stress Tests
+    - Many threads through small segments, so that
+    segments are linked and retired all the time
+
+4. Exception Safety Tests
+    - Throwing constructor does not break the queue
+
+5. Lifetime
+    - Elements left in the queue are destroyed together with it
+*/
+
+// 1. Single thread, empty
+TEST(Basic, Empty) {
+    lock_free_mpmc_unbounded_queue<int> q;
+    EXPECT_TRUE(q.empty());
+    int val;
+    EXPECT_FALSE(q.try_pop(val));
+    EXPECT_FALSE(q.try_pop());
+    EXPECT_FALSE(q.pop());
+}
+
+// 2. Single thread, Push and then pop
+TEST(Basic, Push_TryPop) {
+
+    lock_free_mpmc_unbounded_queue<int> q;
+
+    q.push(1);
+    q.emplace(2);
+    q.push(3);
+    EXPECT_FALSE(q.empty());
+
+    int val;
+    EXPECT_TRUE(q.try_pop(val));
+    EXPECT_EQ(1, val);
+    auto res = q.try_pop();
+    ASSERT_TRUE(res);
+    EXPECT_EQ(2, *res);
+    auto ptr = q.pop();
+    ASSERT_TRUE(ptr);
+    EXPECT_EQ(3, *ptr);
+    EXPECT_FALSE(q.try_pop(val));
+    EXPECT_TRUE(q.empty());
+}
+
+// 3. Much more elements than one segment holds
+TEST(Basic, Grow) {
+
+    lock_free_mpmc_unbounded_queue<int, 8> q;
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 1000; ++i) {
+            q.push(i);
+        }
+        int val;
+        for (int i = 0; i < 1000; ++i) {
+            EXPECT_TRUE(q.try_pop(val));
+            EXPECT_EQ(i, val);
+        }
+        EXPECT_FALSE(q.try_pop(val));
+        EXPECT_TRUE(q.empty());
+    }
+}
+
+// 4. Single Producer, Single Consumer
+//    -> in the end we must have all the elemens in
+//          the same order as we pushed
+TEST(Concurrent, SPSC) {
+
+    lock_free_mpmc_unbounded_queue<int, 64> q;
+    int n = 100000;
+
+    std::thread producer([&]() {
+        for (int i = 0; i < n; ++i) {
+            q.push(i);
+        }
+    });
+
+    std::vector<int> values(n);
+    std::thread consumer([&]() {
+        for (int i = 0; i < n; ++i) {
+            while(!q.try_pop(values[i]));
+        }
+    });
+
+    producer.join();
+    consumer.join();
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_EQ(i, values[i]);
+    }
+}
+
+// 5. Multiple Producres, Multiple Consumers
+//    -> in the end we have all the elements that we pushed
+TEST(Concurrent, MPMC) {
+
+    lock_free_mpmc_unbounded_queue<int> q;
+
+    std::vector<std::thread> threads;
+    int concurrency_level = 8;
+    int n = 80000;
+    for (int i = 0; i < (concurrency_level / 2); ++i) {
+        threads.emplace_back([i, &q, n, concurrency_level]() {
+            int beg = i * (n / (concurrency_level / 2));
+            int end = (i + 1) * (n / (concurrency_level / 2));
+            for (int j = beg; j < end; ++j) {
+                q.push(j);
+            }
+        });
+    }
+
+    std::vector<std::atomic<int>> values(n);
+    for (int i = 0; i < (concurrency_level / 2); ++i) {
+        threads.emplace_back([n, &q, &values, concurrency_level]() {
+            int val;
+            for (int j = 0; j < n / (concurrency_level / 2); ++j) {
+                while(!q.try_pop(val));
+                values[val].fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    for (int i = 0; i < concurrency_level; ++i) {
+        threads[i].join();
+    }
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_EQ(1, values[i].load(std::memory_order_relaxed)) << "i= " << i << "\n";
+    }
+    EXPECT_TRUE(q.empty());
+}
+
+// 6. Tiny segments: they are linked and
+//    retired all the time
+TEST(Stress, SmallSegments) {
+
+    lock_free_mpmc_unbounded_queue<int, 4> q;
+
+    std::vector<std::thread> threads;
+    int number_of_producers = 8;
+    int number_of_consumers = 8;
+    int n = 80000;
+    for (int i = 0; i < number_of_producers; ++i) {
+        threads.emplace_back([i, &q, n, number_of_producers]() {
+            int beg = i * (n / number_of_producers);
+            int end = (i + 1) * (n / number_of_producers);
+            for (int j = beg; j < end; ++j) {
+                q.push(j);
+            }
+        });
+    }
+
+    std::vector<std::atomic<int>> values(n);
+    for (int i = 0; i < number_of_consumers; ++i) {
+        threads.emplace_back([n, &q, &values, number_of_consumers]() {
+            std::unique_ptr<int> res;
+            for (int j = 0; j < n / number_of_consumers; ++j) {
+                while(!(res = q.pop()));
+                values[*res].fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_EQ(1, values[i].load(std::memory_order_relaxed)) << "i= " << i << "\n";
+    }
+}
+
+struct ExeptInt {
+
+    ExeptInt(int i, bool ex)
+    : i_(i)
+    , fail_(ex)
+    {}
+
+    ExeptInt(const ExeptInt& other)
+    : i_(other.i_), fail_(other.fail_)
+    {
+        if (fail_) {
+            throw std::runtime_error(std::to_string(i_));
+        }
+    }
+
+    ExeptInt& operator= (const ExeptInt& other) {
+
+        if (fail_) {
+            throw std::runtime_error(std::to_string(i_));
+        }
+
+        i_ = other.i_;
+        fail_ = other.fail_;
+
+        return *this;
+    }
+
+    int i_;
+    bool fail_;
+};
+
+// 7. Throwing constructor: the taken cell is skipped
+//    by the popper, the rest of the elements are there
+TEST(Exception, Emplace) {
+
+    lock_free_mpmc_unbounded_queue<ExeptInt, 2> q;
+    ExeptInt bad(1, true);
+
+    q.emplace(0, false);
+    EXPECT_THROW(q.emplace(bad), std::runtime_error);
+    q.emplace(2, false);
+    EXPECT_THROW(q.emplace(bad), std::runtime_error);
+    q.emplace(4, false);
+
+    ExeptInt val(-1, false);
+    EXPECT_TRUE(q.try_pop(val));
+    EXPECT_EQ(0, val.i_);
+    EXPECT_TRUE(q.try_pop(val));
+    EXPECT_EQ(2, val.i_);
+    EXPECT_TRUE(q.try_pop(val));
+    EXPECT_EQ(4, val.i_);
+    EXPECT_FALSE(q.try_pop(val));
+}
+
+// 8. Elements left in the queue are
+//  destroyed together with it
+TEST(Lifetime, Destroy) {
+
+    std::shared_ptr<int> ptr = std::make_shared<int>(1);
+    {
+        lock_free_mpmc_unbounded_queue<std::shared_ptr<int>, 4> q;
+        for (int i = 0; i < 10; ++i) {
+            q.push(ptr);
+        }
+        for (int i = 0; i < 5; ++i) {
+            q.try_pop();
+        }
+        EXPECT_EQ(6, ptr.use_count());
+    }
+    EXPECT_EQ(1, ptr.use_count());
+}
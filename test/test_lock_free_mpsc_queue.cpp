@@ -8,6 +8,9 @@
 #include <random>
 #include <chrono>
 #include  <stdexcept>
+#include <atomic>
+#include <memory>
+#include <utility>
 
 /*
 
@@ -17,6 +20,7 @@
     in the correct order
     - Ensure that empty returns true for new queue
     - Try successful/uncuccessful try_pop operations
+    - Elements left in the queue are destroyed with it
 
 2. Concurrent Access Tests
 
@@ -39,6 +43,15 @@
 4. Exception Safety Tests
     - Simulate exeptions during push or pop operations to ensure that
     the queue remains in a consistent state and no deadlock happens
+
+5. Drain
+    - Everything that has arrived comes in one call, in order
+    - Multiple producers, the consumer only drains
+
+6. Intrusive queue
+    - The caller's objects come back in order, also after
+    the queue has been drained (stub pushed back)
+    - Multiple producers, every object comes back once
 */
 
 // 1. Single thread, empty
@@ -75,7 +88,28 @@ TEST(Basic, Unsussesful_Pop) {
     EXPECT_FALSE(q.pop());
 }
 
-// // 4. Single Producer, Single Consumer
+// 4. Single thread, try_pop into the value, and
+//  the elements left are destroyed with the queue
+TEST(Basic, TryPop_Destroy) {
+
+    auto ptr = std::make_shared<int>(7);
+    {
+        lock_free_mpsc_queue<std::shared_ptr<int>> q;
+        std::shared_ptr<int> val;
+        EXPECT_FALSE(q.try_pop(val));
+        q.push(ptr);
+        q.push(ptr);
+        q.push(ptr);
+        EXPECT_TRUE(q.try_pop(val));
+        EXPECT_EQ(7, *val);
+        EXPECT_FALSE(q.empty());
+        val.reset();
+        EXPECT_EQ(3, ptr.use_count());
+    }
+    EXPECT_EQ(1, ptr.use_count());
+}
+
+// // 5. Single Producer, Single Consumer
 // //    -> in the end we must have all the elemens in
 // //          the same order as we pushed
 TEST(Concurrent, SPSC) {
@@ -107,7 +141,7 @@ TEST(Concurrent, SPSC) {
     }
 }
 
-// // 5. Single Producer, Multiple Consumers
+// // 6. Single Producer, Multiple Consumers
 // //    -> in the end we must have all the elements
 
 // TEST(Concurrent, SPMC) {
@@ -179,6 +213,41 @@ TEST(Concurrent, MPSC) {
     }
 }
 
+// 8. Multiple Producers, Single Consumer
+//    -> the elements of every producer come in the order it pushed them
+
+TEST(Concurrent, MPSC_Order) {
+
+    lock_free_mpsc_queue<std::pair<int, int>> q;
+    std::vector<std::thread> threads;
+    int producers = 8;
+    int n = 100'000;
+    for (int i = 0; i < producers; ++i) {
+        threads.emplace_back([i, &q, n]() {
+            for (int j = 0; j < n; ++j) {
+                q.push({i, j});
+            }
+        });
+    }
+
+    std::vector<int> next(producers, 0);
+    bool ok = true;
+    std::pair<int, int> val;
+    for (int j = 0; j < producers * n; ++j) {
+        while (!q.try_pop(val)) {
+            std::this_thread::yield();
+        }
+        ok = ok && (val.second == next[val.first]);
+        ++next[val.first];
+    }
+    EXPECT_TRUE(q.empty());
+
+    for (auto& t : threads) {
+        t.join();
+    }
+    EXPECT_TRUE(ok);
+}
+
 // 11. Exception handelling
 //    -> Create a type, which in copy/move assignment/operator
 //      throws exeptions with probability 1/6
@@ -236,47 +305,50 @@ struct ExeptInt {
     bool fail_;
 };
 
-TEST(Exception, MPMC) {
+TEST(Exception, MPSC) {
 
     lock_free_mpsc_queue<ExeptInt> q;
     std::vector<std::thread> threads;
     int concurrency_level = 9;
     int n = 8000;
-    threads.emplace_back([&q, n]() {
-        
-        std::mt19937 gen(std::random_device{}());
-        std::uniform_int_distribution<int> dist(1, 6);
-        for (int j = 0; j < n; ++j) {
-            ExeptInt num(j, dist(gen) / 6);
-            try {
-                q.push(num);
-            } catch (const std::exception& e) {
-                ExeptInt num2(j, false);
-                q.push(num2);
-            }
-        }
-    });
-
-    std::vector<std::atomic<bool>> values(n);
     for (int i = 0; i < (concurrency_level - 1); ++i) {
-        threads.emplace_back([n, &q, &values, &concurrency_level]() {
+        threads.emplace_back([i, &q, n, &concurrency_level]() {
             std::mt19937 gen(std::random_device{}());
             std::uniform_int_distribution<int> dist(1, 6);
-            for (int j = 0; j < n / (concurrency_level - 1); ++j) {
-                ExeptInt val(0, dist(gen) / 6);
+            int beg = i * (n / (concurrency_level - 1));
+            int end = (i + 1) * (n / (concurrency_level - 1));
+            for (int j = beg; j < end; ++j) {
+                ExeptInt num(j, dist(gen) / 6);
                 try {
-                    std::unique_ptr<ExeptInt> res;
-                    while((res = q.pop()) == nullptr);
-                    values[res->i_].store(true, std::memory_order_relaxed);
+                    q.push(num);
                 } catch (const std::exception& e) {
-                    std::unique_ptr<ExeptInt> res2;
-                    while((res2 = q.pop()) == nullptr);
-                    values[res2->i_].store(true, std::memory_order_relaxed);
+                    ExeptInt num2(j, false);
+                    q.push(num2);
                 }
             }
         });
     }
 
+    std::vector<std::atomic<bool>> values(n);
+    threads.emplace_back([n, &q, &values]() {
+        std::mt19937 gen(std::random_device{}());
+        std::uniform_int_distribution<int> dist(1, 6);
+        for (int j = 0; j < n; ++j) {
+            // The assignment into val throws, if it fails
+            ExeptInt val(0, dist(gen) / 6);
+            try {
+                while(!q.try_pop(val)) {
+                    std::this_thread::yield();
+                }
+                values[val.i_].store(true, std::memory_order_relaxed);
+            } catch (const std::exception& e) {
+                std::unique_ptr<ExeptInt> res;
+                while((res = q.pop()) == nullptr);
+                values[res->i_].store(true, std::memory_order_relaxed);
+            }
+        }
+    });
+
     for (int i = 0; i < concurrency_level; ++i) {
         threads[i].join();
     }
@@ -285,3 +357,135 @@ TEST(Exception, MPMC) {
         EXPECT_TRUE(values[i].load(std::memory_order_relaxed)) << "i= " << i << "\n";
     }
 }
+
+struct Item : intrusive_hook {
+    int val_;
+};
+
+// 12. Intrusive, single thread
+TEST(Intrusive, PushPop) {
+
+    lock_free_intrusive_mpsc_queue<Item> q;
+    std::vector<Item> items(4);
+    EXPECT_TRUE(q.empty());
+    EXPECT_EQ(nullptr, q.pop());
+
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 4; ++i) {
+            items[i].val_ = round * 4 + i;
+            q.push(&items[i]);
+        }
+        EXPECT_FALSE(q.empty());
+        for (int i = 0; i < 4; ++i) {
+            Item* res = q.pop();
+            ASSERT_EQ(&items[i], res);
+            EXPECT_EQ(round * 4 + i, res->val_);
+        }
+        EXPECT_EQ(nullptr, q.pop());
+        EXPECT_TRUE(q.empty());
+    }
+}
+
+// 13. Intrusive, multiple producers push their own objects,
+//      the consumer gives them back to be pushed again
+//    -> every push comes out exactly once
+TEST(Intrusive, MPSC) {
+
+    lock_free_intrusive_mpsc_queue<Item> q;
+    int producers = 8;
+    int n = 50'000;
+    std::vector<Item> items(producers * n);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < producers; ++i) {
+        threads.emplace_back([i, n, &q, &items]() {
+            for (int j = i * n; j < (i + 1) * n; ++j) {
+                items[j].val_ = j;
+                q.push(&items[j]);
+            }
+        });
+    }
+
+    std::vector<int> seen(producers * n);
+    for (int j = 0; j < producers * n; ++j) {
+        Item* res;
+        while ((res = q.pop()) == nullptr) {
+            std::this_thread::yield();
+        }
+        ++seen[res->val_];
+    }
+    EXPECT_EQ(nullptr, q.pop());
+
+    for (auto& t : threads) {
+        t.join();
+    }
+    for (int i = 0; i < producers * n; ++i) {
+        EXPECT_EQ(1, seen[i]) << "i= " << i << "\n";
+    }
+}
+
+// 14. Drain takes everything in FIFO order, an exception
+//      leaves the element in the queue
+TEST(Drain, Basic) {
+
+    lock_free_mpsc_queue<int> q;
+    EXPECT_EQ(0u, q.drain([](int&) {}));
+    for (int i = 0; i < 5; ++i) {
+        q.push(i);
+    }
+
+    std::vector<int> out;
+    EXPECT_THROW(q.drain([&out](int& v) {
+        if (v == 3) {
+            throw std::runtime_error("");
+        }
+        out.push_back(v);
+    }), std::runtime_error);
+    EXPECT_EQ(2u, q.drain([&out](int& v) { out.push_back(v); }));
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4}), out);
+    EXPECT_TRUE(q.empty());
+
+    lock_free_intrusive_mpsc_queue<Item> iq;
+    std::vector<Item> items(3);
+    for (auto& item : items) {
+        iq.push(&item);
+    }
+    std::vector<Item*> got;
+    EXPECT_EQ(3u, iq.drain([&got](Item* item) { got.push_back(item); }));
+    EXPECT_EQ((std::vector<Item*>{&items[0], &items[1], &items[2]}), got);
+}
+
+// 15. Multiple producers, the consumer drains in bursts
+//    -> every element once, in order per producer
+TEST(Drain, MPSC) {
+
+    lock_free_mpsc_queue<std::pair<int, int>> q;
+    std::vector<std::thread> threads;
+    int producers = 8;
+    int n = 50'000;
+    for (int i = 0; i < producers; ++i) {
+        threads.emplace_back([i, &q, n]() {
+            for (int j = 0; j < n; ++j) {
+                q.push({i, j});
+            }
+        });
+    }
+
+    std::vector<int> next(producers, 0);
+    bool ok = true;
+    int count = 0;
+    while (count < producers * n) {
+        std::size_t got = q.drain([&](std::pair<int, int>& val) {
+            ok = ok && (val.second == next[val.first]);
+            ++next[val.first];
+        });
+        count += got;
+        if (got == 0) {
+            std::this_thread::yield();
+        }
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    EXPECT_TRUE(ok);
+    EXPECT_TRUE(q.empty());
+}
@@ -0,0 +1,205 @@
+#include "lock-free-multicast-ring.hpp"
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+
+1. Basic Functionality
+
+    - Every consumer reads every element, in order
+    - The producer is stopped by the slowest consumer
+    - A dependent consumer does not pass its dependencies
+    - Values are destroyed when their cells are reused
+
+2. Concurrent Access Tests
+
+    - One producer, three consumers in a chain and in parallel
+    - Several producers, every consumer gets every element once
+
+*/
+
+// 1. Every consumer sees all the elements
+TEST(Basic, Multicast) {
+
+    lock_free_multicast_ring<int> ring(8);
+    std::size_t a = ring.add_consumer();
+    std::size_t b = ring.add_consumer();
+
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_TRUE(ring.push(i));
+    }
+    int val;
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_TRUE(ring.try_read(a, val));
+        EXPECT_EQ(i, val);
+    }
+    EXPECT_FALSE(ring.try_read(a, val));
+
+    std::vector<int> out;
+    EXPECT_EQ(5u, ring.read_bulk(b, [&out](const int& v) { out.push_back(v); }, 100));
+    EXPECT_EQ(0u, ring.read_bulk(b, [&out](const int& v) { out.push_back(v); }, 100));
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4}), out);
+}
+
+// 2. The slowest consumer gates the producer
+TEST(Basic, Gating) {
+
+    lock_free_multicast_ring<int> ring(4);
+    std::size_t fast = ring.add_consumer();
+    std::size_t slow = ring.add_consumer();
+
+    int val;
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(ring.push(i));
+        EXPECT_TRUE(ring.try_read(fast, val));
+    }
+    EXPECT_FALSE(ring.push(4));
+    EXPECT_TRUE(ring.try_read(slow, val));
+    EXPECT_EQ(0, val);
+    EXPECT_TRUE(ring.push(4));
+    EXPECT_FALSE(ring.push(5));
+}
+
+// 3. Dependent consumer waits for its dependency,
+//      and only it gates the producer
+TEST(Basic, Dependencies) {
+
+    lock_free_multicast_ring<int> ring(4);
+    std::size_t journal = ring.add_consumer();
+    std::size_t risk = ring.add_consumer({journal});
+    EXPECT_THROW(ring.add_consumer({5}), std::invalid_argument);
+
+    int val;
+    EXPECT_TRUE(ring.push(1));
+    EXPECT_FALSE(ring.try_read(risk, val));
+    EXPECT_TRUE(ring.try_read(journal, val));
+    EXPECT_TRUE(ring.try_read(risk, val));
+    EXPECT_EQ(1, val);
+    EXPECT_FALSE(ring.try_read(risk, val));
+}
+
+// 4. The values stay until the cell is reused, and
+//      are destroyed with the ring
+TEST(Basic, Lifetime) {
+
+    auto ptr = std::make_shared<int>(1);
+    {
+        lock_free_multicast_ring<std::shared_ptr<int>> ring(2);
+        std::size_t c = ring.add_consumer();
+        std::shared_ptr<int> val;
+        for (int i = 0; i < 6; ++i) {
+            EXPECT_TRUE(ring.push(ptr));
+            EXPECT_TRUE(ring.try_read(c, val));
+        }
+        val.reset();
+        EXPECT_EQ(3, ptr.use_count());
+    }
+    EXPECT_EQ(1, ptr.use_count());
+}
+
+// 5. Single producer, a journaler, and a risk checker
+//      and a strategy after it
+//    -> everybody sees all the elements in order, and the
+//          dependent ones see them journaled already
+TEST(Concurrent, Pipeline) {
+
+    lock_free_multicast_ring<int> ring(64);
+    std::size_t journal = ring.add_consumer();
+    std::size_t risk = ring.add_consumer({journal});
+    std::size_t strategy = ring.add_consumer({journal});
+
+    int n = 100000;
+    std::vector<std::atomic<bool>> journaled(n);
+
+    std::thread producer([&]() {
+        for (int i = 0; i < n; ++i) {
+            while (!ring.push(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    auto consume = [&](std::size_t id, bool journaler, bool& ok) {
+        int expected = 0;
+        while (expected < n) {
+            std::size_t got = ring.read_bulk(id, [&](const int& v) {
+                ok = ok && (v == expected);
+                if (journaler) {
+                    journaled[v].store(true, std::memory_order_relaxed);
+                } else {
+                    ok = ok && journaled[v].load(std::memory_order_relaxed);
+                }
+                ++expected;
+            }, 16);
+            if (got == 0) {
+                std::this_thread::yield();
+            }
+        }
+    };
+
+    bool ok_journal = true, ok_risk = true, ok_strategy = true;
+    std::thread t1([&]() { consume(journal, true, ok_journal); });
+    std::thread t2([&]() { consume(risk, false, ok_risk); });
+    std::thread t3([&]() { consume(strategy, false, ok_strategy); });
+
+    producer.join();
+    t1.join();
+    t2.join();
+    t3.join();
+
+    EXPECT_TRUE(ok_journal);
+    EXPECT_TRUE(ok_risk);
+    EXPECT_TRUE(ok_strategy);
+}
+
+// 6. Multiple producers, two consumers
+//    -> every consumer gets every element exactly once
+TEST(Concurrent, MultiProducer) {
+
+    lock_free_multicast_ring<int, true> ring(64);
+    std::size_t a = ring.add_consumer();
+    std::size_t b = ring.add_consumer();
+
+    int producers = 3;
+    int n = 20000;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < producers; ++i) {
+        threads.emplace_back([i, n, &ring]() {
+            for (int j = i * n; j < (i + 1) * n; ++j) {
+                while (!ring.push(j)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::vector<int> seen_a(producers * n), seen_b(producers * n);
+    auto consume = [&](std::size_t id, std::vector<int>& seen) {
+        int count = 0;
+        int val;
+        while (count < producers * n) {
+            if (ring.try_read(id, val)) {
+                ++seen[val];
+                ++count;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    };
+    threads.emplace_back([&]() { consume(a, seen_a); });
+    threads.emplace_back([&]() { consume(b, seen_b); });
+
+    for (auto& t : threads) {
+        t.join();
+    }
+    for (int i = 0; i < producers * n; ++i) {
+        EXPECT_EQ(1, seen_a[i]) << "i= " << i << "\n";
+        EXPECT_EQ(1, seen_b[i]) << "i= " << i << "\n";
+    }
+}
@@ -0,0 +1,225 @@
+#include "lock-free-shm-queue.hpp"
+
+#include <gtest/gtest.h>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <string>
+#include <system_error>
+#include <stdexcept>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*
+
+1. Basic Functionality
+
+    - Elements pushed into the queue can be popped
+    in the correct order
+    - Push fails on a full queue
+    - The queue attached by the name sees the same elements
+    - Attach to a missing segment, or to the segment of
+    another type throws
+
+2. Concurrent Access Tests (processes)
+
+    - Single Producer and Single Consumer in different processes
+        -> order of the elements is preserved
+    - Multiple Producers processes, one consumer process
+        -> each element is consumed exactly once
+
+3. Stress Tests
+    - Multiple producer and consumer threads on the MPMC queue
+*/
+
+struct Msg {
+    int  producer_;
+    long seq_;
+};
+
+static std::string shm_name(const char* what) {
+    return std::string("/lock_free_test_") + what + "_" + std::to_string(::getpid());
+}
+
+// Waits for the child and checks that it exited with 0
+static void join(pid_t pid) {
+    int status = 0;
+    ASSERT_EQ(pid, ::waitpid(pid, &status, 0));
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(0, WEXITSTATUS(status));
+}
+
+// 1. Single process, push and pop
+TEST(Basic, SPSC) {
+
+    lock_free_shm_spsc_queue<int> q(shm_name("spsc"), 4);
+    EXPECT_TRUE(q.empty());
+    EXPECT_EQ(4u, q.capacity());
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(q.push(i));
+    }
+    EXPECT_FALSE(q.push(4));
+
+    int val;
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(q.pop(val));
+        EXPECT_EQ(i, val);
+    }
+    EXPECT_FALSE(q.pop(val));
+    EXPECT_TRUE(q.empty());
+}
+
+// 2. Single process, push and pop
+TEST(Basic, MPMC) {
+
+    lock_free_shm_mpmc_queue<Msg> q(shm_name("mpmc"), 3);
+    EXPECT_EQ(4u, q.capacity());
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(q.push(Msg{0, i}));
+    }
+    EXPECT_FALSE(q.push(Msg{0, 4}));
+
+    Msg val;
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(q.pop(val));
+        EXPECT_EQ(i, val.seq_);
+    }
+    EXPECT_FALSE(q.pop(val));
+    EXPECT_TRUE(q.empty());
+}
+
+// 3. The second mapping of the same segment
+//  sees what the first one pushed
+TEST(Basic, Attach) {
+
+    std::string name = shm_name("attach");
+    lock_free_shm_spsc_queue<int> q(name, 16);
+    lock_free_shm_spsc_queue<int> other(name);
+    EXPECT_EQ(16u, other.capacity());
+
+    q.push(1);
+    q.push(2);
+    int val;
+    EXPECT_TRUE(other.pop(val));
+    EXPECT_EQ(1, val);
+    EXPECT_TRUE(other.pop(val));
+    EXPECT_EQ(2, val);
+    EXPECT_TRUE(q.empty());
+}
+
+// 4. Errors of creation and attach
+TEST(Basic, Errors) {
+
+    std::string name = shm_name("errors");
+    EXPECT_THROW(lock_free_shm_spsc_queue<int>{name}, std::system_error);
+
+    lock_free_shm_spsc_queue<int> q(name, 16);
+    EXPECT_THROW((lock_free_shm_spsc_queue<int>{name, 16}), std::system_error);
+    EXPECT_THROW(lock_free_shm_spsc_queue<Msg>{name}, std::runtime_error);
+    EXPECT_THROW(lock_free_shm_mpmc_queue<int>{name}, std::runtime_error);
+}
+
+// 5. Single Producer, Single Consumer in different processes
+//    -> in the end we must have all the elemens in
+//          the same order as we pushed
+TEST(Concurrent, SPSC) {
+
+    std::string name = shm_name("fork_spsc");
+    lock_free_shm_spsc_queue<long> q(name, 1024);
+    long n = 200000;
+
+    pid_t pid = ::fork();
+    ASSERT_NE(-1, pid);
+    if (pid == 0) {
+        // The child maps the segment by itself,
+        // possibly at another address
+        lock_free_shm_spsc_queue<long> producer(name);
+        for (long i = 0; i < n; ++i) {
+            while (!producer.push(i));
+        }
+        ::_exit(0);
+    }
+
+    long val;
+    bool ordered = true;
+    for (long i = 0; i < n; ++i) {
+        while (!q.pop(val));
+        ordered = ordered && (val == i);
+    }
+    EXPECT_TRUE(ordered);
+    join(pid);
+}
+
+// 6. Multiple producer processes, one consumer
+//    -> every element of every producer is consumed once,
+//          and in the order of this producer
+TEST(Concurrent, MPMC) {
+
+    std::string name = shm_name("fork_mpmc");
+    lock_free_shm_mpmc_queue<Msg> q(name, 1024);
+    int producers = 4;
+    long n = 200000;
+
+    std::vector<pid_t> pids;
+    for (int p = 0; p < producers; ++p) {
+        pid_t pid = ::fork();
+        ASSERT_NE(-1, pid);
+        if (pid == 0) {
+            lock_free_shm_mpmc_queue<Msg> producer(name);
+            for (long i = 0; i < n; ++i) {
+                while (!producer.push(Msg{p, i}));
+            }
+            ::_exit(0);
+        }
+        pids.push_back(pid);
+    }
+
+    std::vector<long> next(producers, 0);
+    bool ordered = true;
+    Msg val;
+    for (long i = 0; i < n * producers; ++i) {
+        while (!q.pop(val));
+        ordered = ordered && (val.seq_ == next[val.producer_]);
+        ++next[val.producer_];
+    }
+    EXPECT_TRUE(ordered);
+    for (int p = 0; p < producers; ++p) {
+        EXPECT_EQ(n, next[p]);
+        join(pids[p]);
+    }
+    EXPECT_TRUE(q.empty());
+}
+
+// 7. Multiple producer and consumer threads
+//    -> the sum of the popped elements is the sum of the pushed ones
+TEST(Stress, MPMC) {
+
+    lock_free_shm_mpmc_queue<long> q(shm_name("stress"), 64);
+    int threads = 4;
+    long n = 20000;
+    std::atomic<long> sum{0};
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&]() {
+            for (long i = 1; i <= n; ++i) {
+                while (!q.push(i));
+            }
+        });
+        workers.emplace_back([&]() {
+            long val;
+            long local = 0;
+            for (long i = 0; i < n; ++i) {
+                while (!q.pop(val));
+                local += val;
+            }
+            sum += local;
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+    EXPECT_EQ(threads * n * (n + 1) / 2, sum.load());
+    EXPECT_TRUE(q.empty());
+}
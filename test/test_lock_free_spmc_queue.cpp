@@ -9,6 +9,7 @@
 #include <chrono>
 #include  <stdexcept>
 #include <memory>
+#include <cstdint>
 
 /*
 1. Basic Functionality
@@ -32,6 +33,11 @@
 4. Exception Safety Tests
     - Simulate exeptions during push or pop operations to ensure that
     the queue remains in a consistent state and no deadlock happens
+
+5. Counted pointer
+    - Polls of the empty queue do not overflow the counter
+    - With cmpxchg16b (test_lock_free_spmc_queue_dwcas) the counter
+    has the whole second word
 */
 
 // // 1. Single thread, empty
@@ -395,3 +401,116 @@ TEST(Exception, SPMC_PTR) {
 }
 
 
+
+// 11. Pointer and counter share one word, and
+//      the queue does not need the libatomic lock
+TEST(LockFree, CountedPtr) {
+
+    int x = 0;
+    int y = 0;
+    atomic_counted_ptr<int> cell(counted_ptr<int>(&x, 2));
+    EXPECT_EQ(&x, cell.load().ptr());
+    EXPECT_EQ(2, cell.load().count());
+
+    // Both the pointer and the counter are compared
+    counted_ptr<int> expected(&x, 1);
+    EXPECT_FALSE(cell.compare_exchange_strong(expected, counted_ptr<int>(&y, 3)));
+    EXPECT_EQ(&x, expected.ptr());
+    EXPECT_EQ(2, expected.count());
+    EXPECT_TRUE(cell.compare_exchange_strong(expected, counted_ptr<int>(&y, atomic_counted_ptr<int>::MAX_COUNT)));
+    EXPECT_EQ(&y, cell.load().ptr());
+    EXPECT_EQ(atomic_counted_ptr<int>::MAX_COUNT, cell.load().count());
+
+    counted_ptr<int> old = cell.exchange(counted_ptr<int>(nullptr, 0));
+    EXPECT_EQ(&y, old.ptr());
+    EXPECT_EQ(nullptr, cell.load().ptr());
+    EXPECT_TRUE(cell.is_lock_free());
+    RecordProperty("dwcas", atomic_counted_ptr<int>::uses_dwcas() ? "yes" : "no");
+
+    lock_free_spmc_queue<int> q;
+    EXPECT_TRUE(q.extern_is_lock_free());
+}
+
+// 12. Idle consumer polls the empty queue many more times than
+//      the 16 bits of the counter, then the queue still works
+//      and every element is freed
+struct Tracked {
+
+    Tracked(int v)
+    : v_(v)
+    {
+        ++alive;
+    }
+
+    Tracked(const Tracked& other)
+    : v_(other.v_)
+    {
+        ++alive;
+    }
+
+    ~Tracked() {
+        --alive;
+    }
+
+    int v_;
+    static inline std::atomic<int> alive{0};
+};
+
+TEST(LockFree, PollEmpty) {
+
+    {
+        lock_free_spmc_queue<Tracked> q;
+        q.push(Tracked(1));
+        EXPECT_EQ(1, q.pop()->v_);
+        for (int i = 0; i < 100000; ++i) {
+            EXPECT_FALSE(q.pop());
+            EXPECT_TRUE(q.empty());
+        }
+        q.push(Tracked(2));
+        EXPECT_FALSE(q.empty());
+        q.push(Tracked(3));
+        EXPECT_EQ(2, q.pop()->v_);
+        EXPECT_EQ(3, q.pop()->v_);
+        EXPECT_FALSE(q.pop());
+        q.push(Tracked(4));
+    }
+    EXPECT_EQ(0, Tracked::alive.load());
+}
+
+// 13. The counter gets the low bits of the aligned pointers
+struct alignas(64) Line {
+    char c_[64];
+};
+
+TEST(LockFree, CountedPtrLowBits) {
+
+    static_assert(!counted_ptr_packed || atomic_counted_ptr<Line>::MAX_COUNT == (1 << 22) - 1,
+                  "6 low bits for the 64 byte alignment");
+    Line lines[2];
+    atomic_counted_ptr<Line> cell(counted_ptr<Line>(&lines[1], atomic_counted_ptr<Line>::MAX_COUNT));
+    EXPECT_EQ(&lines[1], cell.load().ptr());
+    EXPECT_EQ(atomic_counted_ptr<Line>::MAX_COUNT, cell.load().count());
+    cell.store(counted_ptr<Line>(&lines[0], 1));
+    EXPECT_EQ(&lines[0], cell.load().ptr());
+    EXPECT_EQ(1, cell.load().count());
+}
+
+// 14. With COUNTED_PTR_DWCAS and cmpxchg16b the counter
+//     is not limited by the packed word
+TEST(LockFree, CountedPtrDwcas) {
+
+    if (!atomic_counted_ptr<Line>::uses_dwcas()) {
+        EXPECT_EQ(atomic_counted_ptr<Line>::MAX_COUNT, atomic_counted_ptr<Line>::max_count());
+        return;
+    }
+    EXPECT_EQ(INT64_MAX, atomic_counted_ptr<Line>::max_count());
+    Line lines[2];
+    std::int64_t const big = std::int64_t(1) << 40;
+    atomic_counted_ptr<Line> cell(counted_ptr<Line>(&lines[1], big));
+    EXPECT_EQ(&lines[1], cell.load().ptr());
+    EXPECT_EQ(big, cell.load().count());
+    counted_ptr<Line> expected(&lines[1], big);
+    EXPECT_TRUE(cell.compare_exchange_strong(expected, counted_ptr<Line>(&lines[0], INT64_MAX)));
+    EXPECT_EQ(&lines[0], cell.load().ptr());
+    EXPECT_EQ(INT64_MAX, cell.load().count());
+}
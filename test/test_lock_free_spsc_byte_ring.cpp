@@ -0,0 +1,214 @@
+#include "lock-free-spsc-byte-ring.hpp"
+
+#include <gtest/gtest.h>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstring>
+
+/*
+
+1. Basic Functionality
+
+    - Records written with reserve/commit can be read
+    with peek/release in the correct order
+    - Ensure that empty returns true for new ring
+    - Nothing is visible before commit
+    - Reserve fails when there is not enough space, and succeeds
+    again after a release
+    - Commit without a reservation (none, committed already,
+    or failed reserve) and commit of more than reserved do nothing
+    - Records that do not fit before the end of the buffer
+    are moved to the beginning
+
+2. Concurrent Access Tests
+
+    - Single Producer and Single Consumer
+        -> order and contents of the records are preserved
+*/
+
+static void write(lock_free_spsc_byte_ring& r, std::string_view s) {
+    char* ptr;
+    while (!(ptr = r.reserve(s.size())));
+    std::memcpy(ptr, s.data(), s.size());
+    r.commit();
+}
+
+static std::string read(lock_free_spsc_byte_ring& r) {
+    std::string_view v;
+    while (!(v = r.peek()).data());
+    std::string res(v);
+    r.release();
+    return res;
+}
+
+// 1. Single thread, empty
+TEST(Basic, Empty) {
+    lock_free_spsc_byte_ring r(64);
+    EXPECT_TRUE(r.empty());
+    EXPECT_EQ(64u, r.capacity());
+    EXPECT_EQ(nullptr, r.peek().data());
+}
+
+// 2. Size is rounded up to the power of 2
+TEST(Basic, Capacity) {
+    lock_free_spsc_byte_ring r(100);
+    EXPECT_EQ(128u, r.capacity());
+}
+
+// 3. Single thread, write and then read
+TEST(Basic, CommitPeek) {
+
+    lock_free_spsc_byte_ring r(256);
+    write(r, "first");
+    write(r, "");
+    write(r, "the third one");
+    EXPECT_FALSE(r.empty());
+
+    EXPECT_EQ("first", read(r));
+    std::string_view v = r.peek();
+    EXPECT_NE(nullptr, v.data());
+    EXPECT_EQ(0u, v.size());
+    r.release();
+    EXPECT_EQ("the third one", read(r));
+    EXPECT_TRUE(r.empty());
+}
+
+// 4. Reserved, but not commited record is not visible,
+//  commit(n) shrinks the record
+TEST(Basic, Reserve) {
+
+    lock_free_spsc_byte_ring r(256);
+    char* ptr = r.reserve(100);
+    ASSERT_NE(nullptr, ptr);
+    EXPECT_TRUE(r.empty());
+    EXPECT_EQ(nullptr, r.peek().data());
+
+    std::memcpy(ptr, "abc", 3);
+    r.commit(3);
+    EXPECT_EQ("abc", read(r));
+}
+
+// 5. Reserve fails on a full ring, and succeeds
+//  after a release
+TEST(Basic, Full) {
+
+    lock_free_spsc_byte_ring r(64);
+    // 8 bytes of header + 24 bytes of payload
+    ASSERT_NE(nullptr, r.reserve(24));
+    r.commit();
+    ASSERT_NE(nullptr, r.reserve(24));
+    r.commit();
+    EXPECT_EQ(nullptr, r.reserve(1));
+    EXPECT_EQ(nullptr, r.reserve(100));
+
+    r.peek();
+    r.release();
+    EXPECT_NE(nullptr, r.reserve(1));
+}
+
+// 6. Commit without a reservation does nothing: before the first
+//  reserve, the second commit, and after a failed reserve
+TEST(Basic, CommitNoReservation) {
+
+    lock_free_spsc_byte_ring r(64);
+    EXPECT_FALSE(r.commit());
+    EXPECT_TRUE(r.empty());
+
+    char* ptr = r.reserve(3);
+    ASSERT_NE(nullptr, ptr);
+    std::memcpy(ptr, "abc", 3);
+    EXPECT_TRUE(r.commit());
+    EXPECT_FALSE(r.commit());
+    EXPECT_FALSE(r.commit(1));
+
+    ASSERT_NE(nullptr, r.reserve(5));
+    EXPECT_EQ(nullptr, r.reserve(100));
+    EXPECT_FALSE(r.commit());
+
+    EXPECT_EQ("abc", read(r));
+    EXPECT_TRUE(r.empty());
+}
+
+// 7. Commit of more bytes than reserved does nothing,
+//  the reservation stays
+TEST(Basic, CommitTooLong) {
+
+    lock_free_spsc_byte_ring r(256);
+    char* ptr = r.reserve(3);
+    ASSERT_NE(nullptr, ptr);
+    EXPECT_FALSE(r.commit(100));
+    EXPECT_TRUE(r.empty());
+
+    std::memcpy(ptr, "abc", 3);
+    EXPECT_TRUE(r.commit(3));
+    EXPECT_EQ("abc", read(r));
+    EXPECT_TRUE(r.empty());
+}
+
+// 8. Record that does not fit before the end
+//  of the buffer goes to the beginning
+TEST(Basic, Wrap) {
+
+    lock_free_spsc_byte_ring r(64);
+    write(r, std::string(20, 'a'));     // takes [0, 32)
+    write(r, std::string(10, 'b'));     // takes [32, 56)
+    EXPECT_EQ(std::string(20, 'a'), read(r));
+    // 8 bytes are left before the end: not enough
+    // for 10 bytes, and the beginning is free
+    write(r, std::string(10, 'c'));
+    EXPECT_EQ(std::string(10, 'b'), read(r));
+    EXPECT_EQ(std::string(10, 'c'), read(r));
+    EXPECT_TRUE(r.empty());
+
+    // [24, 48) is busy and 40 bytes are free, but the record
+    // of 40 bytes takes 48 and does not fit into [48, 64),
+    // so together with the padding it needs all 64 bytes
+    write(r, std::string(10, 'd'));
+    EXPECT_EQ(nullptr, r.reserve(40));
+    EXPECT_EQ(std::string(10, 'd'), read(r));
+}
+
+// 9. Many wrap arounds with records of different sizes
+TEST(Basic, ManyWraps) {
+
+    lock_free_spsc_byte_ring r(128);
+    for (int i = 0; i < 10000; ++i) {
+        std::string s(i % 50, static_cast<char>('a' + i % 26));
+        write(r, s);
+        EXPECT_EQ(s, read(r));
+    }
+    EXPECT_TRUE(r.empty());
+}
+
+// 10. Single Producer, Single Consumer
+//    -> in the end we must have all the records in
+//          the same order as we pushed
+TEST(Concurrent, SPSC) {
+
+    lock_free_spsc_byte_ring r(1024);
+    int n = 100000;
+
+    std::thread producer([&]() {
+        for (int i = 0; i < n; ++i) {
+            write(r, std::to_string(i) + std::string(i % 37, 'x'));
+        }
+    });
+
+    std::vector<std::string> values;
+    values.reserve(n);
+    std::thread consumer([&]() {
+        for (int i = 0; i < n; ++i) {
+            values.push_back(read(r));
+        }
+    });
+
+    producer.join();
+    consumer.join();
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_EQ(std::to_string(i) + std::string(i % 37, 'x'), values[i]);
+    }
+}
@@ -8,6 +8,7 @@
 #include <random>
 #include <chrono>
 #include  <stdexcept>
+#include <iterator>
 
 /*
 
@@ -491,4 +492,263 @@ TEST(Exception, SPSC_PTR) {
     for (int i = 0; i < n; ++i) {
         EXPECT_TRUE(values[i].load(std::memory_order_relaxed)) << "i= " << i << "\n";
     }
-}
\ No newline at end of file
+}
+/*
+###################################################
+
+            BULK Functionality
+
+###################################################
+*/
+
+// 19. Single thread, push a batch and pop it
+//    in several smaller batches
+TEST(Bulk, PushPop) {
+
+    lock_free_spsc_queue<int> q;
+    std::vector<int> in(10);
+    for (int i = 0; i < 10; ++i) {
+        in[i] = i;
+    }
+    q.push_bulk(in.begin(), in.end());
+
+    std::vector<int> out;
+    EXPECT_EQ(4u, q.pop_bulk(std::back_inserter(out), 4));
+    EXPECT_EQ(4u, q.pop_bulk(std::back_inserter(out), 4));
+    EXPECT_EQ(2u, q.pop_bulk(std::back_inserter(out), 4));
+    EXPECT_EQ(0u, q.pop_bulk(std::back_inserter(out), 4));
+    EXPECT_EQ(in, out);
+    EXPECT_TRUE(q.empty());
+}
+
+// 20. Bulk and single operations can be mixed
+TEST(Bulk, Mixed) {
+
+    lock_free_spsc_queue<int> q;
+    std::vector<int> in = {1, 2, 3};
+    q.push(0);
+    q.push_bulk(in.begin(), in.begin());
+    q.push_bulk(in.begin(), in.end());
+    q.push(4);
+
+    int val;
+    EXPECT_TRUE(q.pop(val));
+    EXPECT_EQ(0, val);
+    int out[4];
+    EXPECT_EQ(4u, q.pop_bulk(out, 10));
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(i + 1, out[i]);
+    }
+}
+
+// 21. Exception in the middle of the batch
+//    -> nothing from the batch is pushed
+TEST(Bulk, Exception) {
+
+    lock_free_spsc_queue<ExeptInt> q;
+    std::vector<ExeptInt> in;
+    in.emplace_back(0, false);
+    in.emplace_back(1, false);
+    in.emplace_back(2, false);
+    in[1].fail_ = true;
+
+    EXPECT_THROW(q.push_bulk(in.begin(), in.end()), std::runtime_error);
+    EXPECT_TRUE(q.empty());
+
+    in[1].fail_ = false;
+    q.push_bulk(in.begin(), in.end());
+    std::vector<ExeptInt> out(3, ExeptInt(-1, false));
+    EXPECT_EQ(3u, q.pop_bulk(out.begin(), 3));
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(i, out[i].i_);
+    }
+}
+
+// 22. Single Producer, Single Consumer with batches
+//    -> in the end we must have all the elemens in
+//          the same order as we pushed
+TEST(Bulk, SPSC) {
+
+    lock_free_spsc_queue<int> q;
+    int n = 64 * 1600;
+    int batch = 64;
+
+    std::thread producer([&]() {
+        std::vector<int> in(batch);
+        for (int i = 0; i < n; i += batch) {
+            for (int j = 0; j < batch; ++j) {
+                in[j] = i + j;
+            }
+            q.push_bulk(in.begin(), in.end());
+        }
+    });
+
+    std::vector<int> values;
+    values.reserve(n);
+    std::thread consumer([&]() {
+        while (values.size() < static_cast<std::size_t>(n)) {
+            q.pop_bulk(std::back_inserter(values), 50);
+        }
+    });
+
+    producer.join();
+    consumer.join();
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_EQ(i, values[i]);
+    }
+}
+
+/*
+###################################################
+
+            LAZY PUBLICATION
+
+###################################################
+*/
+
+// 23. In lazy mode the elements are seen by the consumer
+//    only when the batch is full, or after the flush
+TEST(Lazy, Flush) {
+
+    lock_free_spsc_queue<int> q(4);
+    int val;
+    q.push(0);
+    q.push(1);
+    q.push(2);
+    EXPECT_TRUE(q.empty());
+    EXPECT_FALSE(q.pop(val));
+    q.push(3);
+    EXPECT_FALSE(q.empty());
+    q.push(4);
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(q.pop(val));
+        EXPECT_EQ(i, val);
+    }
+    EXPECT_FALSE(q.pop(val));
+    q.flush();
+    EXPECT_TRUE(q.pop(val));
+    EXPECT_EQ(4, val);
+    EXPECT_TRUE(q.empty());
+}
+
+// 24. Bulk push publishes everything that was pushed
+//    before it as well
+TEST(Lazy, Bulk) {
+
+    lock_free_spsc_queue<int> q(100);
+    std::vector<int> in = {1, 2};
+    q.push(0);
+    q.push_bulk(in.begin(), in.end());
+    int out[3];
+    EXPECT_EQ(3u, q.pop_bulk(out, 10));
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(i, out[i]);
+    }
+}
+
+// 25. Elements that were not published are
+//    destroyed together with the queue
+TEST(Lazy, Destroy) {
+
+    std::shared_ptr<int> ptr = std::make_shared<int>(1);
+    {
+        lock_free_spsc_queue<std::shared_ptr<int>> q(8);
+        q.push(ptr);
+        q.push(ptr);
+        EXPECT_EQ(3, ptr.use_count());
+    }
+    EXPECT_EQ(1, ptr.use_count());
+}
+
+// 26. Single Producer, Single Consumer in lazy mode
+//    -> in the end we must have all the elemens in
+//          the same order as we pushed
+TEST(Lazy, SPSC) {
+
+    lock_free_spsc_queue<int> q(32);
+    int n = 100000;
+
+    std::thread producer([&]() {
+        for (int i = 0; i < n; ++i) {
+            q.push(i);
+        }
+        q.flush();
+    });
+
+    std::vector<int> values;
+    values.reserve(n);
+    std::thread consumer([&]() {
+        int val;
+        while (values.size() < static_cast<std::size_t>(n)) {
+            if (q.pop(val)) {
+                values.push_back(val);
+            }
+        }
+    });
+
+    producer.join();
+    consumer.join();
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_EQ(i, values[i]);
+    }
+}
+
+/*
+###################################################
+
+            BLOCKING Functionality
+
+###################################################
+*/
+
+// 27. Timed pop gives up on the empty queue, and
+//    does not see the elements that are not published
+TEST(Blocking, Timeout) {
+
+    lock_free_spsc_queue<int> q(8);
+    int val = -1;
+    EXPECT_FALSE(q.wait_pop_for(val, std::chrono::milliseconds(10)));
+    q.push(1);
+    EXPECT_FALSE(q.wait_pop_for(val, std::chrono::milliseconds(10)));
+    q.flush();
+    EXPECT_TRUE(q.wait_pop_for(val, std::chrono::milliseconds(10)));
+    EXPECT_EQ(1, val);
+}
+
+// 28. Single Producer, Single Consumer, the producer
+//    makes pauses, so that the consumer goes to sleep
+//    -> in the end we must have all the elemens in
+//          the same order as we pushed
+TEST(Blocking, SPSC) {
+
+    lock_free_spsc_queue<int> q;
+    int n = 20000;
+
+    std::thread producer([&]() {
+        for (int i = 0; i < n; ++i) {
+            q.push(i);
+            if (i % 5000 == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+    });
+
+    std::vector<int> values;
+    values.reserve(n);
+    std::thread consumer([&]() {
+        int val;
+        for (int i = 0; i < n; ++i) {
+            q.wait_pop(val);
+            values.push_back(val);
+        }
+    });
+
+    producer.join();
+    consumer.join();
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_EQ(i, values[i]);
+    }
+}
@@ -0,0 +1,464 @@
+#include "lock-free-spsc-ring-queue.hpp"
+
+#include <gtest/gtest.h>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <random>
+#include <chrono>
+#include  <stdexcept>
+#include <memory>
+#include <string>
+#include <iterator>
+#include <algorithm>
+
+/*
+
+1. Basic Functionality
+
+    - Elements pushed into the queue can be popped
+    in the correct order
+    - Ensure that empty returns true for new queue
+    - Push fails on a full queue, and succeeds again
+    after a pop
+    - Indices keep working after many wrap arounds
+
+2. Concurrent Access Tests
+
+    - Single Producer and Single Consumer
+        -> order of the elements is preserved
+
+3. Stress Tests
+    - Push and Pop a large number of elements through
+    a small buffer
+
+4. Exception Safety Tests
+    - Simulate exeptions during push or pop operations to ensure that
+    the queue remains in a consistent state and no deadlock happens
+
+5. Lifetime
+    - Elements left in the queue are destroyed together with it
+*/
+
+// 1. Single thread, empty
+TEST(Basic, Empty) {
+    lock_free_spsc_ring_queue<int> q(16);
+    EXPECT_TRUE(q.empty());
+    EXPECT_EQ(16u, q.capacity());
+}
+
+// 2. Size is rounded up to the power of 2
+TEST(Basic, Capacity) {
+    lock_free_spsc_ring_queue<int> q(100);
+    EXPECT_EQ(128u, q.capacity());
+}
+
+// 3. Single thread, Push and then
+//  pop with value
+TEST(Basic, Push_TryPopVal) {
+
+    lock_free_spsc_ring_queue<int> q(16);
+
+    EXPECT_TRUE(q.push(1));
+    EXPECT_TRUE(q.push(2));
+    EXPECT_TRUE(q.push(3));
+    EXPECT_FALSE(q.empty());
+
+    int val;
+    EXPECT_TRUE(q.pop(val));
+    EXPECT_EQ(1, val);
+    EXPECT_TRUE(q.pop(val));
+    EXPECT_EQ(2, val);
+    EXPECT_TRUE(q.pop(val));
+    EXPECT_EQ(3, val);
+    EXPECT_TRUE(q.empty());
+}
+
+// 4. Single thread, unsuccessful pop
+TEST(Basic, Unsussesful_Pop) {
+
+    lock_free_spsc_ring_queue<int> q(16);
+    int val;
+    EXPECT_FALSE(q.pop(val));
+}
+
+// 5. Single thread, push into a full queue
+TEST(Basic, Full) {
+
+    lock_free_spsc_ring_queue<int> q(4);
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(q.push(i));
+    }
+    EXPECT_FALSE(q.push(4));
+
+    int val;
+    EXPECT_TRUE(q.pop(val));
+    EXPECT_EQ(0, val);
+    EXPECT_TRUE(q.push(4));
+    EXPECT_FALSE(q.push(5));
+}
+
+// 6. Single thread, many rounds over a small buffer
+TEST(Basic, WrapAround) {
+
+    lock_free_spsc_ring_queue<int> q(4);
+    int val;
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_TRUE(q.push(i));
+        EXPECT_TRUE(q.push(i + 1));
+        EXPECT_TRUE(q.pop(val));
+        EXPECT_EQ(i, val);
+        EXPECT_TRUE(q.pop(val));
+        EXPECT_EQ(i + 1, val);
+    }
+    EXPECT_TRUE(q.empty());
+}
+
+// 7. Emplace constructs the element in place
+TEST(Basic, Emplace) {
+
+    lock_free_spsc_ring_queue<std::pair<int, std::string>> q(4);
+    EXPECT_TRUE(q.emplace(1, "one"));
+
+    std::pair<int, std::string> val;
+    EXPECT_TRUE(q.pop(val));
+    EXPECT_EQ(1, val.first);
+    EXPECT_EQ("one", val.second);
+}
+
+// 8. Elements that were not popped are destroyed
+TEST(Basic, Destructor) {
+
+    std::shared_ptr<int> ptr = std::make_shared<int>(1);
+    {
+        lock_free_spsc_ring_queue<std::shared_ptr<int>> q(4);
+        q.push(ptr);
+        q.push(ptr);
+        EXPECT_EQ(3, ptr.use_count());
+    }
+    EXPECT_EQ(1, ptr.use_count());
+}
+
+// 9. Single Producer, Single Consumer
+//    -> in the end we must have all the elemens in
+//          the same order as we pushed
+TEST(Concurrent, SPSC) {
+
+    lock_free_spsc_ring_queue<int> q(64);
+    std::vector<std::thread> threads;
+    int concurrency_level = 2;
+    int n = 10000;
+    threads.emplace_back( [&](){
+        for (int i = 0; i < n; ++i) {
+            while(!q.push(i));
+        }
+    });
+    std::vector<int> values(n);
+    threads.emplace_back( [&](){
+        for (int i = 0; i < n; ++i) {
+            while(!q.pop(values[i]));
+        }
+    });
+
+    for (int i = 0; i < concurrency_level; ++i) {
+        threads[i].join();
+    }
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_EQ(i, values[i]);
+    }
+}
+
+// 10. Large number of push and pop operations
+//    -> use very high N (1 000 000) through the
+//       buffer that is much smaller
+TEST(Stress, HighSPSC) {
+
+    lock_free_spsc_ring_queue<int> q(1024);
+    std::vector<std::thread> threads;
+    int n = 1'000'000;
+
+    threads.emplace_back([&q, n]() {
+        for (int j = 0; j < n; ++j) {
+            while(!q.push(j));
+        }
+    });
+
+    std::vector<std::atomic<bool>> values(n);
+    threads.emplace_back([n, &q, &values]() {
+        int prev = -1;
+        for (int j = 0; j < n; ++j) {
+            int val;
+            while(!q.pop(val));
+            EXPECT_EQ(prev + 1, val);
+            prev = val;
+            values[val].store(true, std::memory_order_relaxed);
+        }
+    });
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_TRUE(values[i].load(std::memory_order_relaxed)) << "i= " << i << "\n";
+    }
+}
+
+// 11. Exception handelling
+//    -> Create a type, which in copy/move assignment/operator
+//      throws exeptions with probability 1/6
+//    -> try common tests with push pop to ensure that everything works
+
+struct ExeptInt {
+
+    ExeptInt(int i, bool ex)
+    : i_(i)
+    , fail_(ex)
+    {}
+
+    ExeptInt(const ExeptInt& other)
+    : i_(other.i_), fail_(other.fail_)
+    {
+        if (fail_) {
+            throw std::runtime_error("");
+        }
+    }
+
+    ExeptInt(ExeptInt&& other) noexcept(false)
+    : i_(other.i_), fail_(other.fail_)
+    {
+        if (fail_) {
+            throw std::runtime_error("");
+        }
+    }
+
+    ExeptInt& operator= (const ExeptInt& other) {
+
+        if (fail_) {
+            throw std::runtime_error("");
+        }
+
+        i_ = other.i_;
+        fail_ = other.fail_;
+
+        return *this;
+    }
+
+    ExeptInt& operator= (ExeptInt&& other) noexcept(false)
+    {
+
+        if (fail_) {
+            throw std::runtime_error("");
+        }
+
+        i_ = other.i_;
+        fail_ = other.fail_;
+
+        return *this;
+    }
+
+    int i_;
+    bool fail_;
+};
+
+TEST(Exception, SPSC) {
+
+    lock_free_spsc_ring_queue<ExeptInt> q(128);
+    std::vector<std::thread> threads;
+    int concurrency_level = 2;
+    int n = 1200;
+
+    threads.emplace_back([&q, n]() {
+        std::mt19937 gen(std::random_device{}());
+        std::uniform_int_distribution<int> dist(1, 6);
+        for (int j = 0; j < n; ++j) {
+            ExeptInt num(j, dist(gen) / 6);
+            try {
+                while(!q.push(num));
+            } catch (const std::exception& e) {
+                ExeptInt num2(j, false);
+                while(!q.push(num2));
+            }
+        }
+    });
+
+    std::vector<std::atomic<bool>> values(n);
+    threads.emplace_back([n, &q, &values]() {
+        std::mt19937 gen(std::random_device{}());
+        std::uniform_int_distribution<int> dist(1, 6);
+        for (int j = 0; j < n; ++j) {
+            ExeptInt val(0, dist(gen) / 6);
+            try {
+                while(!q.pop(val));
+                values[val.i_].store(true, std::memory_order_relaxed);
+            } catch (const std::exception& e) {
+                ExeptInt val2(0, 0);
+                while(!q.pop(val2));
+                values[val2.i_].store(true, std::memory_order_relaxed);
+            }
+        }
+    });
+
+    for (int i = 0; i < concurrency_level; ++i) {
+        threads[i].join();
+    }
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_TRUE(values[i].load(std::memory_order_relaxed)) << "i= " << i << "\n";
+    }
+}
+
+/*
+###################################################
+
+            BULK Functionality
+
+###################################################
+*/
+
+// 12. Single thread, push a batch and pop it
+//    in several smaller batches
+TEST(Bulk, PushPop) {
+
+    lock_free_spsc_ring_queue<int> q(16);
+    std::vector<int> in(10);
+    for (int i = 0; i < 10; ++i) {
+        in[i] = i;
+    }
+    EXPECT_EQ(10u, q.push_bulk(in.begin(), in.end()));
+
+    std::vector<int> out;
+    EXPECT_EQ(4u, q.pop_bulk(std::back_inserter(out), 4));
+    EXPECT_EQ(4u, q.pop_bulk(std::back_inserter(out), 4));
+    EXPECT_EQ(2u, q.pop_bulk(std::back_inserter(out), 4));
+    EXPECT_EQ(0u, q.pop_bulk(std::back_inserter(out), 4));
+    EXPECT_EQ(in, out);
+    EXPECT_TRUE(q.empty());
+}
+
+// 13. Batch that does not fit is pushed partially
+TEST(Bulk, Full) {
+
+    lock_free_spsc_ring_queue<int> q(8);
+    int in[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    EXPECT_EQ(8u, q.push_bulk(in, in + 10));
+    EXPECT_EQ(0u, q.push_bulk(in + 8, in + 10));
+
+    int out[10];
+    EXPECT_EQ(8u, q.pop_bulk(out, 10));
+    for (int i = 0; i < 8; ++i) {
+        EXPECT_EQ(i, out[i]);
+    }
+}
+
+// 14. Plain arrays of trivially copyable elements are
+//    copied with memcpy, also across the wrap point
+TEST(Bulk, WrapAround) {
+
+    lock_free_spsc_ring_queue<int> q(8);
+    int in[7];
+    int out[7];
+    for (int round = 0; round < 100; ++round) {
+        for (int i = 0; i < 7; ++i) {
+            in[i] = round * 7 + i;
+        }
+        EXPECT_EQ(7u, q.push_bulk(in, in + 7));
+        EXPECT_EQ(7u, q.pop_bulk(out, 7));
+        for (int i = 0; i < 7; ++i) {
+            EXPECT_EQ(in[i], out[i]);
+        }
+    }
+    EXPECT_TRUE(q.empty());
+}
+
+// 15. Elements that are not trivially copyable
+//    are constructed one by one
+TEST(Bulk, Strings) {
+
+    lock_free_spsc_ring_queue<std::string> q(4);
+    std::vector<std::string> in = {"a", "b", "c"};
+    for (int round = 0; round < 10; ++round) {
+        EXPECT_EQ(3u, q.push_bulk(in.begin(), in.end()));
+        std::vector<std::string> out;
+        EXPECT_EQ(3u, q.pop_bulk(std::back_inserter(out), 3));
+        EXPECT_EQ(in, out);
+    }
+}
+
+// 16. Exception in the middle of the batch
+//    -> the part before it is pushed
+TEST(Bulk, Exception) {
+
+    lock_free_spsc_ring_queue<ExeptInt> q(8);
+    std::vector<ExeptInt> in;
+    in.emplace_back(0, false);
+    in.emplace_back(1, false);
+    in.emplace_back(2, false);
+    in[1].fail_ = true;
+
+    EXPECT_THROW(q.push_bulk(in.begin(), in.end()), std::runtime_error);
+    ExeptInt val(-1, false);
+    EXPECT_TRUE(q.pop(val));
+    EXPECT_EQ(0, val.i_);
+    EXPECT_TRUE(q.empty());
+}
+
+// 17. Single Producer, Single Consumer with batches
+//    -> in the end we must have all the elemens in
+//          the same order as we pushed
+TEST(Bulk, SPSC) {
+
+    lock_free_spsc_ring_queue<int> q(256);
+    int n = 64 * 1600;
+    int batch = 64;
+
+    std::thread producer([&]() {
+        std::vector<int> in(batch);
+        for (int i = 0; i < n; i += batch) {
+            for (int j = 0; j < batch; ++j) {
+                in[j] = i + j;
+            }
+            int pushed = 0;
+            while (pushed < batch) {
+                pushed += q.push_bulk(in.data() + pushed, in.data() + batch);
+            }
+        }
+    });
+
+    std::vector<int> values(n);
+    std::thread consumer([&]() {
+        int popped = 0;
+        while (popped < n) {
+            popped += q.pop_bulk(values.data() + popped, std::min(50, n - popped));
+        }
+    });
+
+    producer.join();
+    consumer.join();
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_EQ(i, values[i]);
+    }
+}
+
+// 18. Batches with a cache line per slot: the slots
+//      are not contiguous, so no plain memcpy
+TEST(Bulk, PaddedCells) {
+
+    lock_free_spsc_ring_queue<int, layout_padded_cells> q(16);
+    std::vector<int> in(20);
+    for (int i = 0; i < 20; ++i) {
+        in[i] = i;
+    }
+    for (int round = 0; round < 5; ++round) {
+        EXPECT_EQ(16u, q.push_bulk(in.data(), in.data() + in.size()));
+        int out[20];
+        EXPECT_EQ(10u, q.pop_bulk(out, 10));
+        EXPECT_EQ(6u, q.pop_bulk(out + 10, 10));
+        for (int i = 0; i < 16; ++i) {
+            EXPECT_EQ(i, out[i]);
+        }
+    }
+    EXPECT_TRUE(q.empty());
+}
@@ -0,0 +1,339 @@
+#include "lock-free-spsc-segmented-queue.hpp"
+
+#include <gtest/gtest.h>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <random>
+#include <chrono>
+#include  <stdexcept>
+#include <memory>
+
+/*
+
+1. Basic Functionality
+
+    - Elements pushed into the queue can be popped
+    in the correct order
+    - Ensure that empty returns true for new queue
+    - Elements keep their order across the boundaries
+    of the segments
+
+2. Concurrent Access Tests
+
+    - Single Producer and Single Consumer
+        -> order of the elements is preserved
+
+3. Stress Tests
+    - Push and Pop a large number of elements concurrently,
+    so that segments are linked and recycled all the time
+
+4. Exception Safety Tests
+    - Simulate exeptions during push or pop operations to ensure that
+    the queue remains in a consistent state and no deadlock happens
+
+5. Lifetime
+    - Elements left in the queue are destroyed together with it
+*/
+
+// 1. Single thread, empty
+TEST(Basic, Empty) {
+    lock_free_spsc_segmented_queue<int> q;
+    EXPECT_TRUE(q.empty());
+}
+
+// 2. Single thread, Push and then
+//  pop with value
+TEST(Basic, Push_TryPopVal) {
+
+    lock_free_spsc_segmented_queue<int> q;
+
+    q.push(1);
+    q.push(2);
+    q.push(3);
+    EXPECT_FALSE(q.empty());
+
+    int val;
+    EXPECT_TRUE(q.pop(val));
+    EXPECT_EQ(1, val);
+    EXPECT_TRUE(q.pop(val));
+    EXPECT_EQ(2, val);
+    EXPECT_TRUE(q.pop(val));
+    EXPECT_EQ(3, val);
+    EXPECT_TRUE(q.empty());
+}
+
+// 3. Single thread, Push and then
+//  pop with ptr
+TEST(Basic, Push_TryPopPtr) {
+
+    lock_free_spsc_segmented_queue<int> q;
+
+    q.push(1);
+    q.push(2);
+
+    auto ptr = q.pop();
+    ASSERT_TRUE(ptr);
+    EXPECT_EQ(1, *ptr);
+
+    ptr = q.pop();
+    ASSERT_TRUE(ptr);
+    EXPECT_EQ(2, *ptr);
+
+    EXPECT_FALSE(q.pop());
+}
+
+// 4. Single thread, unsuccessful pop
+TEST(Basic, Unsussesful_Pop) {
+
+    lock_free_spsc_segmented_queue<int> q;
+    int val;
+    EXPECT_FALSE(q.pop(val));
+    EXPECT_FALSE(q.pop());
+}
+
+// 5. Single thread, many small segments
+//    -> fill several segments, drain them, and
+//       do it again to reuse the recycled ones
+TEST(Basic, Segments) {
+
+    lock_free_spsc_segmented_queue<int, 4> q(2);
+    int val;
+    for (int round = 0; round < 10; ++round) {
+        for (int i = 0; i < 37; ++i) {
+            q.push(i);
+        }
+        for (int i = 0; i < 37; ++i) {
+            EXPECT_TRUE(q.pop(val));
+            EXPECT_EQ(i, val);
+        }
+        EXPECT_TRUE(q.empty());
+    }
+}
+
+// 6. Elements that were not popped are destroyed
+TEST(Basic, Destructor) {
+
+    std::shared_ptr<int> ptr = std::make_shared<int>(1);
+    {
+        lock_free_spsc_segmented_queue<std::shared_ptr<int>, 4> q;
+        for (int i = 0; i < 10; ++i) {
+            q.push(ptr);
+        }
+        std::shared_ptr<int> val;
+        q.pop(val);
+        q.pop(val);
+        val.reset();
+        EXPECT_EQ(9, ptr.use_count());
+    }
+    EXPECT_EQ(1, ptr.use_count());
+}
+
+// 7. Single Producer, Single Consumer
+//    -> in the end we must have all the elemens in
+//          the same order as we pushed
+TEST(Concurrent, SPSC) {
+
+    lock_free_spsc_segmented_queue<int, 16> q;
+    std::vector<std::thread> threads;
+    int concurrency_level = 2;
+    int n = 10000;
+    threads.emplace_back( [&](){
+        for (int i = 0; i < n; ++i) {
+            q.push(i);
+        }
+    });
+    std::vector<int> values(n);
+    threads.emplace_back( [&](){
+        for (int i = 0; i < n; ++i) {
+            while(!q.pop(values[i]));
+        }
+    });
+
+    for (int i = 0; i < concurrency_level; ++i) {
+        threads[i].join();
+    }
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_EQ(i, values[i]);
+    }
+}
+
+// 8. Large number of push and pop operations
+//    -> use very high N (1 000 000)
+TEST(Stress, HighSPSC) {
+
+    lock_free_spsc_segmented_queue<int, 64> q;
+    std::vector<std::thread> threads;
+    int n = 1'000'000;
+
+    threads.emplace_back([&q, n]() {
+        for (int j = 0; j < n; ++j) {
+            q.push(j);
+        }
+    });
+
+    std::vector<std::atomic<bool>> values(n);
+    threads.emplace_back([n, &q, &values]() {
+        int prev = -1;
+        for (int j = 0; j < n; ++j) {
+            int val;
+            while(!q.pop(val));
+            EXPECT_EQ(prev + 1, val);
+            prev = val;
+            values[val].store(true, std::memory_order_relaxed);
+        }
+    });
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_TRUE(values[i].load(std::memory_order_relaxed)) << "i= " << i << "\n";
+    }
+}
+
+// 9. Random delays
+//     -> Introduce random sleep interval in producer
+//          and consumer threads
+TEST(Stress, RandSPSC) {
+
+    lock_free_spsc_segmented_queue<int, 8> q;
+    std::vector<std::thread> threads;
+    int n = 5000;
+
+    threads.emplace_back([&q, n]() {
+        std::mt19937 gen(std::random_device{}());
+        std::uniform_int_distribution<int> dist(0, 100);
+        for (int j = 0; j < n; ++j) {
+            q.push(j);
+            std::this_thread::sleep_for(std::chrono::microseconds(dist(gen)));
+        }
+    });
+
+    std::vector<std::atomic<bool>> values(n);
+
+    threads.emplace_back([n, &q, &values]() {
+        std::mt19937 gen(std::random_device{}());
+        std::uniform_int_distribution<int> dist(0, 100);
+        for (int j = 0; j < n; ++j) {
+            int val;
+            while(!q.pop(val));
+            values[val].store(true, std::memory_order_relaxed);
+            std::this_thread::sleep_for(std::chrono::microseconds(dist(gen)));
+        }
+    });
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_TRUE(values[i].load(std::memory_order_relaxed)) << "i= " << i << "\n";
+    }
+}
+
+// 10. Exception handelling
+//    -> Create a type, which in copy/move assignment/operator
+//      throws exeptions with probability 1/6
+//    -> try common tests with push pop to ensure that everything works
+
+struct ExeptInt {
+
+    ExeptInt(int i, bool ex)
+    : i_(i)
+    , fail_(ex)
+    {}
+
+    ExeptInt(const ExeptInt& other)
+    : i_(other.i_), fail_(other.fail_)
+    {
+        if (fail_) {
+            throw std::runtime_error("");
+        }
+    }
+
+    ExeptInt(ExeptInt&& other) noexcept(false)
+    : i_(other.i_), fail_(other.fail_)
+    {
+        if (fail_) {
+            throw std::runtime_error("");
+        }
+    }
+
+    ExeptInt& operator= (const ExeptInt& other) {
+
+        if (fail_) {
+            throw std::runtime_error("");
+        }
+
+        i_ = other.i_;
+        fail_ = other.fail_;
+
+        return *this;
+    }
+
+    ExeptInt& operator= (ExeptInt&& other) noexcept(false)
+    {
+
+        if (fail_) {
+            throw std::runtime_error("");
+        }
+
+        i_ = other.i_;
+        fail_ = other.fail_;
+
+        return *this;
+    }
+
+    int i_;
+    bool fail_;
+};
+
+TEST(Exception, SPSC) {
+
+    lock_free_spsc_segmented_queue<ExeptInt, 16> q;
+    std::vector<std::thread> threads;
+    int concurrency_level = 2;
+    int n = 1200;
+
+    threads.emplace_back([&q, n]() {
+        std::mt19937 gen(std::random_device{}());
+        std::uniform_int_distribution<int> dist(1, 6);
+        for (int j = 0; j < n; ++j) {
+            ExeptInt num(j, dist(gen) / 6);
+            try {
+                q.push(num);
+            } catch (const std::exception& e) {
+                ExeptInt num2(j, false);
+                q.push(num2);
+            }
+        }
+    });
+
+    std::vector<std::atomic<bool>> values(n);
+    threads.emplace_back([n, &q, &values]() {
+        std::mt19937 gen(std::random_device{}());
+        std::uniform_int_distribution<int> dist(1, 6);
+        for (int j = 0; j < n; ++j) {
+            ExeptInt val(0, dist(gen) / 6);
+            try {
+                while(!q.pop(val));
+                values[val.i_].store(true, std::memory_order_relaxed);
+            } catch (const std::exception& e) {
+                ExeptInt val2(0, 0);
+                while(!q.pop(val2));
+                values[val2.i_].store(true, std::memory_order_relaxed);
+            }
+        }
+    });
+
+    for (int i = 0; i < concurrency_level; ++i) {
+        threads[i].join();
+    }
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_TRUE(values[i].load(std::memory_order_relaxed)) << "i= " << i << "\n";
+    }
+}
@@ -16,6 +16,13 @@
 // 5. Stress push pop
 // 6. Stress Rand Delays Push Pop
 // 7. Exception Push Pop
+// 8. Timed wait pop
+// 9. Concurrent push and wait pop
+// 10. Intrusive push pop
+// 11. Intrusive concurrent pop and push back (ABA)
+// 12. Drain newest first and oldest first, push back on exception
+// 13. Concurrent push, pop and drain
+// 14. Concurrent pop and drain with exceptions
 
 TEST(Basic, Empty) {
 
@@ -324,4 +331,278 @@ TEST(Stress, Exceptions) {
     for (int i = 0; i < n; ++i) {
         EXPECT_TRUE(values[i].load());
     }
-}
\ No newline at end of file
+}
+
+TEST(Blocking, Timeout) {
+
+    lock_free_stack<int> s;
+
+    EXPECT_EQ(nullptr, s.wait_pop_for(std::chrono::milliseconds(10)));
+    s.push(1);
+    std::shared_ptr<int> res = s.wait_pop_for(std::chrono::milliseconds(10));
+    ASSERT_TRUE(res);
+    EXPECT_EQ(1, *res);
+}
+
+TEST(Blocking, WaitPop) {
+
+    lock_free_stack<int> s;
+
+    std::vector<std::thread> threads;
+    int number_of_producers = 4;
+    int number_of_consumers = 4;
+    int n = 20000;
+
+    std::vector<std::atomic<bool>> values(n);
+    for (int i = 0; i < n; ++i) {
+        values[i].store(false);
+    }
+
+    for (int i = 0; i < number_of_consumers; ++i) {
+        threads.emplace_back([&]() {
+            for(int j = 0; j < (n / number_of_consumers); ++j) {
+                std::shared_ptr<int> res = s.wait_pop();
+                values[*res].store(true, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    // Let the consumers fall asleep first
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    for (int i = 0; i < number_of_producers; ++i) {
+        threads.emplace_back([&s, number_of_producers, i, n]() {
+            int beg = i * (n / number_of_producers);
+            int end = (i + 1) * (n / number_of_producers);
+            for(int j = beg; j < end; ++j) {
+                s.push(j);
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_TRUE(values[i].load());
+    }
+}
+
+struct Item : intrusive_hook {
+    int val_;
+};
+
+TEST(Intrusive, PushPop) {
+
+    lock_free_intrusive_stack<Item> s;
+    std::vector<Item> items(3);
+    EXPECT_TRUE(s.empty());
+    EXPECT_EQ(nullptr, s.pop());
+
+    for (int i = 0; i < 3; ++i) {
+        items[i].val_ = i;
+        s.push(&items[i]);
+    }
+    EXPECT_FALSE(s.empty());
+    for (int i = 2; i >= 0; --i) {
+        Item* res = s.pop();
+        ASSERT_EQ(&items[i], res);
+        EXPECT_EQ(i, res->val_);
+    }
+    EXPECT_TRUE(s.empty());
+}
+
+// Every thread pops an item and pushes it straight back,
+// so the same items come to the top again and again,
+// as in a pool of free objects
+//    -> in the end every item is in the stack exactly once
+TEST(Intrusive, PopPushBack) {
+
+    lock_free_intrusive_stack<Item> s;
+    int n = 64;
+    std::vector<Item> items(n);
+    for (int i = 0; i < n; ++i) {
+        items[i].val_ = i;
+        s.push(&items[i]);
+    }
+
+    std::vector<std::thread> threads;
+    std::atomic<bool> ok(true);
+    for (int i = 0; i < 8; ++i) {
+        threads.emplace_back([&]() {
+            for (int j = 0; j < 50'000; ++j) {
+                Item* item = s.pop();
+                if (item == nullptr) {
+                    ok.store(false);
+                    continue;
+                }
+                s.push(item);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    EXPECT_TRUE(ok.load());
+
+    std::vector<int> seen(n);
+    while (Item* item = s.pop()) {
+        ++seen[item->val_];
+    }
+    for (int i = 0; i < n; ++i) {
+        EXPECT_EQ(1, seen[i]) << "i= " << i << "\n";
+    }
+}
+
+TEST(Drain, Basic) {
+
+    lock_free_stack<int> s;
+    EXPECT_EQ(0u, s.drain([](std::shared_ptr<int>) {}));
+    for (int i = 0; i < 4; ++i) {
+        s.push(i);
+    }
+    std::vector<int> out;
+    EXPECT_EQ(4u, s.drain([&out](std::shared_ptr<int> v) { out.push_back(*v); }));
+    EXPECT_EQ((std::vector<int>{3, 2, 1, 0}), out);
+    EXPECT_TRUE(s.empty());
+
+    for (int i = 0; i < 4; ++i) {
+        s.push(i);
+    }
+    out.clear();
+    EXPECT_EQ(4u, s.drain_fifo([&out](std::shared_ptr<int> v) { out.push_back(*v); }));
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3}), out);
+
+    // 1 throws, 2 and 3 go back
+    for (int i = 0; i < 4; ++i) {
+        s.push(i);
+    }
+    out.clear();
+    EXPECT_THROW(s.drain_fifo([&out](std::shared_ptr<int> v) {
+        if (*v == 1) {
+            throw std::runtime_error("");
+        }
+        out.push_back(*v);
+    }), std::runtime_error);
+    EXPECT_EQ((std::vector<int>{0}), out);
+    EXPECT_EQ(2u, s.drain_fifo([&out](std::shared_ptr<int> v) { out.push_back(*v); }));
+    EXPECT_EQ((std::vector<int>{0, 2, 3}), out);
+}
+
+// Producers push, one consumer pops, another one drains
+//    -> every element is taken exactly once
+TEST(Drain, Concurrent) {
+
+    lock_free_stack<int> s;
+    int n = 40'000;
+    int number_of_producers = 4;
+    std::vector<std::atomic<int>> values(n);
+    std::atomic<int> taken(0);
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < number_of_producers; ++i) {
+        threads.emplace_back([&s, number_of_producers, i, n]() {
+            int beg = i * (n / number_of_producers);
+            int end = (i + 1) * (n / number_of_producers);
+            for(int j = beg; j < end; ++j) {
+                s.push(j);
+            }
+        });
+    }
+    threads.emplace_back([&]() {
+        while (taken.load() < n) {
+            if (auto res = s.pop()) {
+                values[*res].fetch_add(1);
+                taken.fetch_add(1);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+    threads.emplace_back([&]() {
+        while (taken.load() < n) {
+            std::size_t got = s.drain([&](std::shared_ptr<int> v) {
+                values[*v].fetch_add(1);
+            });
+            taken.fetch_add(static_cast<int>(got));
+            std::this_thread::yield();
+        }
+    });
+
+    for (auto& t : threads) {
+        t.join();
+    }
+    for (int i = 0; i < n; ++i) {
+        EXPECT_EQ(1, values[i].load()) << "i= " << i << "\n";
+    }
+}
+
+// Producers push, two consumers pop, two others drain and throw
+// on every 7th value, so the rest goes back as new nodes while
+// the poppers may still read the detached ones
+//    -> every element is taken exactly once
+TEST(Drain, ConcurrentExceptions) {
+
+    lock_free_stack<int> s;
+    int n = 40'000;
+    int number_of_producers = 2;
+    std::vector<std::atomic<int>> values(n);
+    std::atomic<int> taken(0);
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < number_of_producers; ++i) {
+        threads.emplace_back([&s, number_of_producers, i, n]() {
+            int beg = i * (n / number_of_producers);
+            int end = (i + 1) * (n / number_of_producers);
+            for(int j = beg; j < end; ++j) {
+                s.push(j);
+            }
+        });
+    }
+    for (int i = 0; i < 2; ++i) {
+        threads.emplace_back([&]() {
+            while (taken.load() < n) {
+                if (auto res = s.pop()) {
+                    values[*res].fetch_add(1);
+                    taken.fetch_add(1);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    // The thrown on value is taken as well
+    auto take = [&](std::shared_ptr<int> v) {
+        values[*v].fetch_add(1);
+        taken.fetch_add(1);
+        if (*v % 7 == 0) {
+            throw std::runtime_error("drain");
+        }
+    };
+    threads.emplace_back([&]() {
+        while (taken.load() < n) {
+            try {
+                s.drain(take);
+            } catch (std::runtime_error const&) {
+            }
+            std::this_thread::yield();
+        }
+    });
+    threads.emplace_back([&]() {
+        while (taken.load() < n) {
+            try {
+                s.drain_fifo(take);
+            } catch (std::runtime_error const&) {
+            }
+            std::this_thread::yield();
+        }
+    });
+
+    for (auto& t : threads) {
+        t.join();
+    }
+    for (int i = 0; i < n; ++i) {
+        EXPECT_EQ(1, values[i].load()) << "i= " << i << "\n";
+    }
+    EXPECT_FALSE(s.pop());
+}
@@ -0,0 +1,169 @@
+#include "lock-free-work-stealing-deque.hpp"
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/*
+
+1. Basic Functionality
+
+    - The owner pops LIFO, the thieves steal FIFO
+    - Empty deque gives nothing to both
+    - The array grows and keeps the elements
+
+2. Concurrent Access Tests
+
+    - Owner pushes, thieves steal everything
+    - Owner pushes and pops, thieves steal
+      -> every element is taken exactly once
+
+*/
+
+// 1. Pop takes the newest, steal the oldest
+TEST(Basic, PopSteal) {
+
+    lock_free_work_stealing_deque<int> dq(8);
+    for (int i = 0; i < 5; ++i) {
+        dq.push(i);
+    }
+    EXPECT_EQ(5u, dq.size());
+
+    int val;
+    EXPECT_TRUE(dq.pop(val));
+    EXPECT_EQ(4, val);
+    EXPECT_TRUE(dq.steal(val));
+    EXPECT_EQ(0, val);
+    EXPECT_TRUE(dq.steal(val));
+    EXPECT_EQ(1, val);
+    EXPECT_TRUE(dq.pop(val));
+    EXPECT_EQ(3, val);
+    EXPECT_TRUE(dq.pop(val));
+    EXPECT_EQ(2, val);
+    EXPECT_TRUE(dq.empty());
+}
+
+// 2. Nothing to take from the empty deque
+TEST(Basic, Empty) {
+
+    lock_free_work_stealing_deque<int> dq(4);
+    int val;
+    EXPECT_FALSE(dq.pop(val));
+    EXPECT_FALSE(dq.steal(val));
+    EXPECT_EQ(0u, dq.size());
+
+    dq.push(1);
+    EXPECT_TRUE(dq.pop(val));
+    EXPECT_FALSE(dq.pop(val));
+    EXPECT_FALSE(dq.steal(val));
+    EXPECT_TRUE(dq.empty());
+}
+
+// 3. The array grows, and the elements stay in order,
+//      also when the indices are past the first round
+TEST(Basic, Grow) {
+
+    lock_free_work_stealing_deque<int> dq(4);
+    int val;
+    for (int i = 0; i < 3; ++i) {
+        dq.push(-1);
+        EXPECT_TRUE(dq.steal(val));
+    }
+    for (int i = 0; i < 100; ++i) {
+        dq.push(i);
+    }
+    EXPECT_EQ(128u, dq.capacity());
+    EXPECT_EQ(100u, dq.size());
+    for (int i = 0; i < 50; ++i) {
+        EXPECT_TRUE(dq.steal(val));
+        EXPECT_EQ(i, val);
+    }
+    for (int i = 99; i >= 50; --i) {
+        EXPECT_TRUE(dq.pop(val));
+        EXPECT_EQ(i, val);
+    }
+    EXPECT_TRUE(dq.empty());
+}
+
+// 4. Owner only pushes, three thieves steal everything
+TEST(Concurrent, Steal) {
+
+    lock_free_work_stealing_deque<int> dq(16);
+    int n = 100000;
+    int thieves = 3;
+    std::atomic<int> taken(0);
+    std::vector<std::atomic<int>> seen(n);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thieves; ++i) {
+        threads.emplace_back([&]() {
+            int val;
+            while (taken.load() < n) {
+                if (dq.steal(val)) {
+                    seen[val].fetch_add(1);
+                    taken.fetch_add(1);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (int i = 0; i < n; ++i) {
+        dq.push(i);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    for (int i = 0; i < n; ++i) {
+        EXPECT_EQ(1, seen[i].load()) << "i= " << i << "\n";
+    }
+}
+
+// 5. Owner pushes and pops its own work, while the
+//      thieves steal, the array grows on the way
+//    -> every element is taken exactly once
+TEST(Concurrent, OwnerAndThieves) {
+
+    lock_free_work_stealing_deque<int> dq(4);
+    int n = 100000;
+    int thieves = 3;
+    std::atomic<int> taken(0);
+    std::vector<std::atomic<int>> seen(n);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thieves; ++i) {
+        threads.emplace_back([&]() {
+            int val;
+            while (taken.load() < n) {
+                if (dq.steal(val)) {
+                    seen[val].fetch_add(1);
+                    taken.fetch_add(1);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    int val;
+    for (int i = 0; i < n; ++i) {
+        dq.push(i);
+        // Pop every third element back, as a scheduler
+        // running the task it has just spawned
+        if (i % 3 == 0 && dq.pop(val)) {
+            seen[val].fetch_add(1);
+            taken.fetch_add(1);
+        }
+    }
+    while (dq.pop(val)) {
+        seen[val].fetch_add(1);
+        taken.fetch_add(1);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    for (int i = 0; i < n; ++i) {
+        EXPECT_EQ(1, seen[i].load()) << "i= " << i << "\n";
+    }
+}